@@ -1,88 +1,698 @@
+/* the wide-character library draws UTF-8 text */
+#define NCURSES_WIDECHAR 1
+
 #include <curses.h>
+#include <errno.h>
 #include <locale.h>
+#include <poll.h>
+#include <regex.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "layout.h"
+#include "lines.h"
+#include "search.h"
+#include "source.h"
 
 #define DX 8
 #define DY 4
 
+#define PATTERN_SIZE 256
+#define MESSAGE_SIZE 256
+#define NO_MATCH SIZE_MAX
 
-int contains_new_line(const char *str) {
-        for (int i = 0; str[i] != '\0'; i++) {
-                if (str[i] == '\n') return 1;
-        }
+/* Changes of the file and search progress are shown at most this often. */
+#define FRAME_MS 33
+
+
+/* State of the pager. */
+struct pager {
+        const char *name;               /* file name, shown in the frame */
+        struct source src;              /* bytes of the file */
+        struct line_index lines;        /* where the lines start */
+        struct layout_cache layout;     /* display columns of the lines shown */
+        struct search search;           /* background search, if any */
+        regex_t highlight;              /* pattern of the search, for the UI thread */
+        int highlighting;               /* highlight is compiled */
+        char pattern[PATTERN_SIZE];     /* pattern of the search */
+        char prompt[PATTERN_SIZE];      /* pattern being typed after '/' */
+        size_t prompt_len;
+        int prompting;                  /* '/' was pressed, Enter starts the search */
+        char message[MESSAGE_SIZE];     /* shown instead of the status until a key */
+        int pending;                    /* jump to the next (1) or previous (-1) match when found */
+        uint64_t pending_from;          /* offset the pending jump starts from */
+        size_t top;                     /* first line shown */
+        uint64_t left;                  /* first column shown */
+        WINDOW *frame, *window;
+        int width, height;              /* of the frame */
+        char *text;                     /* bytes of the line being drawn */
+        int *x;                         /* screen column of every byte of text, and of its end */
+        size_t text_size;               /* bytes text and x have room for, without the end */
+};
+
+
+/* Room in p->text and p->x for size bytes of a line. */
+static int reserve_text(struct pager *p, size_t size) {
+        if (size <= p->text_size)
+                return 0;
+
+        char *text = realloc(p->text, size + 1);
+
+        if (text == NULL)
+                return -1;
+        p->text = text;
+
+        int *x = realloc(p->x, (size + 1) * sizeof(*x));
 
+        if (x == NULL)
+                return -1;
+        p->x = x;
+        p->text_size = size;
         return 0;
 }
 
-void print_truncated(WINDOW *win, const char *str, int max_len) {
-        char line[max_len + 1];
-        strncpy(line, str, max_len);
-        line[max_len] = '\0';
+static void create_windows(struct pager *p) {
+        p->width = COLS - 2 * DX;
+        p->height = LINES - 2 * DY;
+
+        p->frame = newwin(p->height, p->width, DY, DX);
+        p->window = newwin(p->height - 2, p->width - 2, DY + 1, DX + 1);
+        keypad(p->window, TRUE);
+        nodelay(p->window, TRUE);
+
+        /* enough bytes for a screen line of the longest characters, as a start */
+        reserve_text(p, 4 * (size_t)(p->width > 2 ? p->width - 2 : 1) + 4);
+}
+
+static void destroy_windows(struct pager *p) {
+        delwin(p->window);
+        delwin(p->frame);
+}
+
+static int rows(const struct pager *p) {
+        return p->height - 2;
+}
+
+static int columns(const struct pager *p) {
+        return p->width - 2;
+}
+
+/*
+ * Reverse the parts of the shown line text that match the search; x
+ * holds the screen column of every byte of text, and of its end.
+ */
+static void highlight_matches(struct pager *p, int row, const char *text, size_t len,
+                              const int *x, int notbol) {
+        const char *s = text;
+
+        while (s < text + len) {
+                regmatch_t match;
+
+                if (regexec(&p->highlight, s, 1, &match, s > text || notbol ? REG_NOTBOL : 0) != 0)
+                        break;
+
+                size_t from = s - text + match.rm_so;
+                size_t to = s - text + match.rm_eo;
+
+                if (from >= len)
+                        break;
+                if (to > len)
+                        to = len;
+                if (x[to] > x[from])
+                        mvwchgat(p->window, row, x[from], x[to] - x[from], A_REVERSE, 0, NULL);
+
+                s = text + (to > from ? to : from + 1);
+        }
+}
+
+/*
+ * Draw the characters of text, which starts at the given column of its
+ * line, from column p->left on. Sets x[i] to the screen column of byte i.
+ * Printable characters are drawn in runs, one call per run. Returns the
+ * bytes drawn, less than len when the screen line is full.
+ */
+static size_t draw_text(struct pager *p, int row, const char *text, size_t len, uint64_t column, int *x) {
+        size_t i = 0, run = 0;
+        int col = 0;
+
+        wmove(p->window, row, 0);
+        while (i < len) {
+                unsigned char c = text[i];
+                int width, printable;
+                size_t bytes = 1;
+
+                /* printable ASCII is one column a byte */
+                if (c >= 0x20 && c < 0x7f && column >= p->left) {
+                        width = printable = 1;
+                } else {
+                        bytes = layout_char(text + i, len - i, column, &width, &printable);
+                }
+
+                /* a wide character cut by the left edge shows as blanks */
+                int shown = column < p->left ? (int)(column + width - p->left) : width;
+
+                if (col + shown > columns(p))
+                        break;
+
+                for (size_t k = 0; k < bytes; k++)
+                        x[i + k] = col;
+
+                if (!printable || shown < width || c == '\t') {
+                        waddnstr(p->window, text + run, i - run);
+                        run = i + bytes;
+
+                        if (shown < width || c == '\t') {
+                                for (int k = 0; k < shown; k++)
+                                        waddch(p->window, ' ');
+                        } else if (c < 0x20 || c == 0x7f) {
+                                waddch(p->window, '^');
+                                waddch(p->window, c ^ 0x40);
+                        } else {
+                                waddch(p->window, '?');
+                        }
+                }
+
+                col += shown;
+                column += width;
+                i += bytes;
+        }
+
+        waddnstr(p->window, text + run, i - run);
+
+        size_t drawn = i;
+
+        for (; i <= len; i++)
+                x[i] = col;
+        return drawn;
+}
+
+static void draw_line(struct pager *p, int row, size_t line) {
+        uint64_t start = lines_start(&p->lines, line);
+        uint64_t end = lines_end(&p->lines, line);
+        struct layout_stop at = layout_seek(&p->layout, &p->lines, &p->src, line, p->left);
+        uint64_t left = end - start - at.offset;
+
+        if (p->text == NULL)
+                return;
+
+        for (;;) {
+                size_t want = left < p->text_size ? left : p->text_size;
+                ssize_t n = source_read(&p->src, start + at.offset, p->text, want);
+                size_t len = n > 0 ? n : 0;
+
+                p->text[len] = '\0';
+
+                /* zero-width characters may take more bytes than a line of text has room for */
+                if (draw_text(p, row, p->text, len, at.column, p->x) < len || len < want || want == left ||
+                    reserve_text(p, 2 * p->text_size) != 0) {
+                        if (p->highlighting)
+                                highlight_matches(p, row, p->text, len, p->x, at.offset > 0);
+                        return;
+                }
+        }
+}
+
+/* Index of the match on the top line, or NO_MATCH. */
+static size_t match_on_top(struct pager *p) {
+        size_t count = search_count(&p->search, NULL, NULL);
+        size_t index = search_find(&p->search, lines_start(&p->lines, p->top));
+
+        if (index < count && search_match(&p->search, index) <= lines_end(&p->lines, p->top))
+                return index;
+        return NO_MATCH;
+}
+
+static void status(struct pager *p, char *text, size_t size) {
+        uint64_t scanned;
+        int done;
+
+        if (p->prompting) {
+                snprintf(text, size, "/%s", p->prompt);
+                return;
+        }
+        if (p->message[0] != '\0') {
+                snprintf(text, size, "%s", p->message);
+                return;
+        }
+
+        text[0] = '\0';
+        if (p->pattern[0] != '\0') {
+                size_t count = search_count(&p->search, &scanned, &done);
+                size_t index = lines_has(&p->lines, &p->src, p->top) ? match_on_top(p) : NO_MATCH;
+                int used = 0;
+
+                if (index != NO_MATCH)
+                        used = snprintf(text, size, "/%s: match %zu of %zu", p->pattern, index + 1, count);
+                else
+                        used = snprintf(text, size, "/%s: %zu matches", p->pattern, count);
+
+                if (!done && used >= 0 && (size_t)used < size)
+                        snprintf(text + used, size - used, ", searching %d%%",
+                                 p->src.size ? (int)(scanned * 100 / p->src.size) : 100);
+                return;
+        }
+
+        if (!lines_has(&p->lines, &p->src, p->top + rows(p)))
+                snprintf(text, size, !p->src.follow ? "Press ESC key to exit."
+                                     : p->src.z ? "Decompressing, press ESC key to exit."
+                                     : "Waiting for data, press ESC key to exit.");
+}
+
+static void draw(struct pager *p) {
+        char text[MESSAGE_SIZE + PATTERN_SIZE];
+
+        werase(p->window);
+        for (int row = 0; row < rows(p) && lines_has(&p->lines, &p->src, p->top + row); row++)
+                draw_line(p, row, p->top + row);
+
+        werase(p->frame);
+        box(p->frame, 0, 0);
+        mvwaddstr(p->frame, 0, (int)((p->width - 5) / 2), p->name);
+
+        status(p, text, sizeof(text));
+        if (text[0] != '\0')
+                mvwaddnstr(p->frame, p->height - 1, 2, text, p->width - 4);
+
+        wnoutrefresh(p->frame);
+        wnoutrefresh(p->window);
+        doupdate();
+}
+
+/* Put the line of a match on top, scrolled so that the match shows. */
+static void show_match(struct pager *p, uint64_t offset) {
+        size_t line = lines_at(&p->lines, &p->src, offset);
+        uint64_t column = layout_column(&p->layout, &p->lines, &p->src, line,
+                                        offset - lines_start(&p->lines, line));
+
+        p->top = line;
+        if (column < p->left || column >= p->left + columns(p))
+                p->left = column < (uint64_t)columns(p) ? 0 : column - columns(p) / 2;
+}
+
+static void scroll_by(struct pager *p, long delta) {
+        if (delta < 0) {
+                p->top = (size_t)-delta > p->top ? 0 : p->top + delta;
+                return;
+        }
+
+        /* scroll while there are lines below the window */
+        while (delta-- > 0 && lines_has(&p->lines, &p->src, p->top + rows(p)))
+                p->top++;
+}
+
+/* Scroll sideways, to the right while a shown line goes on past the window. */
+static void scroll_across(struct pager *p, long delta) {
+        uint64_t want = p->left + delta, most = 0;
 
-        wprintw(win, (contains_new_line(line) ? "%s" : "%s\n"), line);
+        if (delta < 0) {
+                p->left = (uint64_t)-delta > p->left ? 0 : want;
+                return;
+        }
+
+        for (int row = 0; row < rows(p) && lines_has(&p->lines, &p->src, p->top + row); row++) {
+                uint64_t width = layout_width(&p->layout, &p->lines, &p->src, p->top + row, want + columns(p));
+
+                if (width > (uint64_t)columns(p) && width - columns(p) > most)
+                        most = width - columns(p);
+        }
+
+        if (most > p->left)
+                p->left = want < most ? want : most;
+}
+
+/* Jump to the pending match once the search has found it, or report there is none. */
+static void resolve_pending(struct pager *p) {
+        uint64_t scanned;
+        int done;
+        size_t count = search_count(&p->search, &scanned, &done);
+        size_t index = search_find(&p->search, p->pending_from);
+
+        if (p->pending > 0 && index < count) {
+                show_match(p, search_match(&p->search, index));
+                p->pending = 0;
+        } else if (p->pending < 0 && (done || scanned >= p->pending_from)) {
+                if (index > 0)
+                        show_match(p, search_match(&p->search, index - 1));
+                else
+                        snprintf(p->message, sizeof(p->message), "No previous match");
+                p->pending = 0;
+        } else if (p->pending != 0 && done) {
+                snprintf(p->message, sizeof(p->message),
+                         count ? "No more matches" : "Pattern not found");
+                p->pending = 0;
+        }
+}
+
+static void find(struct pager *p, int direction) {
+        if (p->pattern[0] == '\0') {
+                snprintf(p->message, sizeof(p->message), "No search, press / to start one");
+                return;
+        }
+
+        p->pending = direction;
+        if (!lines_has(&p->lines, &p->src, p->top))
+                p->pending_from = 0;
+        else if (direction < 0)
+                p->pending_from = lines_start(&p->lines, p->top);
+        else if (lines_has(&p->lines, &p->src, p->top + 1))
+                p->pending_from = lines_start(&p->lines, p->top + 1);
+        else
+                p->pending_from = p->src.size;
+
+        resolve_pending(p);
+}
+
+static void start_search(struct pager *p) {
+        char error[MESSAGE_SIZE / 2];
+
+        p->prompting = 0;
+        if (p->prompt_len == 0)
+                return;
+
+        if (p->highlighting) {
+                regfree(&p->highlight);
+                p->highlighting = 0;
+        }
+        p->pattern[0] = '\0';
+
+        if (search_start(&p->search, &p->src, p->prompt, error, sizeof(error)) != 0) {
+                snprintf(p->message, sizeof(p->message), "Invalid pattern: %s", error);
+                return;
+        }
+
+        p->highlighting = regcomp(&p->highlight, p->prompt, REG_EXTENDED | REG_NEWLINE) == 0;
+        snprintf(p->pattern, sizeof(p->pattern), "%s", p->prompt);
+
+        /* the first match from the top line on */
+        p->pending = 1;
+        p->pending_from = lines_has(&p->lines, &p->src, p->top) ? lines_start(&p->lines, p->top) : 0;
+        resolve_pending(p);
+}
+
+/* Start the search again on a new or truncated file. */
+static void restart_search(struct pager *p) {
+        char error[MESSAGE_SIZE / 2];
+
+        search_stop(&p->search);
+        p->pending = 0;
+
+        if (p->pattern[0] != '\0' && search_start(&p->search, &p->src, p->pattern, error, sizeof(error)) != 0)
+                p->pattern[0] = '\0';
+}
+
+/* Take in what happened to the followed file since the last frame. */
+static void update_source(struct pager *p) {
+        int at_end = !lines_has(&p->lines, &p->src, p->top + rows(p));
+
+        switch (source_update(&p->src)) {
+        case SOURCE_SAME:
+                return;
+        case SOURCE_GREW:
+                search_continue(&p->search);
+                break;
+        case SOURCE_RESET:
+                /* the worker must not read the old file any more when it is closed */
+                search_stop(&p->search);
+                source_reset(&p->src);
+                restart_search(p);
+                lines_free(&p->lines);
+                layout_free(&p->layout);
+                p->top = 0;
+                at_end = 1;
+                break;
+        }
+
+        /* like tail -f: a view showing the end keeps showing it */
+        if (at_end) {
+                size_t total = lines_total(&p->lines, &p->src);
+
+                p->top = total > (size_t)rows(p) ? total - rows(p) : 0;
+        }
+}
+
+static void prompt_key(struct pager *p, int c) {
+        if (c == 27) {
+                p->prompting = 0;
+        } else if (c == '\n' || c == KEY_ENTER) {
+                start_search(p);
+        } else if (c == KEY_BACKSPACE || c == 127 || c == '\b') {
+                if (p->prompt_len > 0)
+                        p->prompt[--p->prompt_len] = '\0';
+        } else if (c >= 32 && c < 256 && c != 127 && p->prompt_len + 1 < sizeof(p->prompt)) {
+                p->prompt[p->prompt_len++] = c;
+                p->prompt[p->prompt_len] = '\0';
+        }
+}
+
+/* Handle a key; returns 0 when the pager should exit. */
+static int key(struct pager *p, int c) {
+        int done;
+
+        if (p->prompting) {
+                prompt_key(p, c);
+                return 1;
+        }
+
+        p->message[0] = '\0';
+
+        switch (c) {
+        case 27:
+                search_count(&p->search, NULL, &done);
+                if (done)
+                        return 0;
+                /* the first ESC only stops a running search */
+                search_stop(&p->search);
+                p->pending = 0;
+                p->pattern[0] = '\0';
+                if (p->highlighting)
+                        regfree(&p->highlight);
+                p->highlighting = 0;
+                snprintf(p->message, sizeof(p->message), "Search cancelled");
+                break;
+        case 32:
+        case 'j':
+        case KEY_DOWN:
+                scroll_by(p, 1);
+                break;
+        case 'k':
+        case KEY_UP:
+                scroll_by(p, -1);
+                break;
+        case 'h':
+        case KEY_LEFT:
+                scroll_across(p, -(columns(p) / 2));
+                break;
+        case 'l':
+        case KEY_RIGHT:
+                scroll_across(p, columns(p) / 2);
+                break;
+        case KEY_NPAGE:
+                scroll_by(p, rows(p) - 1);
+                break;
+        case KEY_PPAGE:
+                scroll_by(p, -(rows(p) - 1));
+                break;
+        case 'g':
+        case KEY_HOME:
+                p->top = 0;
+                break;
+        case 'G':
+        case KEY_END: {
+                size_t total = lines_total(&p->lines, &p->src);
+
+                p->top = total > (size_t)rows(p) ? total - rows(p) : 0;
+                break;
+        }
+        case '/':
+                p->prompting = 1;
+                p->prompt_len = 0;
+                p->prompt[0] = '\0';
+                break;
+        case 'n':
+                find(p, 1);
+                break;
+        case 'N':
+                find(p, -1);
+                break;
+        case KEY_RESIZE:
+                destroy_windows(p);
+                create_windows(p);
+                break;
+        }
+
+        return 1;
+}
+
+
+static long long now_ms(void) {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
 }
 
 
 int main(int argc, char *argv[]) {
-        FILE *file;
-        WINDOW *frame, *window;
+        struct pager pager = { 0 };
+        struct pager *p = &pager;
+        int c = 0, follow = 0, keep_index = 0, opt;
+        unsigned long limit_mb = 64;
+        char *end;
+
+        while ((opt = getopt(argc, argv, "fim:")) != -1) {
+                if (opt == 'f') {
+                        follow = 1;
+                } else if (opt == 'i') {
+                        keep_index = 1;
+                } else if (opt == 'm') {
+                        limit_mb = strtoul(optarg, &end, 10);
+                        if (*end != '\0' || limit_mb == 0)
+                                break;
+                } else {
+                        break;
+                }
+        }
 
-        char buffer[256];
-        int c = 0;
+        /* no file name: page standard input if it is not the terminal */
+        const char *name = optind < argc ? argv[optind] : isatty(STDIN_FILENO) ? NULL : "-";
 
-        if (argc != 2) {
-                fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
+        if (opt != -1 || name == NULL || optind < argc - 1) {
+                fprintf(stderr, "Usage: %s [-f] [-i] [-m MB] <filename>\n", argv[0]);
+                fprintf(stderr, "   or: command | %s [-m MB] [-]\n", argv[0]);
+                return 1;
+        }
+
+        int stream = strcmp(name, "-") == 0;
+        FILE *tty = NULL;
+
+        if (stream) {
+                /* keys come from the terminal, standard input is the data */
+                tty = fopen("/dev/tty", "r+");
+                if (tty == NULL) {
+                        perror("/dev/tty");
+                        return 1;
+                }
+                if (source_open_pipe(&p->src, STDIN_FILENO, limit_mb << 20) != 0) {
+                        perror("standard input");
+                        return 1;
+                }
+                name = "(standard input)";
+        } else if (source_open(&p->src, name, keep_index) != 0) {
+                fprintf(stderr, "Error opening file: %s: %s\n", name, strerror(errno));
                 return 1;
         }
 
-        file = fopen(argv[1], "r");
+        /* a compressed file is not written to: it is not followed */
+        if (follow && !stream && p->src.z == NULL && source_follow(&p->src) < 0) {
+                perror("inotify");
+                return 1;
+        }
 
-        if (file == NULL) {
-                fprintf(stderr, "Error opening file: %s\n", argv[1]);
+        if (search_init(&p->search) != 0) {
+                perror("pipe");
                 return 1;
         }
 
+        p->name = name;
+        lines_init(&p->lines);
+        layout_init(&p->layout);
+
         setlocale(LC_ALL, "");
-        initscr();
+        if (tty != NULL)
+                newterm(NULL, stdout, tty);
+        else
+                initscr();
         noecho();
         cbreak();
+        set_escdelay(25);
         refresh();
-        
-        int width = COLS - 2 * DX;
-        int height = LINES - 2 * DY;
 
-        frame = newwin(height, width, DY, DX);
-        box(frame, 0, 0);
-        mvwaddstr(frame, 0, (int)((width - 5) / 2), argv[1]);
-        wrefresh(frame);
+        create_windows(p);
+        if (p->src.follow)
+                update_source(p);
+        draw(p);
+
+        /*
+         * Keys are shown at once. Search progress and file changes are
+         * batched into at most one frame per FRAME_MS, however often they
+         * come; with nothing due, poll() sleeps until the next event.
+         */
+        struct pollfd fds[3] = {
+                { .fd = tty ? fileno(tty) : STDIN_FILENO, .events = POLLIN },
+                { .fd = p->search.notify[0], .events = POLLIN },
+                { .fd = source_poll_fd(&p->src), .events = POLLIN },
+        };
+        int running = 1, frame_due = 0, source_due = 0;
+        long long last_frame = now_ms();
 
-        window = newwin(height - 2, width - 2, DY + 1, DX + 1);
-        keypad(window, TRUE);
-        scrollok(window, TRUE);
+        while (running) {
+                int timeout = -1;
 
-        int row_limit = height - 3;
-        int col_limit = width - 3;
+                if (frame_due) {
+                        long long left = last_frame + FRAME_MS - now_ms();
 
-        for (int i = 0; i < row_limit; i++) {
-                if (fgets(buffer, sizeof(buffer), file) != NULL) {
-                        print_truncated(window, buffer, col_limit);
+                        timeout = left > 0 ? left : 0;
                 }
-        }
 
-        while ((c = wgetch(window)) != 27) {
-                if (c == 32) {
-                        if (fgets(buffer, sizeof(buffer), file) != NULL) {
-                                print_truncated(window, buffer, col_limit);
-                        } else {
-                                print_truncated(window, "Press ESC key to exit.", col_limit);
-                        }
+                if (poll(fds, 3, timeout) < 0 && errno != EINTR)
+                        break;
+
+                if (fds[1].revents & POLLIN) {
+                        search_drain(&p->search);
+                        /* what came while the worker ran, or the last line of an ended pipe */
+                        search_continue(&p->search);
+                        if (p->pending != 0)
+                                resolve_pending(p);
+                        frame_due = 1;
+                }
+
+                /* a pipe is read right away, it would stay readable until then */
+                if (fds[2].revents & (POLLIN | POLLHUP)) {
+                        source_drain(&p->src);
+                        fds[2].fd = source_poll_fd(&p->src);
+                        source_due = frame_due = 1;
+                }
+
+                /* after EINTR too: a resize arrives as KEY_RESIZE */
+                int pressed = 0;
+
+                while (running && (c = wgetch(p->window)) != ERR) {
+                        running = key(p, c);
+                        pressed = 1;
+                }
+
+                if (!running)
+                        break;
+
+                if (frame_due && now_ms() >= last_frame + FRAME_MS) {
+                        if (source_due)
+                                update_source(p);
+                        source_due = frame_due = 0;
+                        pressed = 1;
+                }
+
+                if (pressed) {
+                        draw(p);
+                        last_frame = now_ms();
                 }
         }
 
-        fclose(file);
-        delwin(window);
-        delwin(frame);
+        search_destroy(&p->search);
+        if (p->highlighting)
+                regfree(&p->highlight);
+        lines_free(&p->lines);
+        layout_free(&p->layout);
+        source_close(&p->src);
+        destroy_windows(p);
+        free(p->text);
+        free(p->x);
         endwin();
+        if (tty != NULL)
+                fclose(tty);
 
         return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,891 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "compress.h"
+
+/*
+ * Uncompressed bytes between two checkpoints: a jump decompresses at
+ * most this much before reaching its offset. A gzip checkpoint keeps a
+ * 32 KiB window, so the index is about 0.4% of the data.
+ */
+#define SPAN (8 << 20)
+
+/* History a deflate stream may refer back to. */
+#define WINDOW 32768
+
+/* Compressed bytes read at a time. */
+#define INPUT_SIZE (1 << 16)
+
+/* Output thrown away on the way to an offset, per call of a cursor. */
+#define SCRATCH_SIZE (1 << 16)
+
+/* Uncompressed bytes between two wakeups of the UI while indexing. */
+#define NOTIFY_BYTES (4 << 20)
+
+/* Decompressors kept going: the UI and the search worker read apart. */
+#define CURSORS 2
+
+/*
+ * Recent output is cached in pages: redraws read the same lines again,
+ * and the search worker starts a chunk again at its partial last line.
+ */
+#define PAGE_SIZE (1 << 16)
+#define PAGES 64
+
+#define INDEX_MAGIC "ShowIdx1"
+
+/*
+ * A place decompression can start from. For gzip inside a deflate
+ * stream, that is a block boundary (`in` is the byte after it, `bits`
+ * the bits of the byte before still to use) with the window preceding
+ * it; without a window, `in` is the start of a gzip member or a zstd
+ * frame.
+ */
+struct checkpoint {
+        uint64_t out;           /* uncompressed offset */
+        uint64_t in;            /* compressed offset */
+        int bits;
+        unsigned char *window;  /* WINDOW bytes, or NULL */
+};
+
+struct page {
+        uint64_t offset;        /* uncompressed offset, a multiple of PAGE_SIZE */
+        size_t len;             /* PAGE_SIZE, less at the end of the data */
+        unsigned long long used;        /* 0 while unused */
+        int busy;               /* being filled, without the lock */
+        unsigned char *data;
+};
+
+/* A decompressor on its way through the file. */
+struct cursor {
+        uint64_t out;           /* uncompressed offset reached */
+        uint64_t in;            /* compressed offset of the next read */
+        unsigned long long used;        /* for reuse of the oldest one */
+        int active;             /* the decompressor is set up */
+        int busy;               /* a reader decompresses with it, without the lock */
+        int raw;                /* gzip: in a deflate stream started at a window */
+        int ended;              /* no more data, or an error */
+        z_stream strm;
+#ifdef HAVE_ZSTD
+        ZSTD_DCtx *zstd;
+        ZSTD_inBuffer zin;
+#endif
+        unsigned char input[INPUT_SIZE];
+        unsigned char scratch[SCRATCH_SIZE];
+};
+
+struct zfile {
+        int fd;
+        enum compression kind;
+        off_t file_size;        /* of the compressed file, to check a saved index */
+        struct timespec mtime;
+        char *index_path;       /* where to save the index, or NULL */
+
+        /*
+         * The worker appends checkpoints and raises size. The lock covers
+         * the checkpoints, the cache and which cursor is busy, but is let
+         * go while a reader decompresses: the UI is not kept waiting for
+         * the search worker's long decode, nor is the index worker.
+         */
+        pthread_mutex_t lock;
+        pthread_cond_t cursor_free;     /* signalled when a cursor stops being busy */
+        struct checkpoint *points;
+        size_t count, capacity;
+        _Atomic uint64_t size;  /* uncompressed bytes known so far */
+        atomic_int complete;    /* the whole file was decompressed */
+        atomic_int cancel;
+        pthread_t thread;
+        int joinable;
+        int notify[2];          /* the worker wakes up the UI through it */
+
+        struct cursor cursors[CURSORS];
+        struct page pages[PAGES];
+        unsigned long long tick;
+};
+
+
+enum compression compress_detect(int fd) {
+        unsigned char magic[4];
+
+        if (pread(fd, magic, sizeof(magic), 0) < 2)
+                return COMPRESS_NONE;
+        if (magic[0] == 0x1f && magic[1] == 0x8b)
+                return COMPRESS_GZIP;
+        if (magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+                return COMPRESS_ZSTD;
+        return COMPRESS_NONE;
+}
+
+static ssize_t read_at(int fd, void *buf, size_t len, uint64_t offset) {
+        ssize_t n;
+
+        do
+                n = pread(fd, buf, len, offset);
+        while (n < 0 && errno == EINTR);
+        return n;
+}
+
+/* Wake up the UI; a full pipe already means there is news. */
+static void wake(struct zfile *z) {
+        char c = 0;
+
+        if (write(z->notify[1], &c, 1) < 0 && errno != EAGAIN)
+                return;
+}
+
+/* Record a checkpoint; window is the circular output buffer, `left` bytes short of full. */
+static int add_point(struct zfile *z, uint64_t out, uint64_t in, int bits,
+                     const unsigned char *window, unsigned left) {
+        unsigned char *copy = NULL;
+
+        if (window != NULL) {
+                copy = malloc(WINDOW);
+                if (copy == NULL)
+                        return -1;
+                /* the oldest bytes are after the write position */
+                memcpy(copy, window + WINDOW - left, left);
+                memcpy(copy + left, window, WINDOW - left);
+        }
+
+        pthread_mutex_lock(&z->lock);
+        if (z->count == z->capacity) {
+                size_t capacity = z->capacity ? 2 * z->capacity : 64;
+                struct checkpoint *points = realloc(z->points, capacity * sizeof(*points));
+
+                if (points == NULL) {
+                        pthread_mutex_unlock(&z->lock);
+                        free(copy);
+                        return -1;
+                }
+                z->points = points;
+                z->capacity = capacity;
+        }
+        z->points[z->count++] = (struct checkpoint){ out, in, bits, copy };
+        pthread_mutex_unlock(&z->lock);
+        return 0;
+}
+
+/* Make the bytes before out readable, waking up the UI now and then. */
+static void publish(struct zfile *z, uint64_t out, uint64_t *woken) {
+        z->size = out;
+        if (out - *woken >= NOTIFY_BYTES) {
+                *woken = out;
+                wake(z);
+        }
+}
+
+/*
+ * Decompress a gzip file once, noting a checkpoint at the first block
+ * boundary after every SPAN bytes (the zran method of zlib's examples).
+ * Returns 0 when the data ended cleanly.
+ */
+static int index_gzip(struct zfile *z) {
+        unsigned char *input = malloc(INPUT_SIZE), *window = malloc(WINDOW);
+        uint64_t pos = 0, totin = 0, totout = 0, last = 0, woken = 0;
+        z_stream strm = { 0 };
+        int status = -1;
+
+        if (input == NULL || window == NULL || inflateInit2(&strm, 47) != Z_OK) {
+                free(input);
+                free(window);
+                return -1;
+        }
+
+        while (!z->cancel) {
+                if (strm.avail_in == 0) {
+                        ssize_t n = read_at(z->fd, input, INPUT_SIZE, pos);
+
+                        if (n < 0)
+                                break;
+                        pos += n;
+                        strm.next_in = input;
+                        strm.avail_in = n;
+                }
+                if (strm.avail_out == 0) {
+                        strm.next_out = window;
+                        strm.avail_out = WINDOW;
+                }
+
+                unsigned in_before = strm.avail_in, out_before = strm.avail_out;
+                int ret = inflate(&strm, Z_BLOCK);
+
+                totin += in_before - strm.avail_in;
+                totout += out_before - strm.avail_out;
+                publish(z, totout, &woken);
+
+                if (ret == Z_STREAM_END) {
+                        /* concatenated gzip members make one file */
+                        if (strm.avail_in == 0) {
+                                ssize_t n = read_at(z->fd, input, INPUT_SIZE, pos);
+
+                                if (n <= 0) {
+                                        status = n;
+                                        break;
+                                }
+                                pos += n;
+                                strm.next_in = input;
+                                strm.avail_in = n;
+                        }
+                        /* like gzip, ignore what follows the last member */
+                        if (strm.next_in[0] != 0x1f) {
+                                status = 0;
+                                break;
+                        }
+                        inflateReset(&strm);
+                        if (totout - last >= SPAN) {
+                                if (add_point(z, totout, totin, 0, NULL, 0) != 0)
+                                        break;
+                                last = totout;
+                        }
+                        continue;
+                }
+
+                /* Z_BUF_ERROR here means the file is cut short */
+                if (ret != Z_OK)
+                        break;
+
+                /* at the end of a block header, not the last block */
+                if ((strm.data_type & 128) && !(strm.data_type & 64) && totout - last >= SPAN) {
+                        if (add_point(z, totout, totin, strm.data_type & 7, window, strm.avail_out) != 0)
+                                break;
+                        last = totout;
+                }
+        }
+
+        inflateEnd(&strm);
+        free(input);
+        free(window);
+        return status;
+}
+
+#ifdef HAVE_ZSTD
+/*
+ * zstd frames are independent: the checkpoints are frame starts, as
+ * decompression can not resume inside a frame. A file made of a single
+ * frame, which is what zstd writes by default, has its only checkpoint
+ * at 0 and every jump back decompresses from the start. Files written
+ * as many frames, by pzstd or in the seekable format of zstd's contrib,
+ * get a checkpoint every SPAN bytes like gzip files.
+ */
+static int index_zstd(struct zfile *z) {
+        size_t output_size = ZSTD_DStreamOutSize();
+        unsigned char *input = malloc(INPUT_SIZE), *output = malloc(output_size);
+        ZSTD_DCtx *dctx = ZSTD_createDCtx();
+        ZSTD_inBuffer in = { input, 0, 0 };
+        uint64_t pos = 0, base = 0, totout = 0, last = 0, woken = 0;
+        size_t ret = 0;
+        int full = 0, status = -1;
+
+        while (input != NULL && output != NULL && dctx != NULL && !z->cancel) {
+                /* a full output buffer may leave data inside the decoder */
+                if (in.pos == in.size && !full) {
+                        ssize_t n = read_at(z->fd, input, INPUT_SIZE, pos);
+
+                        if (n < 0)
+                                break;
+                        if (n == 0) {
+                                /* the last frame must be complete */
+                                status = ret == 0 ? 0 : -1;
+                                break;
+                        }
+                        base = pos;
+                        pos += n;
+                        in.size = n;
+                        in.pos = 0;
+                }
+
+                ZSTD_outBuffer out = { output, output_size, 0 };
+
+                ret = ZSTD_decompressStream(dctx, &out, &in);
+                if (ZSTD_isError(ret))
+                        break;
+
+                full = out.pos == out.size;
+                totout += out.pos;
+                publish(z, totout, &woken);
+
+                if (ret == 0 && totout - last >= SPAN) {
+                        if (add_point(z, totout, base + in.pos, 0, NULL, 0) != 0)
+                                break;
+                        last = totout;
+                }
+        }
+
+        ZSTD_freeDCtx(dctx);
+        free(input);
+        free(output);
+        return status;
+}
+#endif
+
+/*
+ * Saved index: a header, then per checkpoint its offsets, bits and
+ * whether a window follows. It is only used for the same file, judged
+ * by its size and modification time.
+ */
+struct index_header {
+        char magic[8];
+        uint32_t kind;
+        uint32_t span;
+        uint64_t file_size;
+        int64_t mtime_sec;
+        int64_t mtime_nsec;
+        uint64_t size;
+        uint64_t count;
+};
+
+struct index_entry {
+        uint64_t out;
+        uint64_t in;
+        int32_t bits;
+        int32_t window;
+};
+
+static void index_header(const struct zfile *z, struct index_header *header) {
+        memset(header, 0, sizeof(*header));
+        memcpy(header->magic, INDEX_MAGIC, sizeof(header->magic));
+        header->kind = z->kind;
+        header->span = SPAN;
+        header->file_size = z->file_size;
+        header->mtime_sec = z->mtime.tv_sec;
+        header->mtime_nsec = z->mtime.tv_nsec;
+}
+
+/* Write the index next to the file; a reader never sees it half done. */
+static void save_index(struct zfile *z) {
+        char temp[PATH_MAX];
+        struct index_header header;
+        int ok = 1;
+
+        if (snprintf(temp, sizeof(temp), "%s.XXXXXX", z->index_path) >= (int)sizeof(temp))
+                return;
+
+        int fd = mkostemp(temp, O_CLOEXEC);
+        FILE *file = fd >= 0 ? fdopen(fd, "w") : NULL;
+
+        if (file == NULL) {
+                if (fd >= 0) {
+                        close(fd);
+                        unlink(temp);
+                }
+                return;
+        }
+
+        index_header(z, &header);
+        header.size = z->size;
+        header.count = z->count;
+        ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+        for (size_t i = 0; ok && i < z->count; i++) {
+                const struct checkpoint *p = &z->points[i];
+                struct index_entry entry = { p->out, p->in, p->bits, p->window != NULL };
+
+                ok = fwrite(&entry, sizeof(entry), 1, file) == 1 &&
+                     (p->window == NULL || fwrite(p->window, WINDOW, 1, file) == 1);
+        }
+
+        /*
+         * The temporary file is private. The index holds decompressed text,
+         * so it gets no more permissions than the compressed file has.
+         */
+        struct stat st;
+
+        if (fstat(z->fd, &st) == 0)
+                fchmod(fd, st.st_mode & 0666);
+        if (fclose(file) != 0 || !ok || rename(temp, z->index_path) != 0)
+                unlink(temp);
+}
+
+/* Take the checkpoints from a saved index of this file. */
+static int load_index(struct zfile *z) {
+        FILE *file = fopen(z->index_path, "re");
+        struct index_header header, expected;
+        int ok = 0;
+
+        if (file == NULL)
+                return -1;
+
+        index_header(z, &expected);
+        if (fread(&header, sizeof(header), 1, file) == 1 && header.count > 0 &&
+            memcmp(&header, &expected, offsetof(struct index_header, size)) == 0) {
+                ok = 1;
+                for (uint64_t i = 0; ok && i < header.count; i++) {
+                        struct index_entry entry;
+                        unsigned char *window = NULL;
+
+                        ok = fread(&entry, sizeof(entry), 1, file) == 1 &&
+                             entry.bits >= 0 && entry.bits < 8 && entry.out <= header.size &&
+                             (i == 0 ? entry.out == 0 : entry.out >= z->points[i - 1].out);
+                        if (ok && entry.window) {
+                                window = malloc(WINDOW);
+                                ok = window != NULL && fread(window, WINDOW, 1, file) == 1;
+                        }
+                        if (ok)
+                                ok = add_point(z, entry.out, entry.in, entry.bits, NULL, 0) == 0;
+                        if (ok)
+                                z->points[z->count - 1].window = window;
+                        else
+                                free(window);
+                }
+        }
+        fclose(file);
+
+        if (!ok) {
+                /* index from scratch instead */
+                while (z->count > 0)
+                        free(z->points[--z->count].window);
+                return -1;
+        }
+
+        z->size = header.size;
+        z->complete = 1;
+        return 0;
+}
+
+static void *index_worker(void *arg) {
+        struct zfile *z = arg;
+        int status = -1;
+
+        if (z->kind == COMPRESS_GZIP)
+                status = index_gzip(z);
+#ifdef HAVE_ZSTD
+        else
+                status = index_zstd(z);
+#endif
+
+        /* what was decompressed stays readable, even if the file is damaged */
+        z->complete = 1;
+        wake(z);
+
+        if (status == 0 && !z->cancel && z->index_path != NULL)
+                save_index(z);
+        return NULL;
+}
+
+struct zfile *zfile_open(int fd, enum compression kind, const char *index_path) {
+        struct zfile *z;
+        struct stat st;
+
+#ifndef HAVE_ZSTD
+        if (kind == COMPRESS_ZSTD) {
+                errno = ENOTSUP;
+                return NULL;
+        }
+#endif
+        if (fstat(fd, &st) != 0 || (z = calloc(1, sizeof(*z))) == NULL)
+                return NULL;
+
+        z->fd = fd;
+        z->kind = kind;
+        z->file_size = st.st_size;
+        z->mtime = st.st_mtim;
+        z->notify[0] = z->notify[1] = -1;
+        pthread_mutex_init(&z->lock, NULL);
+        pthread_cond_init(&z->cursor_free, NULL);
+
+        if (index_path != NULL && (z->index_path = strdup(index_path)) != NULL && load_index(z) == 0)
+                return z;
+
+        if (add_point(z, 0, 0, 0, NULL, 0) != 0 || pipe2(z->notify, O_NONBLOCK | O_CLOEXEC) != 0 ||
+            pthread_create(&z->thread, NULL, index_worker, z) != 0) {
+                zfile_close(z);
+                return NULL;
+        }
+
+        z->joinable = 1;
+        return z;
+}
+
+/*
+ * Descriptor readable when more data was decompressed, and once more
+ * after the end; -1 if the index was loaded complete.
+ */
+int zfile_poll_fd(struct zfile *z) {
+        return z->notify[0];
+}
+
+void zfile_drain(struct zfile *z) {
+        char buf[64];
+
+        while (read(z->notify[0], buf, sizeof(buf)) > 0)
+                ;
+}
+
+uint64_t zfile_size(struct zfile *z, int *complete) {
+        /* the worker raises the size before it completes */
+        *complete = z->complete;
+        return z->size;
+}
+
+static ssize_t fill_input(struct zfile *z, struct cursor *c) {
+        ssize_t n = read_at(z->fd, c->input, INPUT_SIZE, c->in);
+
+        if (n > 0) {
+                c->in += n;
+                c->strm.next_in = c->input;
+                c->strm.avail_in = n;
+#ifdef HAVE_ZSTD
+                c->zin = (ZSTD_inBuffer){ c->input, n, 0 };
+#endif
+        }
+        return n;
+}
+
+/* Set up a cursor to decompress from a checkpoint. */
+static int seek_cursor(struct zfile *z, struct cursor *c, const struct checkpoint *p) {
+        c->out = p->out;
+        c->in = p->in;
+        c->ended = 1;
+        c->strm.avail_in = 0;
+
+#ifdef HAVE_ZSTD
+        if (z->kind == COMPRESS_ZSTD) {
+                if (!c->active && (c->zstd = ZSTD_createDCtx()) == NULL)
+                        return -1;
+                c->active = 1;
+                c->zin = (ZSTD_inBuffer){ c->input, 0, 0 };
+                if (ZSTD_isError(ZSTD_DCtx_reset(c->zstd, ZSTD_reset_session_only)))
+                        return -1;
+                c->ended = 0;
+                return 0;
+        }
+#endif
+
+        if (!c->active) {
+                memset(&c->strm, 0, sizeof(c->strm));
+                if (inflateInit2(&c->strm, 47) != Z_OK)
+                        return -1;
+                c->active = 1;
+        }
+
+        c->raw = p->window != NULL;
+        if (!c->raw) {
+                if (inflateReset2(&c->strm, 47) != Z_OK)
+                        return -1;
+                c->ended = 0;
+                return 0;
+        }
+
+        if (inflateReset2(&c->strm, -15) != Z_OK)
+                return -1;
+        if (p->bits) {
+                unsigned char byte;
+
+                if (read_at(z->fd, &byte, 1, p->in - 1) != 1)
+                        return -1;
+                inflatePrime(&c->strm, p->bits, byte >> (8 - p->bits));
+        }
+        if (inflateSetDictionary(&c->strm, p->window, WINDOW) != Z_OK)
+                return -1;
+        c->ended = 0;
+        return 0;
+}
+
+/* After the end of a gzip member, go on with the next one if there is one. */
+static int next_member(struct zfile *z, struct cursor *c) {
+        /* a stream started at a window is raw deflate: skip the gzip trailer */
+        for (unsigned skip = c->raw ? 8 : 0; skip > 0; ) {
+                if (c->strm.avail_in == 0 && fill_input(z, c) <= 0)
+                        return -1;
+
+                unsigned n = c->strm.avail_in < skip ? c->strm.avail_in : skip;
+
+                c->strm.next_in += n;
+                c->strm.avail_in -= n;
+                skip -= n;
+        }
+
+        if (c->strm.avail_in == 0 && fill_input(z, c) <= 0)
+                return -1;
+        if (c->strm.next_in[0] != 0x1f)
+                return -1;
+
+        c->raw = 0;
+        return inflateReset2(&c->strm, 47) == Z_OK ? 0 : -1;
+}
+
+static size_t decode_gzip(struct zfile *z, struct cursor *c, unsigned char *out, size_t len) {
+        c->strm.next_out = out;
+        c->strm.avail_out = len;
+
+        while (c->strm.avail_out > 0 && !c->ended) {
+                /* at the end of the file, inflate() may still have output */
+                if (c->strm.avail_in == 0 && fill_input(z, c) < 0) {
+                        c->ended = 1;
+                        break;
+                }
+
+                int ret = inflate(&c->strm, Z_NO_FLUSH);
+
+                if (ret == Z_STREAM_END)
+                        c->ended = next_member(z, c) != 0;
+                else if (ret != Z_OK)
+                        c->ended = 1;
+        }
+
+        return len - c->strm.avail_out;
+}
+
+#ifdef HAVE_ZSTD
+static size_t decode_zstd(struct zfile *z, struct cursor *c, unsigned char *out, size_t len) {
+        ZSTD_outBuffer output = { out, len, 0 };
+
+        while (output.pos < output.size && !c->ended) {
+                int at_end = 0;
+
+                if (c->zin.pos == c->zin.size) {
+                        ssize_t n = fill_input(z, c);
+
+                        if (n < 0) {
+                                c->ended = 1;
+                                break;
+                        }
+                        at_end = n == 0;
+                }
+
+                size_t before = output.pos;
+                size_t ret = ZSTD_decompressStream(c->zstd, &output, &c->zin);
+
+                if (ZSTD_isError(ret) || (at_end && output.pos == before))
+                        c->ended = 1;
+        }
+
+        return output.pos;
+}
+#endif
+
+/* Decompress up to len bytes, or skip them when out is NULL. */
+static size_t decode(struct zfile *z, struct cursor *c, unsigned char *out, size_t len) {
+        size_t done = 0;
+
+        while (done < len && !c->ended) {
+                unsigned char *to = out ? out + done : c->scratch;
+                size_t want = len - done;
+                size_t n;
+
+                if (out == NULL && want > SCRATCH_SIZE)
+                        want = SCRATCH_SIZE;
+                if (want > UINT_MAX)
+                        want = UINT_MAX;
+
+#ifdef HAVE_ZSTD
+                if (z->kind == COMPRESS_ZSTD)
+                        n = decode_zstd(z, c, to, want);
+                else
+#endif
+                        n = decode_gzip(z, c, to, want);
+
+                c->out += n;
+                done += n;
+        }
+
+        return done;
+}
+
+/* Last checkpoint at or before offset. Called locked. */
+static const struct checkpoint *find_point(const struct zfile *z, uint64_t offset) {
+        size_t low = 0, high = z->count;
+
+        while (high - low > 1) {
+                size_t mid = low + (high - low) / 2;
+
+                if (z->points[mid].out <= offset)
+                        low = mid;
+                else
+                        high = mid;
+        }
+
+        return &z->points[low];
+}
+
+/*
+ * Take the cursor to read at offset from p, the nearest checkpoint: one
+ * already between p and offset goes on from where it is, so reading
+ * forward does not start over; else the oldest one is set to start from
+ * p, and *seek is set. Called locked, waits while every cursor is busy.
+ */
+static struct cursor *take_cursor(struct zfile *z, uint64_t offset, struct checkpoint *p, int *seek) {
+        for (;;) {
+                struct cursor *c = NULL, *oldest = NULL;
+
+                *p = *find_point(z, offset);
+                for (int i = 0; i < CURSORS; i++) {
+                        struct cursor *k = &z->cursors[i];
+
+                        if (k->busy)
+                                continue;
+                        if (k->active && !k->ended && k->out >= p->out && k->out <= offset && (c == NULL || k->out > c->out))
+                                c = k;
+                        if (oldest == NULL || k->used < oldest->used)
+                                oldest = k;
+                }
+
+                if (oldest != NULL) {
+                        *seek = c == NULL;
+                        c = c ? c : oldest;
+                        c->busy = 1;
+                        c->used = ++z->tick;
+                        return c;
+                }
+                pthread_cond_wait(&z->cursor_free, &z->lock);
+        }
+}
+
+/*
+ * Decompress len bytes at offset into out. Called locked; the lock is
+ * let go while decompressing, with the cursor kept busy. The window of
+ * the copied checkpoint stays valid: checkpoints are only ever added.
+ */
+static ssize_t decode_at(struct zfile *z, uint64_t offset, unsigned char *out, size_t len) {
+        struct checkpoint p;
+        int seek;
+        struct cursor *c = take_cursor(z, offset, &p, &seek);
+        ssize_t n = -1;
+
+        pthread_mutex_unlock(&z->lock);
+        if (!seek || seek_cursor(z, c, &p) == 0) {
+                decode(z, c, NULL, offset - c->out);
+                if (c->out == offset)
+                        n = decode(z, c, out, len);
+        }
+        pthread_mutex_lock(&z->lock);
+
+        c->busy = 0;
+        pthread_cond_signal(&z->cursor_free);
+        return n;
+}
+
+/*
+ * The cached page starting at offset, decompressed now if needed. Called
+ * locked; the page being filled is busy, so no other reader takes it.
+ */
+static struct page *get_page(struct zfile *z, uint64_t offset) {
+        struct page *page = NULL;
+
+        for (int i = 0; i < PAGES; i++) {
+                if (z->pages[i].used != 0 && z->pages[i].offset == offset) {
+                        page = &z->pages[i];
+                        page->used = ++z->tick;
+                        return page;
+                }
+                if (!z->pages[i].busy && (page == NULL || z->pages[i].used < page->used))
+                        page = &z->pages[i];
+        }
+
+        if (page->data == NULL && (page->data = malloc(PAGE_SIZE)) == NULL)
+                return NULL;
+
+        /* until it is filled, the page is unused and never found */
+        page->used = 0;
+        page->busy = 1;
+        ssize_t n = decode_at(z, offset, page->data, PAGE_SIZE);
+
+        page->busy = 0;
+        if (n < 0)
+                return NULL;
+        page->offset = offset;
+        page->len = n;
+        page->used = ++z->tick;
+        return page;
+}
+
+/*
+ * Read up to len bytes at offset; short only at the end of the data.
+ * Pages at the edges of a read go through the cache, where the next
+ * read usually starts again; whole pages in between are decompressed
+ * straight into buf.
+ */
+ssize_t zfile_read(struct zfile *z, uint64_t offset, char *buf, size_t len) {
+        uint64_t size = z->size;
+        size_t done = 0;
+
+        if (offset >= size)
+                return 0;
+        if (len > size - offset)
+                len = size - offset;
+
+        pthread_mutex_lock(&z->lock);
+
+        while (done < len) {
+                uint64_t at = offset + done;
+                size_t skip = at % PAGE_SIZE, want = len - done;
+                struct page *page = NULL;
+                ssize_t n;
+
+                for (int i = 0; i < PAGES && skip == 0 && want > PAGE_SIZE; i++) {
+                        if (z->pages[i].used != 0 && z->pages[i].offset == at)
+                                page = &z->pages[i];
+                }
+
+                if (skip == 0 && want > PAGE_SIZE && page == NULL) {
+                        /* the last page of the read is left to the cache */
+                        n = decode_at(z, at, (unsigned char *)buf + done, (want - 1) / PAGE_SIZE * PAGE_SIZE);
+                } else if ((page = get_page(z, at - skip)) != NULL) {
+                        n = page->len > skip ? page->len - skip : 0;
+                        if ((size_t)n > want)
+                                n = want;
+                        memcpy(buf + done, page->data + skip, n);
+                } else {
+                        n = -1;
+                }
+
+                if (n <= 0)
+                        break;
+                done += n;
+        }
+
+        pthread_mutex_unlock(&z->lock);
+
+        if (done == 0) {
+                errno = EIO;
+                return -1;
+        }
+        return done;
+}
+
+void zfile_close(struct zfile *z) {
+        z->cancel = 1;
+        if (z->joinable)
+                pthread_join(z->thread, NULL);
+
+        for (int i = 0; i < CURSORS; i++) {
+                if (!z->cursors[i].active)
+                        continue;
+#ifdef HAVE_ZSTD
+                if (z->kind == COMPRESS_ZSTD)
+                        ZSTD_freeDCtx(z->cursors[i].zstd);
+                else
+#endif
+                        inflateEnd(&z->cursors[i].strm);
+        }
+
+        for (int i = 0; i < PAGES; i++)
+                free(z->pages[i].data);
+        for (size_t i = 0; i < z->count; i++)
+                free(z->points[i].window);
+        free(z->points);
+        free(z->index_path);
+        if (z->notify[0] >= 0) {
+                close(z->notify[0]);
+                close(z->notify[1]);
+        }
+        pthread_cond_destroy(&z->cursor_free);
+        pthread_mutex_destroy(&z->lock);
+        free(z);
+}
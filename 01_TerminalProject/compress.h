@@ -0,0 +1,30 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Formats recognised by compress_detect(). */
+enum compression {
+        COMPRESS_NONE,
+        COMPRESS_GZIP,
+        COMPRESS_ZSTD,
+};
+
+/*
+ * A compressed file read by uncompressed offset. A background thread
+ * decompresses it once and records checkpoints on the way; a read
+ * resumes from the nearest checkpoint before its offset.
+ */
+struct zfile;
+
+enum compression compress_detect(int fd);
+struct zfile *zfile_open(int fd, enum compression kind, const char *index_path);
+int zfile_poll_fd(struct zfile *z);
+void zfile_drain(struct zfile *z);
+uint64_t zfile_size(struct zfile *z, int *complete);
+ssize_t zfile_read(struct zfile *z, uint64_t offset, char *buf, size_t len);
+void zfile_close(struct zfile *z);
+
+#endif
@@ -0,0 +1,254 @@
+#define _XOPEN_SOURCE 700
+
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "layout.h"
+
+/* Columns between two stops of a line. */
+#define STOP_COLUMNS 256
+
+#define TAB_WIDTH 8
+
+/* Bytes of a line read at a time. */
+#define READ_SIZE 4096
+
+/* Longest UTF-8 sequence. */
+#define CHAR_MAX_LEN 4
+
+
+void layout_init(struct layout_cache *cache) {
+        memset(cache, 0, sizeof(*cache));
+        for (int i = 0; i < LAYOUT_SLOTS; i++)
+                cache->slots[i].line = SIZE_MAX;
+}
+
+void layout_free(struct layout_cache *cache) {
+        for (int i = 0; i < LAYOUT_SLOTS; i++)
+                free(cache->slots[i].stops);
+        layout_init(cache);
+}
+
+/*
+ * Length of the character at s and its width at column. A tab reaches
+ * the next tab stop; a control character is shown as ^X and a byte that
+ * is not valid UTF-8 or not printable as '?': for those, *printable is 0.
+ */
+size_t layout_char(const char *s, size_t len, uint64_t column, int *width, int *printable) {
+        const unsigned char *u = (const unsigned char *)s;
+        unsigned char c = u[0];
+        size_t n;
+        wchar_t wc;
+
+        *printable = 1;
+        if (c < 0x80) {
+                if (c == '\t') {
+                        *width = TAB_WIDTH - column % TAB_WIDTH;
+                } else if (c < 0x20 || c == 0x7f) {
+                        *width = 2;
+                        *printable = 0;
+                } else {
+                        *width = 1;
+                }
+                return 1;
+        }
+
+        n = c >= 0xf5 ? 0 : c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc2 ? 2 : 0;
+        if (n == 0 || n > len)
+                goto invalid;
+
+        wc = c & (0x7f >> n);
+        for (size_t i = 1; i < n; i++) {
+                if ((u[i] & 0xc0) != 0x80)
+                        goto invalid;
+                wc = wc << 6 | (u[i] & 0x3f);
+        }
+
+        /* overlong forms, surrogates and values past Unicode */
+        if ((n == 3 && wc < 0x800) || (n == 4 && (wc < 0x10000 || wc > 0x10ffff)) ||
+            (wc >= 0xd800 && wc <= 0xdfff))
+                goto invalid;
+
+        int w = wcwidth(wc);
+
+        if (w >= 0) {
+                *width = w;
+                return n;
+        }
+
+invalid:
+        *width = 1;
+        *printable = 0;
+        return 1;
+}
+
+/* Length of the run of printable ASCII at the start of s. */
+static size_t ascii_run(const char *s, size_t len) {
+        size_t i = 0;
+
+        while (i < len && (unsigned char)s[i] >= 0x20 && (unsigned char)s[i] < 0x7f)
+                i++;
+        return i;
+}
+
+static int add_stop(struct layout *l, struct layout_stop stop) {
+        if (l->count == l->capacity) {
+                size_t capacity = l->capacity ? 2 * l->capacity : 16;
+                struct layout_stop *stops = realloc(l->stops, capacity * sizeof(*stops));
+
+                if (stops == NULL)
+                        return -1;
+                l->stops = stops;
+                l->capacity = capacity;
+        }
+
+        l->stops[l->count++] = stop;
+        return 0;
+}
+
+/* The last stop at or before a column or an offset; the end of the ASCII run counts. */
+static struct layout_stop last_stop(const struct layout *l, uint64_t column, uint64_t offset) {
+        struct layout_stop stop = { l->ascii, l->ascii };
+        size_t low = 0, high = l->count;
+
+        while (low < high) {
+                size_t mid = low + (high - low) / 2;
+
+                if (l->stops[mid].column <= column && l->stops[mid].offset <= offset)
+                        low = mid + 1;
+                else
+                        high = mid;
+        }
+
+        return low > 0 ? l->stops[low - 1] : stop;
+}
+
+/*
+ * Go through the characters of a line from `at` until the next one holds
+ * `column` or starts at `offset` or later, or the bytes before `limit`
+ * are used. When the line goes on after limit, a character is only taken
+ * whole. With l, this measures the line: the ASCII run and the stops are
+ * noted on the way.
+ */
+static void advance(struct source *src, uint64_t start, uint64_t limit, int final,
+                    struct layout_stop *at, uint64_t column, uint64_t offset, struct layout *l) {
+        char buf[READ_SIZE];
+
+        while (at->offset < limit && at->offset < offset && at->column <= column) {
+                size_t want = limit - at->offset < sizeof(buf) ? limit - at->offset : sizeof(buf);
+                ssize_t n = source_read(src, start + at->offset, buf, want);
+
+                if (n <= 0)
+                        return;
+
+                /* a character cut by the end of buf is read again */
+                size_t end = n;
+
+                if (!final || at->offset + n < limit) {
+                        if (n < CHAR_MAX_LEN)
+                                return;
+                        end = n - (CHAR_MAX_LEN - 1);
+                }
+
+                size_t i = 0;
+
+                /* fast path: here a column is a byte */
+                if (l != NULL && l->ascii == at->offset && at->column == at->offset) {
+                        size_t run = ascii_run(buf, end);
+
+                        if (column - at->column < run)
+                                run = column - at->column;
+                        if (offset - at->offset < run)
+                                run = offset - at->offset;
+
+                        l->ascii += run;
+                        at->offset += run;
+                        at->column += run;
+                        i = run;
+                }
+
+                while (i < end) {
+                        int width, printable;
+                        size_t bytes = layout_char(buf + i, n - i, at->column, &width, &printable);
+
+                        if (at->column + width > column || at->offset >= offset)
+                                return;
+
+                        if (l != NULL) {
+                                struct layout_stop last = l->count ? l->stops[l->count - 1]
+                                                                   : (struct layout_stop){ l->ascii, l->ascii };
+
+                                if (at->column >= last.column + STOP_COLUMNS && add_stop(l, *at) != 0)
+                                        return;
+                        }
+
+                        at->offset += bytes;
+                        at->column += width;
+                        i += bytes;
+                }
+        }
+}
+
+/* The cached layout of a line known to lines_has(), measured up to a column or an offset. */
+static struct layout *measure(struct layout_cache *cache, struct line_index *idx, struct source *src,
+                              size_t line, uint64_t column, uint64_t offset) {
+        struct layout *l = &cache->slots[line % LAYOUT_SLOTS];
+        uint64_t start = lines_start(idx, line);
+
+        if (l->line != line || l->start != start) {
+                l->line = line;
+                l->start = start;
+                l->measured = l->columns = l->ascii = 0;
+                l->count = 0;
+        }
+
+        /* the last line of a followed file may still grow */
+        int final = !src->follow || line + 1 < idx->count;
+        struct layout_stop at = { l->measured, l->columns };
+
+        advance(src, start, lines_end(idx, line) - start, final, &at, column, offset, l);
+        l->measured = at.offset;
+        l->columns = at.column;
+        return l;
+}
+
+/* Columns of a line, or limit + 1 if it has more. */
+uint64_t layout_width(struct layout_cache *cache, struct line_index *idx, struct source *src,
+                      size_t line, uint64_t limit) {
+        struct layout *l = measure(cache, idx, src, line, limit, UINT64_MAX);
+
+        return l->measured < lines_end(idx, line) - l->start ? limit + 1 : l->columns;
+}
+
+/*
+ * The character of a line that holds a column: where it starts and its
+ * first column, which is before the wanted one for a wide character. Past
+ * the end of the line, that is the end.
+ */
+struct layout_stop layout_seek(struct layout_cache *cache, struct line_index *idx, struct source *src,
+                               size_t line, uint64_t column) {
+        struct layout *l = measure(cache, idx, src, line, column, UINT64_MAX);
+
+        if (column < l->ascii)
+                return (struct layout_stop){ column, column };
+
+        struct layout_stop at = last_stop(l, column, UINT64_MAX);
+
+        advance(src, l->start, l->measured, 1, &at, column, UINT64_MAX, NULL);
+        return at;
+}
+
+/* Column of the character of a line starting at offset, or after it. */
+uint64_t layout_column(struct layout_cache *cache, struct line_index *idx, struct source *src,
+                       size_t line, uint64_t offset) {
+        struct layout *l = measure(cache, idx, src, line, UINT64_MAX, offset);
+
+        if (offset <= l->ascii)
+                return offset;
+
+        struct layout_stop at = last_stop(l, UINT64_MAX, offset);
+
+        advance(src, l->start, l->measured, 1, &at, UINT64_MAX, offset, NULL);
+        return at.column;
+}
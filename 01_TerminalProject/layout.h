@@ -0,0 +1,50 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lines.h"
+#include "source.h"
+
+/* Lines whose layout is kept; a line is cached in slot line % LAYOUT_SLOTS. */
+#define LAYOUT_SLOTS 256
+
+/* A character start: byte offset in its line and display column. */
+struct layout_stop {
+        uint64_t offset;
+        uint64_t column;
+};
+
+/*
+ * Display columns of a line, measured once and only as far as the line
+ * was shown. In the leading run of printable ASCII a column is a byte;
+ * after it a stop is noted every STOP_COLUMNS columns, so that a column
+ * far to the right is found without measuring the line from its start.
+ */
+struct layout {
+        size_t line;            /* line measured, SIZE_MAX for none */
+        uint64_t start;         /* offset of the line, to tell a reused line number */
+        uint64_t measured;      /* bytes of the line measured, whole characters */
+        uint64_t columns;       /* columns of those bytes */
+        uint64_t ascii;         /* length of the leading printable ASCII run */
+        struct layout_stop *stops;
+        size_t count;           /* entries of stops */
+        size_t capacity;        /* allocated entries of stops */
+};
+
+struct layout_cache {
+        struct layout slots[LAYOUT_SLOTS];
+};
+
+void layout_init(struct layout_cache *cache);
+void layout_free(struct layout_cache *cache);
+size_t layout_char(const char *s, size_t len, uint64_t column, int *width, int *printable);
+uint64_t layout_width(struct layout_cache *cache, struct line_index *idx, struct source *src,
+                      size_t line, uint64_t limit);
+struct layout_stop layout_seek(struct layout_cache *cache, struct line_index *idx, struct source *src,
+                               size_t line, uint64_t column);
+uint64_t layout_column(struct layout_cache *cache, struct line_index *idx, struct source *src,
+                       size_t line, uint64_t offset);
+
+#endif
@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "lines.h"
+
+#define SCAN_SIZE (1 << 16)
+
+
+void lines_init(struct line_index *idx) {
+        memset(idx, 0, sizeof(*idx));
+}
+
+void lines_free(struct line_index *idx) {
+        free(idx->starts);
+        lines_init(idx);
+}
+
+static int push(struct line_index *idx, uint64_t start) {
+        if (idx->count == idx->capacity) {
+                size_t capacity = idx->capacity ? 2 * idx->capacity : 1024;
+                uint64_t *starts = realloc(idx->starts, capacity * sizeof(*starts));
+
+                if (starts == NULL)
+                        return -1;
+                idx->starts = starts;
+                idx->capacity = capacity;
+        }
+
+        idx->starts[idx->count++] = start;
+        return 0;
+}
+
+/* Search newlines until `until` bytes are scanned or `lines` lines are known. */
+static void scan(struct line_index *idx, struct source *src, uint64_t until, size_t lines) {
+        char buf[SCAN_SIZE];
+
+        if (idx->count == 0 && src->size > 0 && push(idx, 0) != 0)
+                return;
+
+        while (idx->scanned < src->size && (idx->scanned < until || idx->count < lines)) {
+                ssize_t n = source_read(src, idx->scanned, buf, sizeof(buf));
+
+                if (n <= 0)
+                        return;
+
+                for (char *p = buf; (p = memchr(p, '\n', buf + n - p)) != NULL; p++) {
+                        if (push(idx, idx->scanned + (p - buf) + 1) != 0)
+                                return;
+                }
+
+                idx->scanned += n;
+        }
+}
+
+/* Number of lines among the known starts: a start at the very end is no line yet. */
+static size_t known_lines(const struct line_index *idx, const struct source *src) {
+        if (idx->count > 0 && idx->starts[idx->count - 1] >= src->size)
+                return idx->count - 1;
+        return idx->count;
+}
+
+/* Whether the line exists; its start and end are known afterwards. */
+int lines_has(struct line_index *idx, struct source *src, size_t line) {
+        scan(idx, src, 0, line + 2);
+        return line < known_lines(idx, src);
+}
+
+size_t lines_total(struct line_index *idx, struct source *src) {
+        scan(idx, src, src->size, 0);
+        return known_lines(idx, src);
+}
+
+/* Line holding the byte at offset, or the last line. */
+size_t lines_at(struct line_index *idx, struct source *src, uint64_t offset) {
+        size_t low = 0, high;
+
+        scan(idx, src, offset + 1, 0);
+        high = known_lines(idx, src);
+
+        if (high == 0)
+                return 0;
+
+        while (high - low > 1) {
+                size_t mid = low + (high - low) / 2;
+
+                if (idx->starts[mid] <= offset)
+                        low = mid;
+                else
+                        high = mid;
+        }
+
+        return low;
+}
+
+uint64_t lines_start(const struct line_index *idx, size_t line) {
+        return idx->starts[line];
+}
+
+/* End of a line known to lines_has(), without its newline. */
+uint64_t lines_end(const struct line_index *idx, size_t line) {
+        if (line + 1 < idx->count)
+                return idx->starts[line + 1] - 1;
+        return idx->scanned;
+}
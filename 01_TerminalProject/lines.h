@@ -0,0 +1,28 @@
+#ifndef LINES_H
+#define LINES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "source.h"
+
+/*
+ * Start offsets of the lines of a source, found lazily: the source is only
+ * scanned as far as the pager has looked.
+ */
+struct line_index {
+        uint64_t *starts;       /* start of every line found */
+        size_t count;           /* entries of starts */
+        size_t capacity;        /* allocated entries of starts */
+        uint64_t scanned;       /* bytes of the source searched for newlines */
+};
+
+void lines_init(struct line_index *idx);
+void lines_free(struct line_index *idx);
+int lines_has(struct line_index *idx, struct source *src, size_t line);
+size_t lines_total(struct line_index *idx, struct source *src);
+size_t lines_at(struct line_index *idx, struct source *src, uint64_t offset);
+uint64_t lines_start(const struct line_index *idx, size_t line);
+uint64_t lines_end(const struct line_index *idx, size_t line);
+
+#endif
@@ -0,0 +1,293 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "search.h"
+
+/* Bytes searched at a time; also the longest line matched whole. */
+#define CHUNK_SIZE (1 << 20)
+
+/* Matches collected before they are published under the lock. */
+#define FOUND_BATCH 4096
+
+
+int search_init(struct search *search) {
+        memset(search, 0, sizeof(*search));
+        pthread_mutex_init(&search->lock, NULL);
+        return pipe2(search->notify, O_NONBLOCK | O_CLOEXEC);
+}
+
+/* Wake up the UI; a full pipe already means there is news. */
+static void wake(struct search *search) {
+        char c = 0;
+
+        if (write(search->notify[1], &c, 1) < 0 && errno != EAGAIN)
+                return;
+}
+
+static int add_match(struct search *search, uint64_t offset) {
+        if (search->count == search->capacity) {
+                size_t capacity = search->capacity ? 2 * search->capacity : 1024;
+                uint64_t *matches = realloc(search->matches, capacity * sizeof(*matches));
+
+                if (matches == NULL)
+                        return -1;
+                search->matches = matches;
+                search->capacity = capacity;
+        }
+
+        search->matches[search->count++] = offset;
+        return 0;
+}
+
+/*
+ * Find the matching lines of a NUL-terminated chunk made of whole lines,
+ * from *at on, until max are found. The offsets are collected in found,
+ * the caller publishes them; *at is where to go on.
+ */
+static size_t scan_chunk(struct search *search, const char *buf, size_t len, size_t *at,
+                         uint64_t *found, size_t max) {
+        const char *p = buf + *at, *end = buf + len;
+        size_t count = 0;
+
+        while (p < end && count < max) {
+                regmatch_t match;
+
+                /* at a NUL byte inside the data, regexec() stops: go on after it */
+                if (regexec(&search->regex, p, 1, &match, p > buf && p[-1] != '\n' ? REG_NOTBOL : 0) != 0) {
+                        p += strlen(p) + 1;
+                        continue;
+                }
+
+                found[count++] = p - buf + match.rm_so;
+
+                /* one entry per line: go on with the next line */
+                const char *nl = memchr(p + match.rm_so, '\n', end - (p + match.rm_so));
+
+                p = nl ? nl + 1 : end;
+        }
+
+        *at = p - buf;
+        return count;
+}
+
+/*
+ * Search from where the last run stopped to the current end of the source.
+ * The UI is woken when there is news: a run that found no new whole line
+ * leaves everything as it was, unless the source changed meanwhile.
+ */
+static void *worker(void *arg) {
+        struct search *search = arg;
+        struct source *src = search->src;
+        uint64_t found[FOUND_BATCH];
+        int waiting = src->follow;      /* before the size: the data ends at it when not following */
+        uint64_t offset, size = src->size;
+        int failed = 0;
+
+        /* kept for the next runs, until search_destroy() */
+        if (search->buf == NULL && (search->buf = malloc(CHUNK_SIZE + 1)) == NULL)
+                failed = 1;
+
+        char *buf = search->buf;
+
+        pthread_mutex_lock(&search->lock);
+        offset = search->scanned;
+        pthread_mutex_unlock(&search->lock);
+
+        while (!failed && offset < size && !atomic_load(&search->cancel)) {
+                ssize_t n = source_read(src, offset, buf, CHUNK_SIZE);
+
+                if (n <= 0) {
+                        failed = 1;
+                        break;
+                }
+
+                /*
+                 * Cut after the last newline unless the chunk ends the data.
+                 * A followed source may still add to its last line: that one
+                 * waits for the next run.
+                 */
+                size_t len = n;
+
+                if (offset + n < size || waiting) {
+                        char *nl = memrchr(buf, '\n', n);
+
+                        if (nl != NULL)
+                                len = nl - buf + 1;
+                        else if (offset + n == size)
+                                break;
+                }
+                buf[len] = '\0';
+
+                for (size_t at = 0; at < len && !failed && !atomic_load(&search->cancel); ) {
+                        size_t count = scan_chunk(search, buf, len, &at, found, FOUND_BATCH);
+
+                        pthread_mutex_lock(&search->lock);
+                        for (size_t i = 0; i < count && !failed; i++)
+                                failed = add_match(search, offset + found[i]) != 0;
+                        if (at == len)
+                                search->scanned = offset + len;
+                        search->done = 0;
+                        pthread_mutex_unlock(&search->lock);
+                }
+
+                wake(search);
+                offset += len;
+        }
+
+        pthread_mutex_lock(&search->lock);
+        int news = !search->done || failed || src->size > size || (waiting && !src->follow);
+
+        search->failed = failed;
+        search->stopped = size;
+        search->waiting = waiting;
+        search->done = 1;
+        search->active = 0;
+        pthread_mutex_unlock(&search->lock);
+        if (news)
+                wake(search);
+
+        return NULL;
+}
+
+/*
+ * Search the data appended to the source since the worker last stopped,
+ * or its last line once it has ended. Cheap to call whenever the UI wakes.
+ */
+void search_continue(struct search *search) {
+        struct source *src = search->src;
+        int again;
+
+        if (!search->running)
+                return;
+
+        pthread_mutex_lock(&search->lock);
+        again = !search->active && !search->failed && search->scanned < src->size &&
+                (src->size > search->stopped || (search->waiting && !src->follow));
+        search->active = again;
+        pthread_mutex_unlock(&search->lock);
+
+        if (!again)
+                return;
+
+        pthread_join(search->thread, NULL);
+        search->joinable = pthread_create(&search->thread, NULL, worker, search) == 0;
+        if (!search->joinable) {
+                pthread_mutex_lock(&search->lock);
+                search->active = 0;
+                search->done = search->failed = 1;
+                pthread_mutex_unlock(&search->lock);
+        }
+}
+
+/* Cancel the current search, if any, and forget its matches. */
+void search_stop(struct search *search) {
+        if (!search->running)
+                return;
+
+        atomic_store(&search->cancel, 1);
+        if (search->joinable)
+                pthread_join(search->thread, NULL);
+        search->joinable = 0;
+        regfree(&search->regex);
+        search->running = 0;
+
+        free(search->matches);
+        search->matches = NULL;
+        search->count = search->capacity = 0;
+        search->scanned = search->stopped = 0;
+        search->active = search->waiting = 0;
+        search->done = search->failed = 0;
+        search_drain(search);
+}
+
+int search_start(struct search *search, struct source *src, const char *pattern,
+                 char *error, size_t error_size) {
+        int code;
+
+        search_stop(search);
+
+        code = regcomp(&search->regex, pattern, REG_EXTENDED | REG_NEWLINE);
+        if (code != 0) {
+                regerror(code, &search->regex, error, error_size);
+                return -1;
+        }
+
+        search->src = src;
+        search->active = 1;
+        atomic_store(&search->cancel, 0);
+
+        if (pthread_create(&search->thread, NULL, worker, search) != 0) {
+                snprintf(error, error_size, "%s", strerror(errno));
+                search->active = 0;
+                regfree(&search->regex);
+                return -1;
+        }
+
+        search->running = search->joinable = 1;
+        return 0;
+}
+
+void search_destroy(struct search *search) {
+        search_stop(search);
+        free(search->buf);
+        close(search->notify[0]);
+        close(search->notify[1]);
+        pthread_mutex_destroy(&search->lock);
+}
+
+/* Empty the notification pipe once the UI has woken up. */
+void search_drain(struct search *search) {
+        char buf[256];
+
+        while (read(search->notify[0], buf, sizeof(buf)) > 0)
+                ;
+}
+
+size_t search_count(struct search *search, uint64_t *scanned, int *done) {
+        size_t count;
+
+        pthread_mutex_lock(&search->lock);
+        count = search->count;
+        if (scanned)
+                *scanned = search->scanned;
+        if (done)
+                *done = search->done || !search->running;
+        pthread_mutex_unlock(&search->lock);
+
+        return count;
+}
+
+/* Index of the first match at or after offset, search_count() if none yet. */
+size_t search_find(struct search *search, uint64_t offset) {
+        size_t low = 0, high;
+
+        pthread_mutex_lock(&search->lock);
+        high = search->count;
+        while (low < high) {
+                size_t mid = low + (high - low) / 2;
+
+                if (search->matches[mid] < offset)
+                        low = mid + 1;
+                else
+                        high = mid;
+        }
+        pthread_mutex_unlock(&search->lock);
+
+        return low;
+}
+
+uint64_t search_match(struct search *search, size_t index) {
+        uint64_t offset;
+
+        pthread_mutex_lock(&search->lock);
+        offset = search->matches[index];
+        pthread_mutex_unlock(&search->lock);
+
+        return offset;
+}
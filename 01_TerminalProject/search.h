@@ -0,0 +1,51 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <pthread.h>
+#include <regex.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "source.h"
+
+/*
+ * A regular expression search running on a worker thread. The worker
+ * scans the source in large chunks and appends the offset of every
+ * matching line to `matches` as it goes, then wakes the UI through the
+ * `notify` pipe, so the UI only reads what has been found so far.
+ */
+struct search {
+        regex_t regex;          /* pattern, used by the worker only */
+        struct source *src;     /* document searched */
+        pthread_t thread;       /* worker */
+        int running;            /* a search is set up, stopped by search_stop() */
+        int joinable;           /* worker thread to join */
+        int active;             /* the worker has not finished, under lock */
+        atomic_int cancel;      /* asks the worker to stop */
+        int notify[2];          /* pipe written by the worker on progress */
+        char *buf;              /* chunk read by the worker, kept across runs */
+
+        pthread_mutex_t lock;   /* protects the fields below */
+        uint64_t *matches;      /* start of the first match of every matching line */
+        size_t count;           /* entries of matches */
+        size_t capacity;        /* allocated entries of matches */
+        uint64_t scanned;       /* bytes searched so far */
+        uint64_t stopped;       /* source size the worker last stopped at */
+        int waiting;            /* more data could come then: the last line may wait */
+        int done;               /* nothing is left to search for now */
+        int failed;             /* the worker ran out of memory or could not read */
+};
+
+int search_init(struct search *search);
+int search_start(struct search *search, struct source *src, const char *pattern,
+                 char *error, size_t error_size);
+void search_continue(struct search *search);
+void search_stop(struct search *search);
+void search_destroy(struct search *search);
+void search_drain(struct search *search);
+size_t search_count(struct search *search, uint64_t *scanned, int *done);
+size_t search_find(struct search *search, uint64_t offset);
+uint64_t search_match(struct search *search, size_t index);
+
+#endif
@@ -0,0 +1,385 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include "source.h"
+
+/* Unit of the pipe ring buffer. */
+#define CHUNK_SIZE (1 << 20)
+
+/* Bytes taken from a pipe per wakeup, so that keys are not kept waiting. */
+#define READ_BUDGET (8 * CHUNK_SIZE)
+
+#define FILE_EVENTS (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF)
+#define DIR_EVENTS (IN_CREATE | IN_MOVED_TO)
+
+
+/* Open path and take its size and identity. */
+static int open_file(struct source *src, const char *path) {
+        struct stat st;
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0)
+                return -1;
+
+        if (fstat(fd, &st) != 0) {
+                close(fd);
+                return -1;
+        }
+
+        src->fd = fd;
+        src->size = st.st_size;
+        src->dev = st.st_dev;
+        src->ino = st.st_ino;
+        return 0;
+}
+
+/*
+ * Open a file, compressed or not. With keep_index, the checkpoints of a
+ * compressed file are saved next to it as FILE.showidx, and taken from
+ * there the next time.
+ */
+int source_open(struct source *src, const char *path, int keep_index) {
+        char index_path[PATH_MAX];
+        enum compression kind;
+
+        memset(src, 0, sizeof(*src));
+        src->path = path;
+        src->watch = src->file_watch = src->dir_watch = src->spill = src->rotated = -1;
+        if (open_file(src, path) != 0)
+                return -1;
+
+        kind = compress_detect(src->fd);
+        if (kind == COMPRESS_NONE)
+                return 0;
+
+        if (keep_index && snprintf(index_path, sizeof(index_path), "%s.showidx", path) >= (int)sizeof(index_path))
+                keep_index = 0;
+
+        src->z = zfile_open(src->fd, kind, keep_index ? index_path : NULL);
+        if (src->z == NULL) {
+                close(src->fd);
+                return -1;
+        }
+
+        int complete;
+
+        src->size = zfile_size(src->z, &complete);
+        src->follow = !complete;
+        return 0;
+}
+
+/* Page what comes out of a pipe, keeping at most limit bytes of it in memory. */
+int source_open_pipe(struct source *src, int fd, size_t limit) {
+        memset(src, 0, sizeof(*src));
+        src->fd = fd;
+        src->watch = src->file_watch = src->dir_watch = src->spill = src->rotated = -1;
+        src->stream = src->follow = 1;
+        src->slots = limit / CHUNK_SIZE < 2 ? 2 : limit / CHUNK_SIZE;
+        src->chunks = calloc(src->slots, sizeof(*src->chunks));
+        if (src->chunks == NULL)
+                return -1;
+
+        pthread_mutex_init(&src->lock, NULL);
+        return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/* Descriptor telling that the source changed: inotify, the pipe, the decompressor, or -1. */
+int source_poll_fd(const struct source *src) {
+        if (src->z)
+                return src->follow ? zfile_poll_fd(src->z) : -1;
+        if (src->stream)
+                return src->follow ? src->fd : -1;
+        return src->watch;
+}
+
+static int open_spill(void) {
+        const char *dir = getenv("TMPDIR");
+        char path[PATH_MAX];
+        int fd;
+
+        snprintf(path, sizeof(path), "%s/Show.XXXXXX", dir && *dir ? dir : "/tmp");
+        fd = mkostemp(path, O_CLOEXEC);
+        if (fd >= 0)
+                unlink(path);
+        return fd;
+}
+
+/* Move the oldest chunk of a full ring to the spill file. Called locked. */
+static int spill_chunk(struct source *src) {
+        const char *data = src->chunks[src->first];
+        size_t done = 0;
+
+        if (src->spill < 0 && (src->spill = open_spill()) < 0)
+                return -1;
+
+        while (done < CHUNK_SIZE) {
+                ssize_t n = pwrite(src->spill, data + done, CHUNK_SIZE - done, src->spilled + done);
+
+                if (n < 0 && errno == EINTR)
+                        continue;
+                if (n <= 0)
+                        return -1;
+                done += n;
+        }
+
+        src->spilled += CHUNK_SIZE;
+        src->first = (src->first + 1) % src->slots;
+        src->used--;
+        return 0;
+}
+
+/* Read what the pipe has now, without blocking. */
+static void fill(struct source *src) {
+        size_t taken = 0;
+
+        while (src->follow && taken < READ_BUDGET) {
+                uint64_t size = src->size;
+                size_t filled = (size - src->spilled) % CHUNK_SIZE;
+
+                /* a new chunk is needed when the last one is full */
+                if (filled == 0 && size - src->spilled == src->used * (uint64_t)CHUNK_SIZE) {
+                        pthread_mutex_lock(&src->lock);
+                        int failed = src->used == src->slots && spill_chunk(src) != 0;
+                        pthread_mutex_unlock(&src->lock);
+
+                        size_t slot = (src->first + src->used) % src->slots;
+
+                        if (!failed && src->chunks[slot] == NULL)
+                                src->chunks[slot] = malloc(CHUNK_SIZE);
+                        if (failed || src->chunks[slot] == NULL) {
+                                src->follow = 0;
+                                return;
+                        }
+                        src->used++;
+                }
+
+                /* only the space after `size` is written, readers never look there */
+                char *chunk = src->chunks[(src->first + src->used - 1) % src->slots];
+                ssize_t n = read(src->fd, chunk + filled, CHUNK_SIZE - filled);
+
+                if (n < 0 && errno == EINTR)
+                        continue;
+                if (n < 0 && errno != EAGAIN)
+                        src->follow = 0;
+                if (n == 0)
+                        src->follow = 0;
+                if (n <= 0)
+                        return;
+
+                src->size = size + n;
+                taken += n;
+        }
+}
+
+/*
+ * Watch the file for appended data and its directory for a new file of
+ * the same name, which is how log rotation shows up. Returns the inotify
+ * descriptor to poll, or -1.
+ */
+int source_follow(struct source *src) {
+        char dir[PATH_MAX];
+
+        src->watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (src->watch < 0)
+                return -1;
+
+        snprintf(dir, sizeof(dir), "%s", src->path);
+        src->file_watch = inotify_add_watch(src->watch, src->path, FILE_EVENTS);
+        src->dir_watch = inotify_add_watch(src->watch, dirname(dir), DIR_EVENTS);
+
+        if (src->file_watch < 0) {
+                close(src->watch);
+                src->watch = -1;
+                return -1;
+        }
+
+        src->follow = 1;
+        return src->watch;
+}
+
+/*
+ * Read all queued events. Whatever they were, source_update() checks the
+ * file afterwards, so a burst of writes costs one check.
+ */
+void source_drain(struct source *src) {
+        if (src->z) {
+                int complete;
+
+                zfile_drain(src->z);
+                src->size = zfile_size(src->z, &complete);
+                src->follow = !complete;
+                return;
+        }
+
+        if (src->stream) {
+                fill(src);
+                return;
+        }
+
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+        while (read(src->watch, buf, sizeof(buf)) > 0)
+                ;
+}
+
+/* Check the followed file for appended data, truncation or rotation. */
+enum source_change source_update(struct source *src) {
+        struct stat st;
+
+        /* the end of the data also counts: the last line is final now */
+        if (src->stream || src->z) {
+                int changed = src->size != src->reported || (!src->follow && !src->ended);
+
+                src->reported = src->size;
+                src->ended = !src->follow;
+                return changed ? SOURCE_GREW : SOURCE_SAME;
+        }
+
+        /*
+         * A new file under the name: the old one was rotated away. It is
+         * only opened here, source_reset() switches to it once nothing
+         * reads the old one any more.
+         */
+        if (src->rotated < 0 && stat(src->path, &st) == 0 && (st.st_dev != src->dev || st.st_ino != src->ino)) {
+                src->rotated = open(src->path, O_RDONLY | O_CLOEXEC);
+                if (src->rotated >= 0)
+                        return SOURCE_RESET;
+        }
+
+        /* the old file is still read until a new one shows up */
+        if (fstat(src->fd, &st) != 0)
+                return SOURCE_SAME;
+
+        if ((uint64_t)st.st_size < src->size) {
+                src->size = st.st_size;
+                return SOURCE_RESET;
+        }
+
+        if ((uint64_t)st.st_size > src->size) {
+                src->size = st.st_size;
+                return SOURCE_GREW;
+        }
+
+        return SOURCE_SAME;
+}
+
+/*
+ * Go on with the new file of a rotation, if source_update() found one.
+ * Called after SOURCE_RESET, with the search stopped: the old descriptor
+ * is closed, and could be reused by the next open().
+ */
+void source_reset(struct source *src) {
+        int fd = src->rotated;
+        struct stat st;
+
+        if (fd < 0)
+                return;
+
+        src->rotated = -1;
+        if (fstat(fd, &st) != 0) {
+                close(fd);
+                return;
+        }
+
+        close(src->fd);
+        src->fd = fd;
+        src->size = st.st_size;
+        src->dev = st.st_dev;
+        src->ino = st.st_ino;
+        if (src->watch >= 0) {
+                inotify_rm_watch(src->watch, src->file_watch);
+                src->file_watch = inotify_add_watch(src->watch, src->path, FILE_EVENTS);
+        }
+}
+
+/* pread() all of len bytes unless the file ends first. */
+static ssize_t read_fully(int fd, char *buf, size_t len, uint64_t offset) {
+        size_t done = 0;
+
+        while (done < len) {
+                ssize_t n = pread(fd, buf + done, len - done, offset + done);
+
+                if (n < 0 && errno == EINTR)
+                        continue;
+                if (n < 0)
+                        return -1;
+                if (n == 0)
+                        break;
+                done += n;
+        }
+
+        return done;
+}
+
+static ssize_t read_stream(struct source *src, uint64_t offset, char *buf, size_t len) {
+        size_t done = 0;
+
+        pthread_mutex_lock(&src->lock);
+
+        if (offset < src->spilled) {
+                size_t n = src->spilled - offset < len ? src->spilled - offset : len;
+                ssize_t got = read_fully(src->spill, buf, n, offset);
+
+                if (got < (ssize_t)n) {
+                        pthread_mutex_unlock(&src->lock);
+                        return -1;
+                }
+                done = n;
+        }
+
+        while (done < len) {
+                uint64_t at = offset + done - src->spilled;
+                size_t in_chunk = at % CHUNK_SIZE;
+                size_t n = CHUNK_SIZE - in_chunk < len - done ? CHUNK_SIZE - in_chunk : len - done;
+
+                memcpy(buf + done, src->chunks[(src->first + at / CHUNK_SIZE) % src->slots] + in_chunk, n);
+                done += n;
+        }
+
+        pthread_mutex_unlock(&src->lock);
+        return done;
+}
+
+/* Read up to len bytes at offset; short only at the end of the data. */
+ssize_t source_read(struct source *src, uint64_t offset, char *buf, size_t len) {
+        uint64_t size = src->size;
+
+        if (offset >= size)
+                return 0;
+        if (len > size - offset)
+                len = size - offset;
+
+        if (src->z)
+                return zfile_read(src->z, offset, buf, len);
+        if (src->stream)
+                return read_stream(src, offset, buf, len);
+        return read_fully(src->fd, buf, len, offset);
+}
+
+void source_close(struct source *src) {
+        if (src->z)
+                zfile_close(src->z);
+        if (src->watch >= 0)
+                close(src->watch);
+        if (src->spill >= 0)
+                close(src->spill);
+        if (src->rotated >= 0)
+                close(src->rotated);
+        if (src->stream) {
+                for (size_t i = 0; i < src->slots; i++)
+                        free(src->chunks[i]);
+                free(src->chunks);
+                pthread_mutex_destroy(&src->lock);
+        }
+        close(src->fd);
+}
@@ -0,0 +1,66 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "compress.h"
+
+/*
+ * Bytes of the paged document, read by offset from any thread.
+ *
+ * A file is read where it lies. A pipe can not be read twice, so what
+ * comes out of it is kept in a ring of chunks of at most `limit` bytes;
+ * when the ring is full its oldest chunk is spilled to an unlinked
+ * temporary file, where source_read() still finds it.
+ *
+ * A gzip or zstd file is paged decompressed: while a worker goes through
+ * it the source grows like a followed file, and reads resume from the
+ * decompression checkpoint nearest to them.
+ */
+struct source {
+        int fd;                 /* open file, or the pipe */
+        _Atomic uint64_t size;  /* bytes available, grows when following */
+        const char *path;       /* name the file was opened with, NULL for a pipe */
+        dev_t dev;              /* identity of the open file, to notice a rotation */
+        ino_t ino;
+        int rotated;            /* new file under the name, until source_reset() takes it, else -1 */
+        int follow;             /* more data may come: the last line is not final */
+        int watch;              /* inotify descriptor when following a file, else -1 */
+        int file_watch;         /* watch of the file itself */
+        int dir_watch;          /* watch of its directory, for a new file of that name */
+        struct zfile *z;        /* decompressor of a compressed file, else NULL */
+        uint64_t reported;      /* size at the last source_update(), pipe or compressed */
+        int ended;              /* source_update() has seen the end of the data */
+
+        /* pipe input only */
+        int stream;             /* reading a pipe */
+        pthread_mutex_t lock;   /* protects the ring against readers while it moves */
+        char **chunks;          /* ring of chunks, allocated as needed */
+        size_t slots;           /* chunks in the ring */
+        size_t first;           /* slot holding the byte at `spilled` */
+        size_t used;            /* slots holding data */
+        uint64_t spilled;       /* bytes before this offset are in the spill file */
+        int spill;              /* unlinked temporary file, -1 until needed */
+};
+
+/* What source_update() found. */
+enum source_change {
+        SOURCE_SAME,            /* nothing to do */
+        SOURCE_GREW,            /* data was appended */
+        SOURCE_RESET,           /* truncated or replaced: source_reset(), then start over */
+};
+
+int source_open(struct source *src, const char *path, int keep_index);
+int source_open_pipe(struct source *src, int fd, size_t limit);
+int source_follow(struct source *src);
+int source_poll_fd(const struct source *src);
+void source_drain(struct source *src);
+enum source_change source_update(struct source *src);
+void source_reset(struct source *src);
+ssize_t source_read(struct source *src, uint64_t offset, char *buf, size_t len);
+void source_close(struct source *src);
+
+#endif
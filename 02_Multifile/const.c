@@ -1 +1,4 @@
-int Count=0;
\ No newline at end of file
+#include <stdatomic.h>
+
+/* Number of the next output line, shared by all threads */
+atomic_int Count=0;
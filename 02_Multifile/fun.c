@@ -1,9 +1,64 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <unistd.h>
 #include "outlib.h"
 #define PROGNAME "prog"
 
+/* Longest "%d: " prefix */
+#define PREFIX_MAX 16
+
+ void count_set(int value) {
+     atomic_store(&Count, value);
+    }
+
+ int count_get(void) {
+     return atomic_load(&Count);
+    }
+
+/* Reserve n consecutive line numbers, return the first one */
+ int count_take(int n) {
+     return atomic_fetch_add_explicit(&Count, n, memory_order_relaxed);
+    }
+
  void output(char *str) {
-     printf("%d: %s\012", Count++, str);
+     /* one printf per line: stdio locks the stream around it */
+     printf("%d: %s\012", count_take(1), str);
+    }
+
+/* Print n lines with consecutive numbers in a single write() */
+ int output_batch(char **strs, int n) {
+     size_t size = 0, len = 0;
+     char *buf, *p;
+     int first, i;
+
+     for(i=0; i<n; i++)
+         size += PREFIX_MAX + strlen(strs[i]) + 1;
+     if((buf = malloc(size + 1)) == NULL)
+         return -1;
+
+     first = count_take(n);
+     for(i=0; i<n; i++)
+         len += sprintf(buf + len, "%d: %s\012", first + i, strs[i]);
+
+     /* keep the stream locked so that no printf() ends up half written around the batch */
+     flockfile(stdout);
+     fflush(stdout);
+     for(p = buf; len > 0; ) {
+         ssize_t done = write(STDOUT_FILENO, p, len);
+         if(done < 0) {
+             if(errno == EINTR)
+                 continue;
+             break;
+         }
+         p += done;
+         len -= done;
+     }
+     funlockfile(stdout);
+     free(buf);
+     return len > 0 ? -1 : 0;
     }
 
 void usage(char *prog) {
@@ -1,4 +1,9 @@
+#include <stdatomic.h>
 void output(char *);
+int output_batch(char **, int);
 void usage(char *);
-extern int Count;
+void count_set(int);
+int count_get(void);
+int count_take(int);
+extern atomic_int Count;
 #define VERSION 0.0
\ No newline at end of file
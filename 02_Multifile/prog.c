@@ -1,12 +1,23 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include "outlib.h"
 
 int main(int argc, char *argv[]) {
+    char **lines;
     int i;
-    if((Count = argc)>1) {
-        output("<INIT>");
+    if(argc>1) {
+        count_set(argc);
+        if((lines = malloc((argc+1) * sizeof(*lines))) == NULL)
+            return 1;
+        lines[0] = "<INIT>";
         for(i=1; i<argc; i++)
-        output(argv[i]);
-        output("<DONE>");
+        lines[i] = argv[i];
+        lines[argc] = "<DONE>";
+        if(output_batch(lines, argc+1) != 0) {
+            perror("write");
+            return 1;
+        }
+        free(lines);
     }
     else
         usage(argv[0]);
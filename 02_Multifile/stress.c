@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "outlib.h"
+
+#define BATCH 16
+
+int Items = 10000;
+
+/* Every thread prints Items lines, alternating output() and output_batch() */
+void *worker(void *arg) {
+    long id = (long)arg;
+    char text[BATCH][32];
+    char *lines[BATCH];
+    int i, j;
+
+    for(i=0; i<Items; ) {
+        if((i / BATCH) % 2 == 0) {
+            snprintf(text[0], sizeof(text[0]), "thread %ld line %d", id, i);
+            output(text[0]);
+            i++;
+            continue;
+        }
+        for(j=0; j<BATCH && i<Items; j++, i++) {
+            snprintf(text[j], sizeof(text[j]), "thread %ld line %d", id, i);
+            lines[j] = text[j];
+        }
+        if(output_batch(lines, j) != 0) {
+            perror("write");
+            exit(1);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    pthread_t threads[64];
+    long n = 8, i;
+
+    if(argc > 1)
+        n = atoi(argv[1]);
+    if(argc > 2)
+        Items = atoi(argv[2]);
+    if(n < 1 || n > 64 || Items < 0) {
+        fprintf(stderr, "Usage: %s [threads (1-64) [lines per thread]]\012", argv[0]);
+        return 1;
+    }
+
+    for(i=0; i<n; i++)
+        if(pthread_create(&threads[i], NULL, worker, (void *)i) != 0) {
+            fprintf(stderr, "Cannot start thread %ld\012", i);
+            return 1;
+        }
+    for(i=0; i<n; i++)
+        pthread_join(threads[i], NULL);
+    fflush(stdout);
+    fprintf(stderr, "%d lines\012", count_get());
+    return 0;
+}
@@ -0,0 +1,304 @@
+/*
+ * randomize: print standard input on a cleared terminal one character at
+ * a time, in random order.
+ *
+ * Compiled replacement of randomize.sh. The visible characters are packed
+ * into 64-bit integers (byte offset, row, column) and shuffled with
+ * Fisher–Yates. Drawing goes through terminfo, like the curses setup of
+ * Show.c, but the cursor moves and characters of a frame are collected in
+ * one buffer and written at once. Frames follow CLOCK_MONOTONIC: with a
+ * delay per character, each frame shows every character that is due by
+ * then, so a short delay is not rounded up to the frame rate.
+ *
+ * Usage: randomize [-s] [delay] < file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <curses.h>
+#include <term.h>
+
+/* Shortest time between two frames: 60 frames per second. */
+#define FRAME_NS 16666667LL
+
+#define OUTPUT_SIZE (1 << 16)
+
+/* Packed glyph: byte offset in the text, row and column. */
+#define GLYPH(offset, row, col) ((uint64_t)(offset) << 32 | (uint64_t)(row) << 16 | (col))
+#define GLYPH_OFFSET(g) ((uint32_t)((g) >> 32))
+#define GLYPH_ROW(g) ((unsigned)((g) >> 16) & 0xffff)
+#define GLYPH_COL(g) ((unsigned)(g) & 0xffff)
+
+static char output[OUTPUT_SIZE];
+static size_t output_len = 0;
+
+/* Cursor position after the last output, -1 if unknown. */
+static int cursor_row = -1, cursor_col = -1;
+
+static void flush_output(void) {
+    size_t done = 0;
+
+    while (done < output_len) {
+        ssize_t written = write(STDOUT_FILENO, output + done, output_len - done);
+
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("write");
+            exit(1);
+        }
+        done += written;
+    }
+
+    output_len = 0;
+}
+
+static void put_bytes(const char *data, size_t len) {
+    if (OUTPUT_SIZE - output_len < len)
+        flush_output();
+    memcpy(output + output_len, data, len);
+    output_len += len;
+}
+
+static void move_to(int row, int col) {
+    if (row == cursor_row && col == cursor_col)
+        return;
+
+    const char *cup = tiparm(cursor_address, row, col);
+
+    put_bytes(cup, strlen(cup));
+    cursor_row = row;
+    cursor_col = col;
+}
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void sleep_until(int64_t deadline) {
+    struct timespec ts = { deadline / 1000000000, deadline % 1000000000 };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+/* splitmix64, seeded from the clock and the process id. */
+static uint64_t random_state;
+
+static uint64_t random_next(void) {
+    uint64_t z = (random_state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Uniform value below bound, without modulo bias (Lemire). */
+static uint64_t random_below(uint64_t bound) {
+    unsigned __int128 m = (unsigned __int128)random_next() * bound;
+
+    if ((uint64_t)m < bound) {
+        uint64_t threshold = -bound % bound;
+
+        while ((uint64_t)m < threshold)
+            m = (unsigned __int128)random_next() * bound;
+    }
+
+    return m >> 64;
+}
+
+static char *read_all(FILE *file, size_t *len) {
+    size_t capacity = 65536;
+    char *text = malloc(capacity);
+
+    *len = 0;
+    while (text) {
+        *len += fread(text + *len, 1, capacity - *len, file);
+        if (*len < capacity)
+            break;
+
+        char *grown = realloc(text, capacity * 2);
+
+        if (!grown)
+            free(text);
+        text = grown;
+        capacity *= 2;
+    }
+
+    if (text && ferror(file)) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/* Length of the UTF-8 sequence starting with byte c. */
+static unsigned sequence_length(unsigned char c) {
+    if (c < 0xc0)
+        return 1;
+    return c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+}
+
+/*
+ * Collect the glyphs that are not white space, one per column. Returns
+ * their number, sets rows to the number of lines.
+ */
+static size_t collect_glyphs(const char *text, size_t len, uint64_t *glyphs, unsigned *rows) {
+    size_t count = 0;
+    unsigned row = 0, col = 0;
+
+    for (size_t i = 0; i < len; ) {
+        unsigned char c = text[i];
+        unsigned n = sequence_length(c);
+
+        if (n > len - i)
+            n = len - i;
+
+        if (c == '\n') {
+            row++;
+            col = 0;
+        } else {
+            /* a terminal can not address more than 16 bits anyway */
+            if (c != ' ' && c != '\t' && c != '\r' && c != '\v' && c != '\f' && row <= 0xffff && col <= 0xffff)
+                glyphs[count++] = GLYPH(i, row, col);
+            col++;
+        }
+        i += n;
+    }
+
+    *rows = row + (len > 0 && text[len - 1] != '\n');
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    double delay = 0;
+    int stats = 0, opt, error;
+
+    while ((opt = getopt(argc, argv, "s")) != -1) {
+        if (opt != 's') {
+            fprintf(stderr, "Usage: %s [-s] [delay] < file\n", argv[0]);
+            return 1;
+        }
+        stats = 1;
+    }
+
+    if (optind < argc) {
+        char *end;
+
+        delay = strtod(argv[optind], &end);
+        if (end == argv[optind] || *end != '\0' || delay < 0)
+            delay = 0;
+    }
+
+    size_t len;
+    char *text = read_all(stdin, &len);
+
+    if (!text) {
+        fprintf(stderr, "Error: failed to read input.\n");
+        return 1;
+    }
+    if (len > UINT32_MAX) {
+        fprintf(stderr, "Error: input is too large.\n");
+        return 1;
+    }
+
+    /* at most one glyph per byte */
+    uint64_t *glyphs = malloc((len ? len : 1) * sizeof(*glyphs));
+    unsigned rows;
+
+    if (!glyphs) {
+        fprintf(stderr, "Error: out of memory.\n");
+        return 1;
+    }
+
+    size_t count = collect_glyphs(text, len, glyphs, &rows);
+
+    random_state = (uint64_t)now_ns() ^ (uint64_t)getpid() << 32;
+    for (size_t i = count; i > 1; i--) {
+        size_t j = random_below(i);
+        uint64_t tmp = glyphs[i - 1];
+
+        glyphs[i - 1] = glyphs[j];
+        glyphs[j] = tmp;
+    }
+
+    if (setupterm(NULL, STDOUT_FILENO, &error) != OK || !cursor_address) {
+        fprintf(stderr, "Error: the terminal can not move the cursor.\n");
+        return 1;
+    }
+
+    if (clear_screen)
+        put_bytes(clear_screen, strlen(clear_screen));
+    cursor_row = cursor_col = 0;
+
+    int64_t delay_ns = (int64_t)(delay * 1e9);
+    int64_t start = now_ns(), frame_time = start;
+    int64_t render_ns = 0, max_render_ns = 0;
+    unsigned long frames = 0;
+    size_t shown = 0;
+
+    while (shown < count) {
+        /* every character whose time has come, at least one per frame */
+        size_t due = count;
+
+        if (delay_ns > 0) {
+            due = (frame_time - start) / delay_ns + 1;
+            if (due > count)
+                due = count;
+        }
+
+        int64_t render_start = now_ns();
+
+        for (; shown < due; shown++) {
+            uint64_t glyph = glyphs[shown];
+            uint32_t offset = GLYPH_OFFSET(glyph);
+            unsigned n = sequence_length(text[offset]);
+
+            if (n > len - offset)
+                n = len - offset;
+            move_to(GLYPH_ROW(glyph), GLYPH_COL(glyph));
+            put_bytes(text + offset, n);
+            cursor_col++;
+        }
+        flush_output();
+
+        int64_t spent = now_ns() - render_start;
+
+        render_ns += spent;
+        if (spent > max_render_ns)
+            max_render_ns = spent;
+        frames++;
+
+        if (shown < count) {
+            /* wake up for the next character, but not before the next frame */
+            int64_t next = start + (int64_t)shown * delay_ns;
+
+            if (next < frame_time + FRAME_NS)
+                next = frame_time + FRAME_NS;
+            sleep_until(next);
+            frame_time = now_ns();
+        }
+    }
+
+    move_to(rows, 0);
+    flush_output();
+
+    if (stats) {
+        fprintf(stderr, "%zu characters, %lu frames in %.3f s\n",
+                count, frames, (now_ns() - start) / 1e9);
+        fprintf(stderr, "render %.1f us per frame on average, %.1f us at most\n",
+                frames ? render_ns / 1e3 / frames : 0.0, max_render_ns / 1e3);
+    }
+
+    free(glyphs);
+    free(text);
+    return 0;
+}
@@ -1,45 +1,340 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
-void display(int value) {
-    printf("%d\n", value);
+/* Output is collected here and written with write() when full. */
+#define OUTPUT_SIZE (1 << 20)
+
+/* Longest line: "-9223372036854775808\n". */
+#define LINE_MAX_LEN 21
+
+/* Values formatted by a worker at a time in parallel mode. */
+#define CHUNK_VALUES 65536
+
+/* Shortest range split between threads, smaller ones are not worth it. */
+#define PARALLEL_MIN_VALUES (4 * CHUNK_VALUES)
+
+#define MAX_THREADS 256
+
+static char output[OUTPUT_SIZE];
+static size_t output_len = 0;
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += written;
+        len -= written;
+    }
+
+    return 0;
+}
+
+int pwrite_all(int fd, const char *data, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t written = pwrite(fd, data, len, offset);
+
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += written;
+        len -= written;
+        offset += written;
+    }
+
+    return 0;
+}
+
+void flush(void) {
+    if (write_all(STDOUT_FILENO, output, output_len) != 0) {
+        perror("write");
+        exit(1);
+    }
+
+    output_len = 0;
 }
 
+/* Number of decimal digits of value. */
+static unsigned count_digits(uint64_t value) {
+    unsigned digits = 1;
 
-void range(int start, int stop, int step) {
-    int size = 0;
-    
-    if ((step > 0 && start < stop) || (step < 0 && start > stop)) {
-        size = (stop - start + step - (step > 0 ? 1 : -1)) / step;
+    while (value >= 10000) {
+        value /= 10000;
+        digits += 4;
     }
-    
-    for (int i = 0, val = start; i < size; i++, val += step) {
-        display(val);
+
+    return digits + (value >= 10) + (value >= 100) + (value >= 1000);
+}
+
+/* Write the digits of value so that the last one is just before end. */
+static void format_decimal(char *end, uint64_t value) {
+    while (value >= 100) {
+        unsigned pair = (value % 100) * 2;
+        value /= 100;
+        *--end = digit_pairs[pair + 1];
+        *--end = digit_pairs[pair];
+    }
+
+    if (value >= 10) {
+        *--end = digit_pairs[value * 2 + 1];
+        *--end = digit_pairs[value * 2];
+    } else {
+        *--end = '0' + value;
     }
 }
 
+/* Write value and a newline at line, return the number of bytes. */
+static unsigned format_value(char *line, int64_t value) {
+    /* negate in unsigned arithmetic, so INT64_MIN works too */
+    uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    unsigned len = (value < 0) + count_digits(magnitude);
+
+    line[0] = '-';
+    format_decimal(line + len, magnitude);
+    line[len] = '\n';
+    return len + 1;
+}
+
+void display(int64_t value) {
+    if (OUTPUT_SIZE - output_len < LINE_MAX_LEN)
+        flush();
+
+    output_len += format_value(output + output_len, value);
+}
+
+/* Number of values of the range, computed without overflow. */
+uint64_t range_size(int64_t start, int64_t stop, int64_t step) {
+    /* distances are taken in unsigned arithmetic, they may not fit in int64_t */
+    if (step > 0 && start < stop)
+        return ((uint64_t)stop - (uint64_t)start - 1) / (uint64_t)step + 1;
+    if (step < 0 && start > stop)
+        return ((uint64_t)start - (uint64_t)stop - 1) / -(uint64_t)step + 1;
+    return 0;
+}
+
+void range(int64_t start, int64_t stop, int64_t step) {
+    uint64_t size = range_size(start, stop, step);
+
+    /* the value after the last one may overflow, so it is never computed in int64_t */
+    uint64_t val = (uint64_t)start;
+
+    for (uint64_t i = 0; i < size; i++, val += (uint64_t)step) {
+        display((int64_t)val);
+    }
+
+    flush();
+}
+
+/*
+ * Parallel mode: the range is cut into chunks of CHUNK_VALUES values that
+ * the workers claim in order. A worker formats its chunk into a private
+ * buffer, then waits for its turn, when the previous chunk is placed:
+ *  - a regular file gets the chunk with pwrite() at the offset where the
+ *    previous one ends, so the workers only take turns to book offsets
+ *    and the writes themselves overlap;
+ *  - anything else (pipe, terminal, O_APPEND file) gets it with write()
+ *    while holding the turn.
+ */
+struct range_job {
+    uint64_t start;          /* first value, as unsigned */
+    uint64_t step;           /* step, as unsigned */
+    uint64_t size;           /* number of values */
+    uint64_t chunks;         /* number of chunks */
+    int fd;                  /* output */
+    int seekable;            /* output takes pwrite() */
+    off_t offset;            /* where the next chunk goes, if seekable */
+    uint64_t next;           /* next chunk to claim */
+    uint64_t turn;           /* next chunk to place */
+    int failed;              /* errno of a failed write, or 0 */
+    pthread_mutex_t lock;
+    pthread_cond_t placed;
+};
+
+static void *range_worker(void *arg) {
+    struct range_job *job = arg;
+    char *buffer = malloc((size_t)CHUNK_VALUES * LINE_MAX_LEN);
+
+    pthread_mutex_lock(&job->lock);
+    if (!buffer && !job->failed)
+        job->failed = ENOMEM;
+
+    /* a worker keeps claiming chunks after a failure to let the others go */
+    while (job->next < job->chunks) {
+        uint64_t chunk = job->next++;
+        uint64_t first = chunk * CHUNK_VALUES;
+        uint64_t count = job->size - first < CHUNK_VALUES ? job->size - first : CHUNK_VALUES;
+        uint64_t val = job->start + first * job->step;
+        size_t len = 0;
+
+        pthread_mutex_unlock(&job->lock);
+
+        if (buffer) {
+            for (uint64_t i = 0; i < count; i++, val += job->step)
+                len += format_value(buffer + len, (int64_t)val);
+        }
+
+        pthread_mutex_lock(&job->lock);
+        while (job->turn != chunk)
+            pthread_cond_wait(&job->placed, &job->lock);
+
+        if (job->failed) {
+            job->turn++;
+        } else if (job->seekable) {
+            off_t offset = job->offset;
+
+            job->offset += len;
+            job->turn++;
+            pthread_cond_broadcast(&job->placed);
+            pthread_mutex_unlock(&job->lock);
+
+            int error = pwrite_all(job->fd, buffer, len, offset) != 0 ? errno : 0;
+
+            pthread_mutex_lock(&job->lock);
+            if (error && !job->failed)
+                job->failed = error;
+            continue;
+        } else if (write_all(job->fd, buffer, len) != 0) {
+            job->failed = errno;
+            job->turn++;
+        } else {
+            job->turn++;
+        }
+        pthread_cond_broadcast(&job->placed);
+    }
+
+    pthread_mutex_unlock(&job->lock);
+    free(buffer);
+    return NULL;
+}
+
+void range_parallel(int64_t start, int64_t stop, int64_t step, unsigned threads) {
+    uint64_t size = range_size(start, stop, step);
+    pthread_t workers[MAX_THREADS];
+    struct range_job job = {
+        .start = (uint64_t)start,
+        .step = (uint64_t)step,
+        .size = size,
+        .chunks = (size + CHUNK_VALUES - 1) / CHUNK_VALUES,
+        .fd = STDOUT_FILENO,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .placed = PTHREAD_COND_INITIALIZER,
+    };
+    struct stat st;
+
+    if (threads <= 1 || size < PARALLEL_MIN_VALUES) {
+        range(start, stop, step);
+        return;
+    }
+
+    if (fstat(job.fd, &st) == 0 && S_ISREG(st.st_mode) && !(fcntl(job.fd, F_GETFL) & O_APPEND)) {
+        job.offset = lseek(job.fd, 0, SEEK_CUR);
+        job.seekable = job.offset >= 0;
+    }
+
+    /* the main thread is a worker too; fewer threads than asked is fine */
+    unsigned started = 0;
+
+    while (started < threads - 1 && pthread_create(&workers[started], NULL, range_worker, &job) == 0)
+        started++;
+
+    range_worker(&job);
+
+    for (unsigned i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    if (job.failed) {
+        errno = job.failed;
+        perror("write");
+        exit(1);
+    }
+
+    /* leave the file offset after the output, as write() would */
+    if (job.seekable)
+        lseek(job.fd, job.offset, SEEK_SET);
+}
+
+int parse(const char *str, int64_t *value) {
+    char *end;
+
+    errno = 0;
+    long long parsed = strtoll(str, &end, 10);
+
+    if (errno != 0 || end == str || *end != '\0') {
+        fprintf(stderr, "Invalid number: %s\n", str);
+        return -1;
+    }
+
+    *value = parsed;
+    return 0;
+}
+
 
 int main(int argc, char* argv[]) {
-    int start = 0, stop = 0, step = 1;
+    int64_t start = 0, stop = 0, step = 1;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* not getopt(): negative numbers would be taken for options */
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        int64_t value;
+
+        if (parse(argv[2], &value) != 0)
+            return 1;
+        if (value < 1 || value > MAX_THREADS) {
+            fprintf(stderr, "Thread count must be between 1 and %d\n", MAX_THREADS);
+            return 1;
+        }
+        threads = value;
+        argv += 2;
+        argc -= 2;
+    }
 
     if (argc == 2) {
-        stop = atoi(argv[1]);
+        if (parse(argv[1], &stop) != 0)
+            return 1;
     } else if (argc == 3) {
-        start = atoi(argv[1]);
-        stop = atoi(argv[2]);
+        if (parse(argv[1], &start) != 0 || parse(argv[2], &stop) != 0)
+            return 1;
     } else if (argc == 4) {
-        start = atoi(argv[1]);
-        stop = atoi(argv[2]);
-        step = atoi(argv[3]);
+        if (parse(argv[1], &start) != 0 || parse(argv[2], &stop) != 0 || parse(argv[3], &step) != 0)
+            return 1;
     } else {
-        fprintf(stderr, "Usage: %s stop\n", argv[0]);
-        fprintf(stderr, "   or: %s start stop\n", argv[0]);
-        fprintf(stderr, "   or: %s start stop step\n", argv[0]);
+        fprintf(stderr, "Usage: %s [-j threads] stop\n", argv[0]);
+        fprintf(stderr, "   or: %s [-j threads] start stop\n", argv[0]);
+        fprintf(stderr, "   or: %s [-j threads] start stop step\n", argv[0]);
         return 1;
     }
-    
-    range(start, stop, step);
-    
+
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+
+    range_parallel(start, stop, step, threads);
+
     return 0;
 }
-
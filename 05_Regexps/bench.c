@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <regex.h>
+
+#include "dfa.h"
+
+#define MAX_GR 10
+
+/* Lines of the generated log corpus. */
+#define CORPUS_LINES 20000
+
+/* Longest time spent on one engine for one case. */
+#define BUDGET 0.3
+
+/* A single match of regexec() longer than this ends a pathological series. */
+#define SLOW_CALL 1.0
+
+/* Patterns a substitution is typically run with, over the log corpus line by line. */
+static const char *typical[] = {
+    "Failed password",
+    "([0-9]{1,3}\\.){3}[0-9]{1,3}",
+    "^([0-9-]+) ([0-9:]+) ([a-z0-9]+) ([a-z]+)\\[([0-9]+)\\]",
+    "user=([a-z_]+)",
+    "(error|warning|critical|failed)",
+    "timeout after [0-9]+ ms",
+};
+
+/*
+ * Patterns that make a backtracking or set-simulating matcher superlinear,
+ * over one long text, or that make it read to the end of the text for
+ * every match of s///g.
+ */
+static const struct {
+    const char *pattern;
+    const char *text;       /* repeated to the length wanted */
+    int global;             /* every match, not the first */
+} pathological[] = {
+    { "(a|aa)*b", "a", 0 },
+    { "(a|a)*b", "a", 0 },
+    { "(.*)(.*)(.*)(.*)(.*)X", "a", 0 },
+    { "[a-q][^u-z]{13}x", "abcdefghijklmnopqrstuvwxyz", 0 },
+    { "a(.*b)?", "a", 1 },
+};
+
+static const size_t sizes[] = { 1 << 10, 1 << 12, 1 << 14, 1 << 16 };
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *make_corpus(size_t *len) {
+    static const char *hosts[] = { "web01", "web02", "db1", "cache3" };
+    static const char *daemons[] = { "sshd", "cron", "nginx", "kernel" };
+    static const char *messages[] = {
+        "Failed password for root from %d.%d.%d.%d port %d ssh2",
+        "Accepted publickey for user=deploy from %d.%d.%d.%d port %d",
+        "session opened for user=www_data by (uid=%d) pid %d.%d.%d %d",
+        "upstream error: connection reset, retry %d of %d (%d.%d) %d",
+        "GET /index.html?id=%d HTTP/1.1 200 %d bytes %d.%d ms %d",
+    };
+    size_t capacity = CORPUS_LINES * 128;
+    char *corpus = malloc(capacity);
+
+    if (!corpus)
+        return NULL;
+
+    *len = 0;
+    srand(1);
+    for (int i = 0; i < CORPUS_LINES; i++) {
+        int n = snprintf(corpus + *len, capacity - *len, "2024-05-%02d %02d:%02d:%02d %s %s[%d]: ",
+                         1 + i % 28, i / 3600 % 24, i / 60 % 60, i % 60,
+                         hosts[rand() % 4], daemons[rand() % 4], 100 + rand() % 30000);
+
+        *len += n;
+        n = snprintf(corpus + *len, capacity - *len, messages[rand() % 5],
+                     rand() % 256, rand() % 256, rand() % 256, rand() % 256, 1024 + rand() % 60000);
+        *len += n;
+        corpus[(*len)++] = '\n';
+    }
+    return corpus;
+}
+
+/* Find every match of text[0, len), one after the other as s///g does. */
+static void match_all(regex_t *regex, struct dfa *dfa, const char *text, size_t len) {
+    regmatch_t matches[MAX_GR];
+
+    if (dfa && dfa_start(dfa, text, len, 0) != 0)
+        return;
+    for (size_t at = 0; at <= len; ) {
+        int code;
+
+        if (dfa) {
+            code = dfa_next(dfa, at, MAX_GR, matches);
+        } else {
+            matches[0].rm_so = at;
+            matches[0].rm_eo = len;
+            code = regexec(regex, text, MAX_GR, matches, (at > 0 ? REG_NOTBOL : 0) | REG_STARTEND);
+        }
+        if (code != 0)
+            break;
+        at = matches[0].rm_eo > matches[0].rm_so ? (size_t)matches[0].rm_eo : (size_t)matches[0].rm_eo + 1;
+    }
+}
+
+/*
+ * Bytes per second matching each line of text, each engine getting the
+ * same lines: the first match, or all of them if global.
+ */
+static double run(const char *pattern, const char *text, size_t len, int lines, int global, int use_dfa,
+                  double *slowest) {
+    regex_t regex;
+    struct dfa *dfa = NULL;
+    char errbuf[256];
+    regmatch_t matches[MAX_GR];
+    size_t bytes = 0;
+    double start = now(), elapsed;
+    int code = 0;
+
+    if (use_dfa)
+        dfa = dfa_compile(pattern, errbuf, sizeof(errbuf));
+    else if ((code = regcomp(&regex, pattern, REG_EXTENDED)) != 0)
+        regerror(code, &regex, errbuf, sizeof(errbuf));
+
+    if (use_dfa ? !dfa : code != 0) {
+        fprintf(stderr, "%s: %s\n", pattern, errbuf);
+        exit(1);
+    }
+
+    *slowest = 0;
+    do {
+        for (size_t at = 0; at < len; ) {
+            const char *end = lines ? memchr(text + at, '\n', len - at) : NULL;
+            size_t n = end ? (size_t)(end - text - at) : len - at;
+            double call = now();
+
+            if (global) {
+                match_all(use_dfa ? NULL : &regex, dfa, text + at, n);
+            } else if (use_dfa) {
+                dfa_exec(dfa, text + at, n, MAX_GR, matches, 0);
+            } else {
+                matches[0].rm_so = at;
+                matches[0].rm_eo = at + n;
+                regexec(&regex, text, MAX_GR, matches, REG_STARTEND);
+            }
+
+            call = now() - call;
+            if (call > *slowest)
+                *slowest = call;
+            at += n + 1;
+        }
+        bytes += len;
+        elapsed = now() - start;
+    } while (elapsed < BUDGET);
+
+    if (use_dfa)
+        dfa_free(dfa);
+    else
+        regfree(&regex);
+    return bytes / elapsed;
+}
+
+int main(void) {
+    size_t len;
+    char *corpus = make_corpus(&len);
+    double slowest;
+
+    if (!corpus) {
+        perror("malloc");
+        return 1;
+    }
+
+    printf("Typical patterns, %d log lines (%.1f MB), line by line, MB/s:\n", CORPUS_LINES, len / 1e6);
+    printf("%-56s %10s %10s\n", "pattern", "regexec", "dfa");
+    for (size_t i = 0; i < sizeof(typical) / sizeof(typical[0]); i++) {
+        double re = run(typical[i], corpus, len, 1, 0, 0, &slowest);
+        double dfa = run(typical[i], corpus, len, 1, 0, 1, &slowest);
+
+        printf("%-56s %10.1f %10.1f\n", typical[i], re / 1e6, dfa / 1e6);
+    }
+    free(corpus);
+
+    printf("\nPathological patterns, one text, MB/s:\n");
+    printf("%-56s %10s %10s\n", "pattern, text length", "regexec", "dfa");
+    for (size_t i = 0; i < sizeof(pathological) / sizeof(pathological[0]); i++) {
+        int slow = 0;
+
+        for (size_t j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+            size_t unit = strlen(pathological[i].text);
+            char *text = malloc(sizes[j] + 1);
+            char name[80];
+
+            if (!text) {
+                perror("malloc");
+                return 1;
+            }
+            for (size_t k = 0; k < sizes[j]; k++)
+                text[k] = pathological[i].text[k % unit];
+            text[sizes[j]] = '\0';
+
+            snprintf(name, sizeof(name), "%s%s, %zu", pathological[i].pattern,
+                     pathological[i].global ? " (all)" : "", sizes[j]);
+            printf("%-56s ", name);
+            if (slow) {
+                printf("%10s ", "-");
+            } else {
+                printf("%10.3f ", run(pathological[i].pattern, text, sizes[j], 0, pathological[i].global, 0,
+                                      &slowest) / 1e6);
+                slow = slowest > SLOW_CALL;
+            }
+            printf("%10.3f\n", run(pathological[i].pattern, text, sizes[j], 0, pathological[i].global, 1,
+                                  &slowest) / 1e6);
+            fflush(stdout);
+            free(text);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,462 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "chunks.h"
+
+/* Chunks in flight per worker: read ahead, being substituted or waiting to be written. */
+#define SLOTS_PER_WORKER 3
+
+enum slot_state { SLOT_FREE, SLOT_READY, SLOT_DONE };
+
+struct slot {
+    const char *in;
+    size_t len;
+    struct buffer read;         /* the chunk, when the input is not mapped */
+    struct buffer out;
+    int changed;                /* a line of the chunk was substituted */
+    int error;
+    enum slot_state state;
+};
+
+struct input {
+    int fd;
+    const char *name;
+    const char *map;            /* the whole input, if it could be mapped */
+    size_t size;
+    size_t offset;              /* of the next chunk in map */
+    struct buffer carry;        /* a line begun at the end of the last chunk read */
+    int eof;
+};
+
+/* Slots are taken in turn: read at next_read, substituted at next_work, written at next_write. */
+struct pool {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;       /* a chunk to substitute, or the end of the input */
+    pthread_cond_t done;        /* a chunk substituted */
+    struct slot *slots;
+    size_t count;
+    size_t next_read;
+    size_t next_work;
+    size_t next_write;
+    int finished;               /* no more chunks will be read */
+};
+
+/*
+ * Where substituted chunks go: fd, or a file edited in place. That one is
+ * written to a temporary file, only created at the first changed chunk.
+ */
+struct sink {
+    int fd;
+    const char *path;           /* of the file edited in place */
+    const char *map;            /* its content */
+    struct stat st;
+    char *temp;                 /* the temporary file, once created */
+    size_t kept;                /* bytes of map before the first changed chunk */
+};
+
+struct worker {
+    struct pool *pool;
+    struct subst *subst;
+    pthread_t thread;
+};
+
+static void open_input(struct input *in) {
+    struct stat st;
+
+    if (fstat(in->fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+        return;
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, in->fd, 0);
+
+    /* not mappable: read it */
+    if (map == MAP_FAILED)
+        return;
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    in->map = map;
+    in->size = st.st_size;
+}
+
+static void close_input(struct input *in) {
+    if (in->map)
+        munmap((void *)in->map, in->size);
+    buffer_free(&in->carry);
+}
+
+/* The next chunk of whole lines into slot: 1, 0 at the end of the input, -1 on error. */
+static int read_chunk(struct input *in, struct slot *slot) {
+    if (in->map) {
+        size_t len = in->size - in->offset;
+
+        if (len > CHUNK_SIZE) {
+            const char *end = memchr(in->map + in->offset + CHUNK_SIZE, '\n', len - CHUNK_SIZE);
+
+            if (end)
+                len = end + 1 - (in->map + in->offset);
+        }
+        slot->in = in->map + in->offset;
+        slot->len = len;
+        in->offset += len;
+        return len > 0;
+    }
+
+    struct buffer *b = &slot->read;
+
+    b->len = 0;
+    if (buffer_append(b, in->carry.data, in->carry.len) != 0)
+        goto nomem;
+    in->carry.len = 0;
+
+    /* up to CHUNK_SIZE and then on to a line end */
+    while (!in->eof) {
+        size_t start = b->len;
+
+        if (b->capacity - b->len < CHUNK_SIZE / 4 && buffer_reserve(b, CHUNK_SIZE) != 0)
+            goto nomem;
+
+        ssize_t n = read(in->fd, b->data + b->len, b->capacity - b->len);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            fprintf(stderr, "Error: %s: %s\n", in->name, strerror(errno));
+            return -1;
+        }
+        if (n == 0)
+            in->eof = 1;
+        b->len += n;
+        if (b->len >= CHUNK_SIZE && memchr(b->data + start, '\n', n))
+            break;
+    }
+
+    size_t len = b->len;
+
+    if (!in->eof) {
+        len = (char *)memrchr(b->data, '\n', b->len) + 1 - b->data;
+        if (buffer_append(&in->carry, b->data + len, b->len - len) != 0)
+            goto nomem;
+    }
+    slot->in = b->data;
+    slot->len = len;
+    return len > 0;
+
+nomem:
+    fprintf(stderr, "Error: failed to allocate memory for %s.\n", in->name);
+    return -1;
+}
+
+/* Substitute every line of a chunk into slot->out. */
+static int substitute(struct subst *s, struct slot *slot) {
+    const char *in = slot->in;
+    size_t len = slot->len;
+    struct buffer *out = &slot->out;
+
+    out->len = 0;
+    slot->changed = 0;
+    while (len > 0) {
+        const char *end = memchr(in, '\n', len);
+        size_t line = end ? (size_t)(end - in) : len;
+        int code = subst_apply(s, in, line, out);
+
+        if (code < 0)
+            return -1;
+        slot->changed |= code;
+        if (end) {
+            if (buffer_append(out, "\n", 1) != 0)
+                return -1;
+            line++;
+        }
+        in += line;
+        len -= line;
+    }
+    return 0;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* A temporary file next to the one edited, with its mode and owner. */
+static int create_temp(struct sink *out) {
+    const char *slash = strrchr(out->path, '/');
+    int dir = slash ? slash + 1 - out->path : 0;
+
+    if (asprintf(&out->temp, "%.*s.esubXXXXXX", dir, out->path) < 0) {
+        out->temp = NULL;
+        fprintf(stderr, "Error: failed to allocate memory for %s.\n", out->path);
+        return -1;
+    }
+    out->fd = mkstemp(out->temp);
+    if (out->fd < 0) {
+        fprintf(stderr, "Error: %s: %s\n", out->temp, strerror(errno));
+        free(out->temp);
+        out->temp = NULL;
+        return -1;
+    }
+    /* only root may give it away, else the file becomes ours as with sed -i */
+    if ((fchown(out->fd, out->st.st_uid, out->st.st_gid) != 0 && errno != EPERM)
+        || fchmod(out->fd, out->st.st_mode & 07777) != 0) {
+        fprintf(stderr, "Error: %s: %s\n", out->temp, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Write a substituted chunk, reporting a failure. Editing in place, the
+ * chunks before the first changed one are written from the input at once.
+ */
+static int output(struct sink *out, const struct slot *slot) {
+    if (slot->error) {
+        fprintf(stderr, "Error: failed to allocate memory for the output.\n");
+        return -1;
+    }
+    if (out->fd < 0) {
+        if (!slot->changed) {
+            out->kept += slot->len;
+            return 0;
+        }
+        if (create_temp(out) != 0)
+            return -1;
+        if (write_all(out->fd, out->map, out->kept) != 0)
+            goto error;
+    }
+    if (write_all(out->fd, slot->out.data, slot->out.len) != 0)
+        goto error;
+    return 0;
+
+error:
+    fprintf(stderr, "Error: %s: %s\n", out->temp ? out->temp : "write", strerror(errno));
+    return -1;
+}
+
+static void *work(void *arg) {
+    struct worker *w = arg;
+    struct pool *p = w->pool;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (p->next_work == p->next_read && !p->finished)
+            pthread_cond_wait(&p->ready, &p->lock);
+        if (p->next_work == p->next_read)
+            break;
+
+        struct slot *slot = &p->slots[p->next_work++ % p->count];
+
+        pthread_mutex_unlock(&p->lock);
+        slot->error = substitute(w->subst, slot) != 0;
+        pthread_mutex_lock(&p->lock);
+
+        slot->state = SLOT_DONE;
+        pthread_cond_signal(&p->done);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+/*
+ * The main thread reads chunks ahead into free slots and writes the
+ * substituted ones in input order, while the workers substitute.
+ */
+static int run_pool(struct input *in, struct sink *out, struct pool *p) {
+    int status = 0;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        struct slot *slot = &p->slots[p->next_write % p->count];
+
+        if (p->next_write < p->next_read && slot->state == SLOT_DONE) {
+            pthread_mutex_unlock(&p->lock);
+            if (status == 0)
+                status = output(out, slot);
+            pthread_mutex_lock(&p->lock);
+
+            slot->state = SLOT_FREE;
+            p->next_write++;
+            continue;
+        }
+
+        if (!p->finished && p->next_read - p->next_write < p->count) {
+            slot = &p->slots[p->next_read % p->count];
+
+            /* no worker looks at a slot before next_read */
+            pthread_mutex_unlock(&p->lock);
+            int got = status == 0 ? read_chunk(in, slot) : 0;
+            pthread_mutex_lock(&p->lock);
+
+            if (got > 0) {
+                slot->state = SLOT_READY;
+                p->next_read++;
+                pthread_cond_signal(&p->ready);
+            } else {
+                if (got < 0)
+                    status = -1;
+                p->finished = 1;
+                pthread_cond_broadcast(&p->ready);
+            }
+            continue;
+        }
+
+        if (p->finished && p->next_write == p->next_read)
+            break;
+        pthread_cond_wait(&p->done, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return status;
+}
+
+/*
+ * With more than one worker the input is cut in chunks at line ends, each
+ * worker thread substitutes whole chunks with its own subst, and the chunks
+ * are written in order: the output is the same as with one. An input of a
+ * single chunk is not worth the threads.
+ */
+static int run(struct input *in, struct sink *out, struct subst substs[], int workers) {
+    int status = 0;
+
+    if (workers == 1 || (in->map && in->size <= CHUNK_SIZE)) {
+        struct slot slot = { .in = NULL };
+
+        for (int got; status == 0 && (got = read_chunk(in, &slot)) != 0; ) {
+            if (got < 0)
+                status = -1;
+            else
+                slot.error = substitute(&substs[0], &slot) != 0;
+            if (status == 0)
+                status = output(out, &slot);
+        }
+        buffer_free(&slot.read);
+        buffer_free(&slot.out);
+        return status;
+    }
+
+    struct pool p = { .count = (size_t)workers * SLOTS_PER_WORKER };
+    struct worker *w = calloc(workers, sizeof(*w));
+
+    p.slots = calloc(p.count, sizeof(*p.slots));
+    if (!w || !p.slots) {
+        fprintf(stderr, "Error: failed to allocate memory for %d workers.\n", workers);
+        free(w);
+        free(p.slots);
+        return -1;
+    }
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.ready, NULL);
+    pthread_cond_init(&p.done, NULL);
+
+    int started = 0;
+
+    for (; started < workers; started++) {
+        w[started].pool = &p;
+        w[started].subst = &substs[started];
+        if (pthread_create(&w[started].thread, NULL, work, &w[started]) != 0)
+            break;
+    }
+
+    if (started == 0) {
+        fprintf(stderr, "Error: failed to start a worker thread.\n");
+        status = -1;
+    } else {
+        status = run_pool(in, out, &p);
+    }
+
+    /* run_pool() only returns once every chunk read is written */
+    pthread_mutex_lock(&p.lock);
+    p.finished = 1;
+    pthread_cond_broadcast(&p.ready);
+    pthread_mutex_unlock(&p.lock);
+    for (int i = 0; i < started; i++)
+        pthread_join(w[i].thread, NULL);
+
+    for (size_t i = 0; i < p.count; i++) {
+        buffer_free(&p.slots[i].read);
+        buffer_free(&p.slots[i].out);
+    }
+    pthread_cond_destroy(&p.done);
+    pthread_cond_destroy(&p.ready);
+    pthread_mutex_destroy(&p.lock);
+    free(p.slots);
+    free(w);
+    return status;
+}
+
+/* Substitute each line of fd and write them to out. */
+int chunks_run(int fd, const char *name, int out, struct subst substs[], int workers) {
+    struct input in = { .fd = fd, .name = name };
+    struct sink sink = { .fd = out };
+
+    open_input(&in);
+
+    int status = run(&in, &sink, substs, workers);
+
+    close_input(&in);
+    return status;
+}
+
+/*
+ * Substitute each line of the file path in place: the output goes to a
+ * temporary file in the same directory, renamed over path once complete.
+ * A file with no match is not written at all.
+ */
+int chunks_edit(const char *path, struct subst substs[], int workers) {
+    struct input in = { .name = path };
+    struct sink sink = { .fd = -1, .path = path };
+    int status = -1;
+
+    in.fd = open(path, O_RDONLY);
+    if (in.fd < 0 || fstat(in.fd, &sink.st) != 0) {
+        fprintf(stderr, "Error: %s: %s\n", path, strerror(errno));
+        goto out;
+    }
+    if (!S_ISREG(sink.st.st_mode)) {
+        fprintf(stderr, "Error: %s: not a regular file\n", path);
+        goto out;
+    }
+
+    open_input(&in);
+    if (!in.map && sink.st.st_size > 0) {
+        fprintf(stderr, "Error: %s: cannot be mapped\n", path);
+        goto out;
+    }
+    sink.map = in.map;
+
+    status = run(&in, &sink, substs, workers);
+
+    if (sink.temp) {
+        if (close(sink.fd) != 0 && status == 0) {
+            fprintf(stderr, "Error: %s: %s\n", sink.temp, strerror(errno));
+            status = -1;
+        }
+        if (status == 0 && rename(sink.temp, path) != 0) {
+            fprintf(stderr, "Error: %s: %s\n", path, strerror(errno));
+            status = -1;
+        }
+        if (status != 0)
+            unlink(sink.temp);
+        free(sink.temp);
+    }
+
+out:
+    close_input(&in);
+    if (in.fd >= 0)
+        close(in.fd);
+    return status;
+}
@@ -0,0 +1,12 @@
+#ifndef CHUNKS_H
+#define CHUNKS_H
+
+#include "subst.h"
+
+/* Input cut in chunks, at the first line end after this many bytes. */
+#define CHUNK_SIZE (1 << 20)
+
+int chunks_run(int fd, const char *name, int out, struct subst substs[], int workers);
+int chunks_edit(const char *path, struct subst substs[], int workers);
+
+#endif
@@ -0,0 +1,1556 @@
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dfa.h"
+
+/* Largest count in {m,n}, as RE_DUP_MAX in glibc. */
+#define MAX_REPEAT 0x7fff
+
+/* NFA states of one program; a larger pattern is refused. */
+#define MAX_STATES 100000
+
+/* Nesting of the pattern, to bound the recursion of the compiler. */
+#define MAX_DEPTH 1000
+
+/* Memory for cached DFA states of one program before the cache is flushed. */
+#define CACHE_BYTES (8 << 20)
+
+/* A set of bytes. */
+struct set {
+    unsigned char bits[32];
+};
+
+static void set_add(struct set *s, unsigned c) {
+    s->bits[c >> 3] |= 1 << (c & 7);
+}
+
+static int set_has(const struct set *s, unsigned c) {
+    return s->bits[c >> 3] >> (c & 7) & 1;
+}
+
+/* Syntax tree. */
+enum node_type { A_EMPTY, A_SET, A_CAT, A_ALT, A_REPEAT, A_GROUP, A_BOL, A_EOL };
+
+struct node {
+    enum node_type type;
+    int a, b;               /* children: both for CAT and ALT, a for REPEAT and GROUP */
+    int min, max;           /* bounds of REPEAT, max -1 for none */
+    int value;              /* set of SET, group number of GROUP */
+};
+
+/*
+ * NFA. A SPLIT state goes to out before out1: the first alternative and
+ * the longer repetition are preferred. BEGIN and END are the assertions
+ * of the start and the end of the text as it is scanned.
+ */
+enum state_type { N_CHAR, N_SPLIT, N_EMPTY, N_SAVE, N_BEGIN, N_END, N_MATCH };
+
+struct nstate {
+    enum state_type type;
+    int out, out1;
+    int value;              /* set of CHAR, slot of SAVE, alternative of MATCH,
+                               1 + the fence of an optional pass for SPLIT */
+};
+
+/* A DFA state: the NFA states it stands for that consume a byte, match or wait for the end. */
+struct dstate {
+    int flags;
+    int alt;                /* the first alternative that matches here, with D_MATCH */
+    int alt_end;            /* and if this is the end of the text, with D_MATCH_END */
+    int begin;              /* built at the start of the scan, where BEGIN holds */
+    int count;
+    int *ids;               /* after next */
+    struct dstate *next[];  /* per byte class, NULL until computed */
+};
+
+#define D_MATCH 1           /* a match ends here */
+#define D_MATCH_END 2       /* a match ends here if this is the end of the text */
+#define D_DEAD 4            /* no match goes on from here */
+
+struct program {
+    struct nstate *states;
+    int count;
+    int capacity;
+    int start;
+
+    /* lazily built DFA */
+    struct dstate **dstates;
+    int dcount;
+    int dcapacity;
+    struct dstate **table;  /* hash of dstates, open addressing */
+    size_t table_size;
+    size_t bytes;
+    unsigned flushes;           /* how many times the cache was flushed */
+    struct dstate *initial[2];  /* per begin flag, NULL until built */
+};
+
+/* A state of the forward DFA at a position, in scan number scan of the epoch. */
+struct visit {
+    const struct dstate *d;
+    unsigned scan;
+    unsigned next;          /* another visit at the position, 0 for none */
+};
+
+/* What a scan for the end of a match found: the end or SIZE_MAX, and the alternative. */
+struct scan {
+    size_t end;
+    int alt;
+};
+
+/* A top-level alternative of the pattern: where it starts in the forward program, and its groups. */
+struct alt {
+    int start;
+    int first, last;
+};
+
+struct dfa {
+    struct set *sets;
+    int nsets;
+    size_t groups;
+    struct alt *alts;
+    int nalts;
+
+    struct program forward;     /* the pattern, with SAVE states */
+    struct program reverse;     /* the pattern backwards, after any text */
+
+    unsigned char classes[256]; /* byte class of each byte */
+    unsigned char represent[256];
+    int nclasses;
+
+    /* scratch space, sized for the larger program */
+    unsigned *mark;
+    unsigned generation;
+    int *stack;
+    int *list;
+    int *spare;
+
+    /* group resolution, allocated when first needed */
+    struct thread *threads[2];
+    regoff_t *caps[2];
+    regoff_t *work;
+    struct entry *entries;
+    unsigned char *open;        /* the fences of the passes entered at this position */
+    size_t nslots;
+
+    /* the text of dfa_start(), and where matches of it start */
+    const unsigned char *text;
+    size_t len;
+    int begin;
+    int anchored;               /* only at 0, and starts is not used */
+    uint64_t *starts;           /* a bit per position, 0 to len */
+    size_t starts_words;
+
+    /*
+     * The forward states that the scans for the ends of matches had at
+     * each position from base to reach, in an epoch that begins with a
+     * scan that no other reached into.
+     */
+    size_t base, reach;
+    unsigned *heads;            /* per position from base: its first visit, 0 for none */
+    size_t heads_size;
+    struct visit *visits;       /* from 1 */
+    unsigned nvisits;
+    unsigned visits_size;
+    struct scan *scans;         /* by number in the epoch */
+    unsigned nscans;
+    unsigned scans_size;
+    unsigned flushes;           /* of the forward cache, when the epoch began */
+};
+
+struct parser {
+    const unsigned char *p;
+    struct node *nodes;
+    int count;
+    int capacity;
+    struct set *sets;
+    int nsets;
+    int set_capacity;
+    int groups;
+    int depth;
+    int *ends;              /* groups at the end of each top-level alternative */
+    int nalts;
+    int alt_capacity;
+    const char *error;
+};
+
+/* Parsing. */
+
+static int new_node(struct parser *ps, enum node_type type, int a, int b) {
+    if (ps->count == ps->capacity) {
+        int capacity = ps->capacity ? 2 * ps->capacity : 64;
+        struct node *nodes = realloc(ps->nodes, capacity * sizeof(*nodes));
+
+        if (!nodes) {
+            ps->error = "out of memory";
+            return -1;
+        }
+        ps->nodes = nodes;
+        ps->capacity = capacity;
+    }
+
+    struct node *n = &ps->nodes[ps->count];
+
+    n->type = type;
+    n->a = a;
+    n->b = b;
+    n->min = n->max = n->value = 0;
+    return ps->count++;
+}
+
+/* A SET node for a new empty set, returned in *set. */
+static int new_set(struct parser *ps, struct set **set) {
+    if (ps->nsets == ps->set_capacity) {
+        int capacity = ps->set_capacity ? 2 * ps->set_capacity : 16;
+        struct set *sets = realloc(ps->sets, capacity * sizeof(*sets));
+
+        if (!sets) {
+            ps->error = "out of memory";
+            return -1;
+        }
+        ps->sets = sets;
+        ps->set_capacity = capacity;
+    }
+
+    int node = new_node(ps, A_SET, -1, -1);
+
+    if (node < 0)
+        return -1;
+    ps->nodes[node].value = ps->nsets;
+    *set = &ps->sets[ps->nsets++];
+    memset(*set, 0, sizeof(**set));
+    return node;
+}
+
+static void set_complement(struct set *s) {
+    for (int i = 0; i < 32; i++)
+        s->bits[i] = ~s->bits[i];
+}
+
+/* The bytes of a character class name, 0 for an unknown one. */
+static int add_class(struct set *s, const char *name, size_t len) {
+    static const struct {
+        const char *name;
+        int (*test)(int);
+    } classes[] = {
+        { "alnum", isalnum }, { "alpha", isalpha }, { "blank", isblank },
+        { "cntrl", iscntrl }, { "digit", isdigit }, { "graph", isgraph },
+        { "lower", islower }, { "print", isprint }, { "punct", ispunct },
+        { "space", isspace }, { "upper", isupper }, { "xdigit", isxdigit },
+    };
+
+    for (size_t i = 0; i < sizeof(classes) / sizeof(classes[0]); i++) {
+        if (strlen(classes[i].name) == len && memcmp(classes[i].name, name, len) == 0) {
+            for (int c = 0; c < 256; c++)
+                if (classes[i].test(c))
+                    set_add(s, c);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* One character of a bracket expression, plain or as [.c.] or [=c=]; -1 on error. */
+static int bracket_char(struct parser *ps) {
+    const unsigned char *p = ps->p;
+
+    if (p[0] == '[' && (p[1] == '.' || p[1] == '=')) {
+        if (p[2] == '\0' || p[3] != p[1] || p[4] != ']') {
+            ps->error = "invalid collating element";
+            return -1;
+        }
+        ps->p += 5;
+        return p[2];
+    }
+    ps->p++;
+    return p[0];
+}
+
+static int parse_bracket(struct parser *ps) {
+    struct set *s;
+    int node = new_set(ps, &s);
+    int negate = 0;
+
+    if (node < 0)
+        return -1;
+    if (*ps->p == '^') {
+        negate = 1;
+        ps->p++;
+    }
+
+    /* a ']' first is a member */
+    int first = 1;
+
+    while (first || *ps->p != ']') {
+        const unsigned char *p = ps->p;
+
+        first = 0;
+        if (*p == '\0') {
+            ps->error = "unmatched [";
+            return -1;
+        }
+
+        if (p[0] == '[' && p[1] == ':') {
+            const char *name = (const char *)p + 2;
+            const char *close = strstr(name, ":]");
+
+            if (!close || !add_class(s, name, close - name)) {
+                ps->error = "invalid character class";
+                return -1;
+            }
+            ps->p = (const unsigned char *)close + 2;
+            continue;
+        }
+
+        int low = bracket_char(ps);
+
+        if (low < 0)
+            return -1;
+
+        int high = low;
+
+        if (ps->p[0] == '-' && ps->p[1] != ']' && ps->p[1] != '\0') {
+            ps->p++;
+            high = bracket_char(ps);
+            if (high < 0)
+                return -1;
+            if (high < low) {
+                ps->error = "invalid range end";
+                return -1;
+            }
+        }
+
+        for (int c = low; c <= high; c++)
+            set_add(s, c);
+    }
+    ps->p++;
+
+    if (negate)
+        set_complement(s);
+    return node;
+}
+
+static int parse_alt(struct parser *ps);
+
+static int parse_escape(struct parser *ps) {
+    unsigned char c = *ps->p++;
+    struct set *s;
+    int node;
+
+    switch (c) {
+    case '\0':
+        ps->p--;
+        ps->error = "trailing backslash";
+        return -1;
+    case '1': case '2': case '3': case '4': case '5':
+    case '6': case '7': case '8': case '9':
+        ps->error = "back-references are not supported";
+        return -1;
+    case 'b': case 'B': case '<': case '>':
+        ps->error = "word boundaries are not supported";
+        return -1;
+    case '`':
+        return new_node(ps, A_BOL, -1, -1);
+    case '\'':
+        return new_node(ps, A_EOL, -1, -1);
+    case 'w': case 'W':
+        if ((node = new_set(ps, &s)) < 0)
+            return -1;
+        add_class(s, "alnum", 5);
+        set_add(s, '_');
+        if (c == 'W')
+            set_complement(s);
+        return node;
+    case 's': case 'S':
+        if ((node = new_set(ps, &s)) < 0)
+            return -1;
+        add_class(s, "space", 5);
+        if (c == 'S')
+            set_complement(s);
+        return node;
+    default:
+        if ((node = new_set(ps, &s)) < 0)
+            return -1;
+        set_add(s, c);
+        return node;
+    }
+}
+
+static int parse_atom(struct parser *ps) {
+    unsigned char c = *ps->p;
+    struct set *s;
+    int node;
+
+    switch (c) {
+    case '(':
+        if (ps->depth == MAX_DEPTH) {
+            ps->error = "pattern too large";
+            return -1;
+        }
+        ps->p++;
+        ps->depth++;
+
+        int group = ++ps->groups;
+        int inner = parse_alt(ps);
+
+        if (inner < 0)
+            return -1;
+        if (*ps->p != ')') {
+            ps->error = "unmatched (";
+            return -1;
+        }
+        ps->p++;
+        ps->depth--;
+        if ((node = new_node(ps, A_GROUP, inner, -1)) >= 0)
+            ps->nodes[node].value = group;
+        return node;
+    case '*': case '+': case '?': case '{':
+        ps->error = "nothing to repeat";
+        return -1;
+    case '[':
+        ps->p++;
+        return parse_bracket(ps);
+    case '\\':
+        ps->p++;
+        return parse_escape(ps);
+    case '^':
+        ps->p++;
+        return new_node(ps, A_BOL, -1, -1);
+    case '$':
+        ps->p++;
+        return new_node(ps, A_EOL, -1, -1);
+    case '.':
+        ps->p++;
+        if ((node = new_set(ps, &s)) < 0)
+            return -1;
+        set_add(s, '\0');
+        set_complement(s);
+        return node;
+    default:
+        /* an unmatched ')' is a literal too */
+        ps->p++;
+        if ((node = new_set(ps, &s)) < 0)
+            return -1;
+        set_add(s, c);
+        return node;
+    }
+}
+
+static int parse_number(struct parser *ps, int *n) {
+    if (!isdigit(*ps->p))
+        return 0;
+
+    long value = 0;
+
+    while (isdigit(*ps->p)) {
+        if (value <= MAX_REPEAT)
+            value = value * 10 + (*ps->p - '0');
+        ps->p++;
+    }
+    *n = value;
+    return 1;
+}
+
+/* {m}, {m,}, {,n} or {m,n}, after the '{'. */
+static int parse_interval(struct parser *ps, int *min, int *max) {
+    *min = 0;
+    *max = -1;
+
+    int has_min = parse_number(ps, min);
+
+    if (*ps->p == ',') {
+        ps->p++;
+        parse_number(ps, max);
+    } else if (has_min) {
+        *max = *min;
+    } else {
+        ps->error = "invalid interval";
+        return -1;
+    }
+
+    if (*ps->p != '}') {
+        ps->error = "invalid interval";
+        return -1;
+    }
+    ps->p++;
+
+    if (*min > MAX_REPEAT || *max > MAX_REPEAT || (*max >= 0 && *max < *min)) {
+        ps->error = "invalid repetition count";
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_repeat(struct parser *ps) {
+    int atom = parse_atom(ps);
+
+    while (atom >= 0) {
+        int min, max;
+
+        switch (*ps->p) {
+        case '*':
+            min = 0, max = -1;
+            break;
+        case '+':
+            min = 1, max = -1;
+            break;
+        case '?':
+            min = 0, max = 1;
+            break;
+        case '{':
+            min = max = 0;
+            break;
+        default:
+            return atom;
+        }
+
+        if (ps->nodes[atom].type == A_BOL) {
+            ps->error = "nothing to repeat";
+            return -1;
+        }
+
+        ps->p++;
+        if (ps->p[-1] == '{' && parse_interval(ps, &min, &max) != 0)
+            return -1;
+
+        if ((atom = new_node(ps, A_REPEAT, atom, -1)) >= 0) {
+            ps->nodes[atom].min = min;
+            ps->nodes[atom].max = max;
+        }
+    }
+    return atom;
+}
+
+static int parse_concat(struct parser *ps) {
+    int left = new_node(ps, A_EMPTY, -1, -1);
+
+    while (left >= 0 && *ps->p != '\0' && *ps->p != '|' && !(*ps->p == ')' && ps->depth > 0)) {
+        int right = parse_repeat(ps);
+
+        if (right < 0)
+            return -1;
+        left = new_node(ps, A_CAT, left, right);
+    }
+    return left;
+}
+
+/* At the end of a top-level alternative, note where its groups end. */
+static int end_alt(struct parser *ps) {
+    if (ps->nalts == ps->alt_capacity) {
+        int capacity = ps->alt_capacity ? 2 * ps->alt_capacity : 16;
+        int *ends = realloc(ps->ends, capacity * sizeof(*ends));
+
+        if (!ends)
+            return -1;
+        ps->ends = ends;
+        ps->alt_capacity = capacity;
+    }
+    ps->ends[ps->nalts++] = ps->groups;
+    return 0;
+}
+
+static int parse_alt(struct parser *ps) {
+    int top = ps->depth == 0;
+    int left = parse_concat(ps);
+
+    if (left >= 0 && top && end_alt(ps) != 0)
+        return -1;
+    while (left >= 0 && *ps->p == '|') {
+        ps->p++;
+
+        int right = parse_concat(ps);
+
+        if (right < 0 || (top && end_alt(ps) != 0))
+            return -1;
+        left = new_node(ps, A_ALT, left, right);
+    }
+    return left;
+}
+
+/* Compilation to NFA. */
+
+struct compiler {
+    const struct node *nodes;
+    struct program *prog;
+    int reverse;
+    int depth;
+    const char *error;
+};
+
+static int emit(struct compiler *c, enum state_type type, int out, int out1, int value) {
+    struct program *prog = c->prog;
+
+    if (out < 0 || (type == N_SPLIT && out1 < 0))
+        return -1;
+    if (prog->count == MAX_STATES) {
+        c->error = "pattern too large";
+        return -1;
+    }
+    if (prog->count == prog->capacity) {
+        int capacity = prog->capacity ? 2 * prog->capacity : 64;
+        struct nstate *states = realloc(prog->states, capacity * sizeof(*states));
+
+        if (!states) {
+            c->error = "out of memory";
+            return -1;
+        }
+        prog->states = states;
+        prog->capacity = capacity;
+    }
+
+    struct nstate *s = &prog->states[prog->count];
+
+    s->type = type;
+    s->out = out;
+    s->out1 = out1;
+    s->value = value;
+    return prog->count++;
+}
+
+/*
+ * Compile a node before the state next, in continuation style. The
+ * chains of CAT and ALT nodes that the parser builds to the left are
+ * walked in a loop, so that only nesting recurses.
+ */
+static int compile(struct compiler *c, int node, int next) {
+    const struct node *n = &c->nodes[node];
+    int state;
+
+    if (next < 0)
+        return -1;
+    if (c->depth == 2 * MAX_DEPTH) {
+        c->error = "pattern too large";
+        return -1;
+    }
+    c->depth++;
+
+    switch (n->type) {
+    case A_EMPTY:
+        state = next;
+        break;
+    case A_SET:
+        state = emit(c, N_CHAR, next, -1, n->value);
+        break;
+    case A_BOL:
+        state = emit(c, c->reverse ? N_END : N_BEGIN, next, -1, 0);
+        break;
+    case A_EOL:
+        state = emit(c, c->reverse ? N_BEGIN : N_END, next, -1, 0);
+        break;
+    case A_GROUP:
+        if (c->reverse) {
+            state = compile(c, n->a, next);
+        } else {
+            state = emit(c, N_SAVE, next, -1, 2 * n->value + 1);
+            state = compile(c, n->a, state);
+            state = emit(c, N_SAVE, state, -1, 2 * n->value);
+        }
+        break;
+    case A_CAT:
+        if (!c->reverse) {
+            /* the right side comes first */
+            state = next;
+            for (; n->type == A_CAT && state >= 0; n = &c->nodes[n->a])
+                state = compile(c, n->b, state);
+            state = compile(c, n - c->nodes, state);
+        } else {
+            /* the left side comes first: find the start of the chain */
+            int count = 0;
+
+            for (const struct node *m = n; m->type == A_CAT; m = &c->nodes[m->a])
+                count++;
+
+            int *chain = malloc(count * sizeof(*chain));
+
+            if (!chain) {
+                c->error = "out of memory";
+                state = -1;
+                break;
+            }
+            for (int i = count - 1; i >= 0; i--, n = &c->nodes[n->a])
+                chain[i] = n->b;
+
+            state = compile(c, n - c->nodes, next);
+            for (int i = 0; i < count; i++)
+                state = compile(c, chain[i], state);
+            free(chain);
+        }
+        break;
+    case A_ALT:
+        /* the last alternative is the least preferred */
+        state = compile(c, n->b, next);
+        for (n = &c->nodes[n->a]; n->type == A_ALT && state >= 0; n = &c->nodes[n->a])
+            state = emit(c, N_SPLIT, compile(c, n->b, next), state, 0);
+        state = emit(c, N_SPLIT, compile(c, n - c->nodes, next), state, 0);
+        break;
+    case A_REPEAT: {
+        int min = n->min;
+
+        state = next;
+        if (n->max < 0) {
+            /*
+             * The body, then a loop back to it, its start filled in after.
+             * An empty pass through the body still sets its groups.
+             */
+            int loop = emit(c, N_SPLIT, next, next, 0);
+            int body = loop >= 0 ? compile(c, n->a, loop) : -1;
+
+            if (body >= 0) {
+                c->prog->states[loop].out = body;
+                if (min > 0)
+                    min--;
+                else
+                    body = emit(c, N_SPLIT, body, next, 0);
+            }
+            state = body;
+        } else {
+            /*
+             * A pass past the minimum may not be empty, or it would reset
+             * the groups of the last one: it ends with a fence that the
+             * empty pass cannot cross. The DFA takes it as EMPTY.
+             */
+            for (int i = n->min; i < n->max && state >= 0; i++) {
+                int fence = c->reverse ? state : emit(c, N_EMPTY, state, -1, 0);
+
+                state = emit(c, N_SPLIT, compile(c, n->a, fence), next, c->reverse || fence < 0 ? 0 : fence + 1);
+            }
+        }
+        for (int i = 0; i < min && state >= 0; i++)
+            state = compile(c, n->a, state);
+        break;
+    }
+    default:
+        state = -1;
+    }
+
+    c->depth--;
+    return state;
+}
+
+/*
+ * The NFA of the tree, forward or reverse; an error message or NULL. The
+ * forward one has a MATCH state per top-level alternative, the nalts of
+ * alts, and notes where each starts.
+ */
+static const char *build(struct program *prog, const struct node *nodes, int root, int reverse,
+                         struct alt *alts, int nalts) {
+    struct compiler c = { nodes, prog, reverse, 0, "out of memory" };
+    int start;
+
+    if (reverse) {
+        start = compile(&c, root, emit(&c, N_MATCH, 0, -1, 0));
+    } else {
+        /* the alternatives hang to the left of the chain of ALT nodes */
+        const struct node *n = &nodes[root];
+
+        for (int i = nalts - 1; i > 0; i--, n = &nodes[n->a])
+            alts[i].start = compile(&c, n->b, emit(&c, N_MATCH, 0, -1, i));
+        alts[0].start = start = compile(&c, n - nodes, emit(&c, N_MATCH, 0, -1, 0));
+        for (int i = 1; i < nalts; i++)
+            start = emit(&c, N_SPLIT, start, alts[i].start, 0);
+    }
+
+    if (start >= 0 && reverse) {
+        /* any text may follow the match: skip it first */
+        int loop = emit(&c, N_SPLIT, start, start, 0);
+        int any = emit(&c, N_CHAR, loop, -1, -1);
+
+        if (any >= 0)
+            prog->states[loop].out1 = any;
+        start = loop;
+    }
+
+    if (start < 0)
+        return c.error;
+    prog->start = start;
+    return NULL;
+}
+
+/* Lazy DFA. */
+
+static void flush(struct program *prog) {
+    for (int i = 0; i < prog->dcount; i++)
+        free(prog->dstates[i]);
+    prog->dcount = 0;
+    prog->bytes = 0;
+    prog->flushes++;
+    memset(prog->table, 0, prog->table_size * sizeof(*prog->table));
+    prog->initial[0] = prog->initial[1] = NULL;
+}
+
+static int compare_ids(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+
+    return (x > y) - (x < y);
+}
+
+static int has_byte(const struct dfa *dfa, const struct nstate *s, unsigned c) {
+    /* the set -1 is every byte */
+    return s->value < 0 || set_has(&dfa->sets[s->value], c);
+}
+
+/*
+ * Follow the empty transitions from state, adding to out the states that
+ * consume a byte or match, and the END states unless end holds. States
+ * marked in this generation are skipped.
+ */
+static int follow(struct dfa *dfa, const struct program *prog, int state, int begin, int end,
+                  int *out, int count) {
+    int top = 0;
+
+    if (dfa->mark[state] == dfa->generation)
+        return count;
+    dfa->mark[state] = dfa->generation;
+    dfa->stack[top++] = state;
+
+    while (top > 0) {
+        const struct nstate *s = &prog->states[dfa->stack[--top]];
+        int targets[2] = { -1, -1 };
+
+        switch (s->type) {
+        case N_CHAR:
+        case N_MATCH:
+            out[count++] = s - prog->states;
+            break;
+        case N_SPLIT:
+            targets[0] = s->out;
+            targets[1] = s->out1;
+            break;
+        case N_EMPTY:
+        case N_SAVE:
+            targets[0] = s->out;
+            break;
+        case N_BEGIN:
+            if (begin)
+                targets[0] = s->out;
+            break;
+        case N_END:
+            if (end)
+                targets[0] = s->out;
+            else
+                out[count++] = s - prog->states;
+            break;
+        }
+
+        for (int i = 0; i < 2; i++) {
+            if (targets[i] >= 0 && dfa->mark[targets[i]] != dfa->generation) {
+                dfa->mark[targets[i]] = dfa->generation;
+                dfa->stack[top++] = targets[i];
+            }
+        }
+    }
+    return count;
+}
+
+static uint32_t hash_ids(const int *ids, int count, int begin) {
+    uint32_t h = 2166136261u ^ begin;
+
+    for (int i = 0; i < count; i++)
+        h = (h ^ ids[i]) * 16777619u;
+    return h;
+}
+
+static int grow_table(struct program *prog) {
+    size_t size = prog->table_size ? 2 * prog->table_size : 1024;
+    struct dstate **table = calloc(size, sizeof(*table));
+
+    if (!table)
+        return -1;
+    for (int i = 0; i < prog->dcount; i++) {
+        struct dstate *d = prog->dstates[i];
+        size_t slot = hash_ids(d->ids, d->count, d->begin) & (size - 1);
+
+        while (table[slot])
+            slot = (slot + 1) & (size - 1);
+        table[slot] = d;
+    }
+    free(prog->table);
+    prog->table = table;
+    prog->table_size = size;
+    return 0;
+}
+
+/*
+ * The DFA state for the NFA states in dfa->list, made if not cached yet.
+ * *flushed tells whether the cache was flushed to make room. NULL if out
+ * of memory.
+ */
+static struct dstate *dstate(struct dfa *dfa, struct program *prog, int count, int begin, int *flushed) {
+    int *ids = dfa->list;
+
+    *flushed = 0;
+    qsort(ids, count, sizeof(*ids), compare_ids);
+
+    uint32_t h = hash_ids(ids, count, begin);
+    size_t slot = h & (prog->table_size - 1);
+
+    for (struct dstate *d; (d = prog->table[slot]) != NULL; slot = (slot + 1) & (prog->table_size - 1))
+        if (d->count == count && d->begin == begin && memcmp(d->ids, ids, count * sizeof(*ids)) == 0)
+            return d;
+
+    size_t size = sizeof(struct dstate) + dfa->nclasses * sizeof(struct dstate *) + count * sizeof(int);
+
+    if (prog->bytes + size > CACHE_BYTES && prog->dcount > 0) {
+        flush(prog);
+        *flushed = 1;
+        slot = h & (prog->table_size - 1);
+    }
+
+    if (prog->dcount == prog->dcapacity) {
+        int capacity = prog->dcapacity ? 2 * prog->dcapacity : 64;
+        struct dstate **dstates = realloc(prog->dstates, capacity * sizeof(*dstates));
+
+        if (!dstates)
+            return NULL;
+        prog->dstates = dstates;
+        prog->dcapacity = capacity;
+    }
+    if (2 * (size_t)(prog->dcount + 1) > prog->table_size) {
+        if (grow_table(prog) != 0)
+            return NULL;
+        slot = h & (prog->table_size - 1);
+    }
+
+    struct dstate *d = malloc(size);
+
+    if (!d)
+        return NULL;
+    d->begin = begin;
+    d->count = count;
+    d->ids = (int *)&d->next[dfa->nclasses];
+    memcpy(d->ids, ids, count * sizeof(*ids));
+    for (int i = 0; i < dfa->nclasses; i++)
+        d->next[i] = NULL;
+
+    /* what holds at the end of the text */
+    int ends = 0;
+
+    d->flags = count == 0 ? D_DEAD : 0;
+    d->alt = d->alt_end = INT_MAX;
+    dfa->generation++;
+    for (int i = 0; i < count; i++) {
+        const struct nstate *s = &prog->states[ids[i]];
+
+        if (s->type == N_MATCH) {
+            d->flags |= D_MATCH;
+            if (s->value < d->alt)
+                d->alt = s->value;
+        } else if (s->type == N_END) {
+            ends = follow(dfa, prog, s->out, begin, 1, dfa->spare, ends);
+        }
+    }
+    for (int i = 0; i < ends; i++) {
+        const struct nstate *s = &prog->states[dfa->spare[i]];
+
+        if (s->type == N_MATCH) {
+            d->flags |= D_MATCH_END;
+            if (s->value < d->alt_end)
+                d->alt_end = s->value;
+        }
+    }
+
+    while (prog->table[slot])
+        slot = (slot + 1) & (prog->table_size - 1);
+    prog->table[slot] = d;
+    prog->dstates[prog->dcount++] = d;
+    prog->bytes += size;
+    return d;
+}
+
+/* The state at the start of a scan. */
+static struct dstate *initial(struct dfa *dfa, struct program *prog, int begin) {
+    if (!prog->initial[begin]) {
+        int flushed;
+
+        dfa->generation++;
+
+        int count = follow(dfa, prog, prog->start, begin, 0, dfa->list, 0);
+
+        prog->initial[begin] = dstate(dfa, prog, count, begin, &flushed);
+    }
+    return prog->initial[begin];
+}
+
+/* The state after d on byte c, when not computed yet; NULL if out of memory. */
+static struct dstate *step(struct dfa *dfa, struct program *prog, struct dstate *d, unsigned char c) {
+    int class = dfa->classes[c];
+    unsigned rep = dfa->represent[class];
+    int count = 0, flushed;
+
+    dfa->generation++;
+    for (int i = 0; i < d->count; i++) {
+        const struct nstate *s = &prog->states[d->ids[i]];
+
+        if (s->type == N_CHAR && has_byte(dfa, s, rep))
+            count = follow(dfa, prog, s->out, 0, 0, dfa->list, count);
+    }
+
+    struct dstate *next = dstate(dfa, prog, count, 0, &flushed);
+
+    /* a flush freed d */
+    if (next && !flushed)
+        d->next[class] = next;
+    return next;
+}
+
+static int accepts(const struct dstate *d, int end) {
+    return (d->flags & D_MATCH) || (end && (d->flags & D_MATCH_END));
+}
+
+/* Group resolution on a matched span. */
+
+struct thread {
+    int state;
+};
+
+/*
+ * An entry of the stack of add_thread(): a state, a slot to restore when
+ * state is -1, or a fence to close when it is -2.
+ */
+struct entry {
+    int state;
+    int slot;
+    regoff_t old;
+};
+
+struct threads {
+    struct thread *list;
+    regoff_t *caps;
+    int count;
+};
+
+/*
+ * The match being resolved: text[start, end), BEGIN holding at 0 if begin.
+ * The slots from base are captured.
+ */
+struct span {
+    const unsigned char *text;
+    size_t len;
+    size_t end;
+    int begin;
+    int base;
+};
+
+/*
+ * Add the threads reached from state by empty transitions at pos, in order
+ * of preference, with the captures in dfa->work. Only the threads that can
+ * go on are kept: a CHAR state that takes the byte at pos, a MATCH at the
+ * end. With many alternatives, as a set of rules, most die at once and
+ * their captures are not copied.
+ */
+static void add_thread(struct dfa *dfa, struct threads *t, int state, size_t pos, const struct span *sp) {
+    const struct program *prog = &dfa->forward;
+    regoff_t *work = dfa->work;
+    struct entry *stack = dfa->entries;
+    int top = 0;
+
+    stack[top++] = (struct entry){ state, 0, 0 };
+
+    while (top > 0) {
+        struct entry e = stack[--top];
+
+        if (e.state < 0) {
+            if (e.state == -1)
+                work[e.slot] = e.old;
+            else
+                dfa->open[e.slot] = 0;
+            continue;
+        }
+        /* the end of a pass entered at pos, unmarked for the nonempty ones */
+        if (dfa->open[e.state])
+            continue;
+        if (dfa->mark[e.state] == dfa->generation)
+            continue;
+        dfa->mark[e.state] = dfa->generation;
+
+        const struct nstate *s = &prog->states[e.state];
+
+        switch (s->type) {
+        case N_CHAR:
+        case N_MATCH:
+            if (s->type == N_CHAR ? pos == sp->end || !has_byte(dfa, s, sp->text[pos]) : pos != sp->end)
+                break;
+            t->list[t->count].state = e.state;
+            memcpy(t->caps + t->count * dfa->nslots, work, dfa->nslots * sizeof(*work));
+            t->count++;
+            break;
+        case N_SPLIT:
+            stack[top++] = (struct entry){ s->out1, 0, 0 };
+            if (s->value > 0) {
+                stack[top++] = (struct entry){ -2, s->value - 1, 0 };
+                dfa->open[s->value - 1] = 1;
+            }
+            stack[top++] = (struct entry){ s->out, 0, 0 };
+            break;
+        case N_SAVE:
+            if (s->value >= sp->base && (size_t)(s->value - sp->base) < dfa->nslots) {
+                int slot = s->value - sp->base;
+
+                stack[top++] = (struct entry){ -1, slot, work[slot] };
+                work[slot] = pos;
+            }
+            stack[top++] = (struct entry){ s->out, 0, 0 };
+            break;
+        case N_EMPTY:
+            stack[top++] = (struct entry){ s->out, 0, 0 };
+            break;
+        case N_BEGIN:
+            if (pos == 0 && sp->begin)
+                stack[top++] = (struct entry){ s->out, 0, 0 };
+            break;
+        case N_END:
+            if (pos == sp->len)
+                stack[top++] = (struct entry){ s->out, 0, 0 };
+            break;
+        }
+    }
+}
+
+static int alloc_threads(struct dfa *dfa, size_t nslots) {
+    int count = dfa->forward.count;
+
+    if (dfa->work && dfa->nslots == nslots)
+        return 0;
+
+    for (int i = 0; i < 2; i++) {
+        free(dfa->threads[i]);
+        free(dfa->caps[i]);
+        dfa->threads[i] = malloc(count * sizeof(struct thread));
+        dfa->caps[i] = malloc(count * nslots * sizeof(regoff_t));
+    }
+    free(dfa->work);
+    free(dfa->entries);
+    free(dfa->open);
+    dfa->work = malloc(nslots * sizeof(regoff_t));
+    dfa->entries = malloc((3 * (size_t)count + 1) * sizeof(struct entry));
+    dfa->open = calloc(count, 1);
+    dfa->nslots = nslots;
+
+    if (!dfa->threads[0] || !dfa->threads[1] || !dfa->caps[0] || !dfa->caps[1] || !dfa->work || !dfa->entries ||
+        !dfa->open) {
+        free(dfa->work);
+        dfa->work = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Resolve the groups up to last of the match [start, end) by simulating
+ * the NFA on it: only the alternative that matched, and only its groups.
+ */
+static int captures(struct dfa *dfa, const unsigned char *text, size_t len, size_t start, size_t end,
+                    int begin, const struct alt *alt, int last, regmatch_t pmatch[]) {
+    if (alt->last < last)
+        last = alt->last;
+    if (last < alt->first)
+        return 0;
+
+    size_t nslots = 2 * (last - alt->first + 1);
+
+    if (alloc_threads(dfa, nslots) != 0)
+        return REG_ESPACE;
+
+    struct span sp = { text, len, end, begin, 2 * alt->first };
+    struct threads cur = { dfa->threads[0], dfa->caps[0], 0 };
+    struct threads next = { dfa->threads[1], dfa->caps[1], 0 };
+
+    for (size_t i = 0; i < nslots; i++)
+        dfa->work[i] = -1;
+    dfa->generation++;
+    add_thread(dfa, &cur, alt->start, start, &sp);
+
+    for (size_t pos = start; pos < end; pos++) {
+        next.count = 0;
+        dfa->generation++;
+        for (int i = 0; i < cur.count; i++) {
+            const struct nstate *s = &dfa->forward.states[cur.list[i].state];
+
+            /* every CHAR thread takes text[pos] */
+            if (s->type == N_CHAR) {
+                memcpy(dfa->work, cur.caps + i * nslots, nslots * sizeof(regoff_t));
+                add_thread(dfa, &next, s->out, pos + 1, &sp);
+            }
+        }
+
+        struct threads t = cur;
+
+        cur = next;
+        next = t;
+    }
+
+    for (int i = 0; i < cur.count; i++) {
+        if (dfa->forward.states[cur.list[i].state].type == N_MATCH) {
+            const regoff_t *caps = cur.caps + i * nslots;
+
+            for (int g = alt->first; g <= last; g++) {
+                regmatch_t *m = &pmatch[g];
+
+                m->rm_so = caps[2 * (g - alt->first)];
+                m->rm_eo = caps[2 * (g - alt->first) + 1];
+                if (m->rm_so < 0 || m->rm_eo < 0)
+                    m->rm_so = m->rm_eo = -1;
+            }
+            return 0;
+        }
+    }
+    return REG_NOMATCH;
+}
+
+/* Interface. */
+
+static void classify(struct dfa *dfa) {
+    short map[256][2];
+
+    memset(dfa->classes, 0, sizeof(dfa->classes));
+    dfa->nclasses = 1;
+
+    /* split the classes by each set in turn */
+    for (int i = 0; i < dfa->nsets; i++) {
+        int count = 0;
+
+        memset(map, 0xff, sizeof(map));
+        for (int c = 0; c < 256; c++) {
+            short *to = &map[dfa->classes[c]][set_has(&dfa->sets[i], c)];
+
+            if (*to < 0)
+                *to = count++;
+            dfa->classes[c] = *to;
+        }
+        dfa->nclasses = count;
+        if (count == 256)
+            break;
+    }
+
+    for (int c = 255; c >= 0; c--)
+        dfa->represent[dfa->classes[c]] = c;
+}
+
+struct dfa *dfa_compile(const char *pattern, char *error, size_t error_size) {
+    struct parser ps = { (const unsigned char *)pattern, NULL, 0, 0, NULL, 0, 0, 0, 0, NULL, 0, 0, "out of memory" };
+    struct dfa *dfa = calloc(1, sizeof(*dfa));
+    const char *message = NULL;
+    int root = parse_alt(&ps);
+
+    if (root < 0 || !dfa) {
+        message = ps.error;
+        goto fail;
+    }
+
+    dfa->sets = ps.sets;
+    dfa->nsets = ps.nsets;
+    dfa->groups = ps.groups;
+    ps.sets = NULL;
+
+    dfa->alts = malloc(ps.nalts * sizeof(*dfa->alts));
+    dfa->nalts = ps.nalts;
+    message = "out of memory";
+    if (!dfa->alts)
+        goto fail;
+    for (int i = 0; i < ps.nalts; i++) {
+        dfa->alts[i].first = i == 0 ? 1 : ps.ends[i - 1] + 1;
+        dfa->alts[i].last = ps.ends[i];
+    }
+
+    if ((message = build(&dfa->forward, ps.nodes, root, 0, dfa->alts, dfa->nalts)) != NULL ||
+        (message = build(&dfa->reverse, ps.nodes, root, 1, NULL, 0)) != NULL)
+        goto fail;
+
+    classify(dfa);
+
+    int count = dfa->forward.count > dfa->reverse.count ? dfa->forward.count : dfa->reverse.count;
+
+    dfa->mark = calloc(count, sizeof(*dfa->mark));
+    dfa->stack = malloc(count * sizeof(*dfa->stack));
+    dfa->list = malloc(count * sizeof(*dfa->list));
+    dfa->spare = malloc(count * sizeof(*dfa->spare));
+    message = "out of memory";
+    if (!dfa->mark || !dfa->stack || !dfa->list || !dfa->spare ||
+        grow_table(&dfa->forward) != 0 || grow_table(&dfa->reverse) != 0)
+        goto fail;
+
+    free(ps.nodes);
+    free(ps.ends);
+    return dfa;
+
+fail:
+    snprintf(error, error_size, "%s", message);
+    free(ps.nodes);
+    free(ps.ends);
+    free(ps.sets);
+    dfa_free(dfa);
+    return NULL;
+}
+
+size_t dfa_groups(const struct dfa *dfa) {
+    return dfa->groups;
+}
+
+/* Mark in dfa->starts every position where a match starts: the reverse DFA reads the whole text backwards. */
+static int scan_starts(struct dfa *dfa, const unsigned char *text, size_t len, int begin) {
+    struct program *prog = &dfa->reverse;
+    struct dstate *d = initial(dfa, prog, 1);
+    size_t words = len / 64 + 1;
+
+    if (words > dfa->starts_words) {
+        uint64_t *starts = realloc(dfa->starts, words * sizeof(*starts));
+
+        if (!starts)
+            return REG_ESPACE;
+        dfa->starts = starts;
+        dfa->starts_words = words;
+    }
+    memset(dfa->starts, 0, words * sizeof(*dfa->starts));
+
+    for (size_t i = len; d; i--) {
+        if (accepts(d, i == 0 && begin))
+            dfa->starts[i / 64] |= (uint64_t)1 << (i % 64);
+        if (i == 0)
+            return 0;
+
+        struct dstate *next = d->next[dfa->classes[text[i - 1]]];
+
+        d = next ? next : step(dfa, prog, d, text[i - 1]);
+    }
+    return REG_ESPACE;
+}
+
+/* The first position from from on where a match starts, or SIZE_MAX. */
+static size_t next_start(const struct dfa *dfa, size_t from) {
+    size_t words = dfa->len / 64 + 1;
+    size_t w = from / 64;
+
+    if (from > dfa->len)
+        return SIZE_MAX;
+
+    uint64_t bits = dfa->starts[w] & (~(uint64_t)0 << (from % 64));
+
+    while (!bits) {
+        if (++w == words)
+            return SIZE_MAX;
+        bits = dfa->starts[w];
+    }
+    return w * 64 + __builtin_ctzll(bits);
+}
+
+/* Forget the visits, from pos on. */
+static void new_epoch(struct dfa *dfa, size_t pos) {
+    dfa->base = dfa->reach = pos;
+    dfa->nvisits = 1;
+    dfa->nscans = 0;
+    dfa->flushes = dfa->forward.flushes;
+}
+
+/* Note that scan had d at pos. -1 if out of memory. */
+static int add_visit(struct dfa *dfa, size_t pos, const struct dstate *d, unsigned scan) {
+    if (pos == dfa->reach) {
+        if (pos - dfa->base == dfa->heads_size) {
+            size_t size = dfa->heads_size ? 2 * dfa->heads_size : 1024;
+            unsigned *heads = realloc(dfa->heads, size * sizeof(*heads));
+
+            if (!heads)
+                return -1;
+            dfa->heads = heads;
+            dfa->heads_size = size;
+        }
+        dfa->heads[pos - dfa->base] = 0;
+        dfa->reach++;
+    }
+    if (dfa->nvisits >= dfa->visits_size) {
+        unsigned size = dfa->visits_size ? 2 * dfa->visits_size : 1024;
+        struct visit *visits = size > dfa->visits_size ? realloc(dfa->visits, size * sizeof(*visits)) : NULL;
+
+        if (!visits)
+            return -1;
+        dfa->visits = visits;
+        dfa->visits_size = size;
+    }
+
+    unsigned *head = &dfa->heads[pos - dfa->base];
+
+    dfa->visits[dfa->nvisits] = (struct visit){ d, scan, *head };
+    *head = dfa->nvisits++;
+    return 0;
+}
+
+/* The scan of this epoch that had d at pos, or UINT_MAX. */
+static unsigned find_visit(const struct dfa *dfa, size_t pos, const struct dstate *d) {
+    if (pos >= dfa->reach)
+        return UINT_MAX;
+    for (unsigned v = dfa->heads[pos - dfa->base]; v; v = dfa->visits[v].next)
+        if (dfa->visits[v].d == d)
+            return dfa->visits[v].scan;
+    return UINT_MAX;
+}
+
+/*
+ * Where the longest match from start ends, or SIZE_MAX, and in *alt the
+ * first alternative matching it. A scan that comes to a state that an
+ * earlier one had at the same position would read what it read from
+ * there: it stops and takes its end, if that is not behind. So all the
+ * scans of a text, as those from every a of a line for a(.*b)?, take each
+ * state at most once at each position, unless the cache is flushed.
+ */
+static size_t scan_end(struct dfa *dfa, const unsigned char *text, size_t len, size_t start, int begin,
+                       int *alt, int *error) {
+    struct program *prog = &dfa->forward;
+    struct dstate *d = initial(dfa, prog, start == 0 && begin);
+    size_t end = SIZE_MAX;
+
+    if (start < dfa->base || start >= dfa->reach || dfa->flushes != prog->flushes)
+        new_epoch(dfa, start);
+    if (dfa->nscans == dfa->scans_size) {
+        unsigned size = dfa->scans_size ? 2 * dfa->scans_size : 64;
+        struct scan *scans = size > dfa->scans_size ? realloc(dfa->scans, size * sizeof(*scans)) : NULL;
+
+        if (!scans)
+            goto nomem;
+        dfa->scans = scans;
+        dfa->scans_size = size;
+    }
+
+    unsigned scan = dfa->nscans++;
+
+    for (size_t i = start; d; i++) {
+        /* a flush freed the states of the visits: the scan goes on alone */
+        if (dfa->flushes != prog->flushes) {
+            new_epoch(dfa, i);
+            scan = dfa->nscans++;
+        }
+
+        unsigned earlier = find_visit(dfa, i, d);
+
+        if (earlier != UINT_MAX) {
+            if (dfa->scans[earlier].end != SIZE_MAX && dfa->scans[earlier].end >= i) {
+                end = dfa->scans[earlier].end;
+                *alt = dfa->scans[earlier].alt;
+            }
+            break;
+        }
+        if (add_visit(dfa, i, d, scan) != 0)
+            goto nomem;
+
+        if (accepts(d, i == len)) {
+            end = i;
+            *alt = d->flags & D_MATCH ? d->alt : INT_MAX;
+            if (i == len && (d->flags & D_MATCH_END) && d->alt_end < *alt)
+                *alt = d->alt_end;
+        }
+        if (i == len || (d->flags & D_DEAD))
+            break;
+
+        struct dstate *next = d->next[dfa->classes[text[i]]];
+
+        d = next ? next : step(dfa, prog, d, text[i]);
+    }
+    if (!d)
+        goto nomem;
+    dfa->scans[scan] = (struct scan){ end, *alt };
+    return end;
+
+nomem:
+    dfa->reach = dfa->base;
+    *error = 1;
+    return SIZE_MAX;
+}
+
+/*
+ * Take text for dfa_next(). The reverse DFA reads it once and notes every
+ * position where a match starts. When no match can start after the
+ * beginning of the text, as with a leading ^, it does not run at all. With
+ * REG_NOTBOL in eflags, the text does not begin a line and ^ does not match
+ * at its start, as for regexec().
+ */
+int dfa_start(struct dfa *dfa, const char *text, size_t len, int eflags) {
+    struct dstate *inside = initial(dfa, &dfa->forward, 0);
+
+    if (!inside)
+        return REG_ESPACE;
+    dfa->text = (const unsigned char *)text;
+    dfa->len = len;
+    dfa->begin = !(eflags & REG_NOTBOL);
+    dfa->anchored = (inside->flags & D_DEAD) != 0;
+    dfa->reach = 0;
+    return dfa->anchored ? 0 : scan_starts(dfa, dfa->text, len, dfa->begin);
+}
+
+/*
+ * Find the leftmost-longest match that starts at from or after in the text
+ * of dfa_start(). The forward DFA reads from its start to find where it
+ * ends, and stops where an earlier scan for an end had the same state.
+ */
+int dfa_next(struct dfa *dfa, size_t from, size_t nmatch, regmatch_t pmatch[]) {
+    const unsigned char *t = dfa->text;
+    size_t len = dfa->len;
+    int error = 0, alt = 0;
+    size_t start, end = SIZE_MAX;
+
+    if (dfa->anchored)
+        start = from == 0 && dfa->begin ? 0 : SIZE_MAX;
+    else
+        start = next_start(dfa, from);
+    if (start != SIZE_MAX)
+        end = scan_end(dfa, t, len, start, dfa->begin, &alt, &error);
+
+    if (error)
+        return REG_ESPACE;
+    if (end == SIZE_MAX)
+        return REG_NOMATCH;
+    if (nmatch == 0)
+        return 0;
+
+    for (size_t g = 1; g < nmatch; g++)
+        pmatch[g].rm_so = pmatch[g].rm_eo = -1;
+    pmatch[0].rm_so = start;
+    pmatch[0].rm_eo = end;
+
+    size_t groups = nmatch - 1 < dfa->groups ? nmatch - 1 : dfa->groups;
+
+    if (groups == 0)
+        return 0;
+    return captures(dfa, t, len, start, end, dfa->begin, &dfa->alts[alt], groups, pmatch) == REG_ESPACE ?
+        REG_ESPACE : 0;
+}
+
+/* Find the leftmost-longest match in text. */
+int dfa_exec(struct dfa *dfa, const char *text, size_t len, size_t nmatch, regmatch_t pmatch[], int eflags) {
+    int code = dfa_start(dfa, text, len, eflags);
+
+    return code != 0 ? code : dfa_next(dfa, 0, nmatch, pmatch);
+}
+
+static void free_program(struct program *prog) {
+    for (int i = 0; i < prog->dcount; i++)
+        free(prog->dstates[i]);
+    free(prog->dstates);
+    free(prog->table);
+    free(prog->states);
+}
+
+void dfa_free(struct dfa *dfa) {
+    if (!dfa)
+        return;
+    free_program(&dfa->forward);
+    free_program(&dfa->reverse);
+    free(dfa->sets);
+    free(dfa->alts);
+    free(dfa->mark);
+    free(dfa->stack);
+    free(dfa->list);
+    free(dfa->spare);
+    for (int i = 0; i < 2; i++) {
+        free(dfa->threads[i]);
+        free(dfa->caps[i]);
+    }
+    free(dfa->work);
+    free(dfa->entries);
+    free(dfa->open);
+    free(dfa->starts);
+    free(dfa->heads);
+    free(dfa->visits);
+    free(dfa->scans);
+    free(dfa);
+}
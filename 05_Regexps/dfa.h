@@ -0,0 +1,46 @@
+#ifndef DFA_H
+#define DFA_H
+
+#include <stddef.h>
+#include <regex.h>
+
+/*
+ * Built-in matcher for POSIX extended regular expressions, in time linear
+ * in the text whatever the pattern.
+ *
+ * The pattern becomes two automata. A backward pass over the text with a
+ * lazily built DFA finds the leftmost position where a match starts; a
+ * forward DFA from there finds where the longest match ends, so the match
+ * is the one regexec() reports, and which top-level alternative matches
+ * it first. Groups are then resolved by simulating the NFA of only that
+ * alternative on the matched span, so that a pattern of many
+ * alternatives costs no more per match than one. Within that span, groups
+ * prefer the first alternative and the longest repetition that still make
+ * the whole match, which is what regexec() gives except for some ambiguous
+ * patterns. The only flag of dfa_exec() is REG_NOTBOL.
+ *
+ * dfa_exec() finds the first match of a text. To find them all, give the
+ * text to dfa_start() and call dfa_next() from the end of each match: the
+ * backward pass is done once, and a forward scan stops at a position where
+ * an earlier one was in the same state, so all the matches cost time
+ * linear in the text, times the number of DFA states at worst. The scans
+ * note their states, up to a few words per byte of text while they
+ * overlap. The text must stay as it is until then.
+ *
+ * Supported: literals, ".", bracket expressions with ranges and [:class:],
+ * groups, "|", "*", "+", "?", "{m,n}", "^", "$", and the GNU escapes \w,
+ * \W, \s, \S, \` and \'. Back-references and word boundaries are
+ * rejected. Text is matched byte by byte, as in the C locale.
+ *
+ * A struct dfa caches DFA states as it matches: use one per thread.
+ */
+struct dfa;
+
+struct dfa *dfa_compile(const char *pattern, char *error, size_t error_size);
+size_t dfa_groups(const struct dfa *dfa);
+int dfa_exec(struct dfa *dfa, const char *text, size_t len, size_t nmatch, regmatch_t pmatch[], int eflags);
+int dfa_start(struct dfa *dfa, const char *text, size_t len, int eflags);
+int dfa_next(struct dfa *dfa, size_t from, size_t nmatch, regmatch_t pmatch[]);
+void dfa_free(struct dfa *dfa);
+
+#endif
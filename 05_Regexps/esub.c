@@ -1,115 +1,267 @@
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <regex.h>
+#include <unistd.h>
+
+#include "chunks.h"
+#include "subst.h"
 
-#define MAX_GR 10
 #define ERR_BUF_SIZE 256
 
+/* Most worker threads for -j. */
+#define MAX_WORKERS 256
 
-int main(int argc, char *argv[]) {
 
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <regexp> <substitution> <string>\n", argv[0]);
-        return 1;
-    }
+static int usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-D] <regexp> <substitution> <string>\n", name);
+    fprintf(stderr, "       %s [-D] [-j N] -f <regexp> <substitution> [FILE...]\n", name);
+    fprintf(stderr, "       %s [-D] [-j N] -i <regexp> <substitution> FILE...\n", name);
+    fprintf(stderr, "       %s [-D] [-j N] [-i] -r <rules> [FILE...]\n", name);
+    return 1;
+}
 
-    const char *pattern = argv[1];
-    const char *substitution = argv[2];
-    const char *input = argv[3];
+/* The rules of a rules file, pointing into its text. */
+struct rules {
+    char *text;
+    const char **patterns;
+    const char **substitutions;
+    size_t count;
+};
 
-    regex_t regex;
-    char errbuf[ERR_BUF_SIZE];
+/*
+ * Cut p at the first delim not escaped, dropping the backslash of an
+ * escaped delim. After the delim, or NULL if there is none.
+ */
+static char *cut(char *p, char delim) {
+    char *out = p;
+
+    while (*p && *p != delim) {
+        if (*p == '\\' && p[1] == delim)
+            p++;
+        else if (*p == '\\' && p[1])
+            *out++ = *p++;
+        *out++ = *p++;
+    }
+    if (!*p)
+        return NULL;
+    *out = '\0';
+    return p + 1;
+}
 
-    int code = regcomp(&regex, pattern, REG_EXTENDED);
+/*
+ * Read a rules file: a s/regexp/substitution/g per line, with any delimiter
+ * after the s and & for the whole match, as in sed. The g is required: in a
+ * single pass, every rule replaces every match. Blank lines and lines
+ * starting with # are skipped.
+ */
+static int read_rules(const char *name, struct rules *r) {
+    struct buffer text = { NULL, 0, 0 };
+    FILE *f = fopen(name, "r");
+    size_t lines = 1, number = 0, n;
 
-    if (code != 0) {
-        regerror(code, &regex, errbuf, sizeof(errbuf));
-        fprintf(stderr, "Error: regex compilation error: %s\n", errbuf);
-        return 1;
+    if (!f) {
+        fprintf(stderr, "Error: %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    do {
+        if (buffer_reserve(&text, BUFSIZ + 1) != 0)
+            goto nomem;
+        n = fread(text.data + text.len, 1, text.capacity - text.len - 1, f);
+        text.len += n;
+    } while (n > 0);
+    if (ferror(f)) {
+        fprintf(stderr, "Error: %s: %s\n", name, strerror(errno));
+        goto fail;
     }
+    text.data[text.len] = '\0';
 
-    regmatch_t matches[MAX_GR];
-    code = regexec(&regex, input, MAX_GR, matches, 0);
-
-    if (code == REG_NOMATCH) {
-        printf("%s\n", input);
-        regfree(&regex);
-        return 0;
-    } else if (code != 0) {
-        regerror(code, &regex, errbuf, sizeof(errbuf));
-        fprintf(stderr, "Error: regex match error: %s\n", errbuf);
-        regfree(&regex);
-        return 1;
+    for (size_t i = 0; i < text.len; i++)
+        lines += text.data[i] == '\n';
+
+    r->text = text.data;
+    r->count = 0;
+    r->patterns = malloc(lines * sizeof(*r->patterns));
+    r->substitutions = malloc(lines * sizeof(*r->substitutions));
+    if (!r->patterns || !r->substitutions)
+        goto nomem;
+
+    char *next;
+
+    for (char *line = text.data; line; line = next) {
+        next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+        number++;
+
+        line += strspn(line, " \t\r");
+        if (*line == '\0' || *line == '#')
+            continue;
+
+        char delim = line[1];
+        char *substitution = NULL, *end = NULL;
+
+        if (line[0] == 's' && delim != '\0' && delim != '\\' && (substitution = cut(line + 2, delim)) != NULL)
+            end = cut(substitution, delim);
+        int global = end && *end == 'g';
+
+        if (global)
+            end++;
+        if (!end || end[strspn(end, " \t\r")] != '\0') {
+            fprintf(stderr, "Error: %s:%zu: expected s/regexp/substitution/g\n", name, number);
+            goto fail;
+        }
+        if (!global) {
+            fprintf(stderr, "Error: %s:%zu: rules replace every match: the g flag is required\n", name, number);
+            goto fail;
+        }
+        r->patterns[r->count] = line + 2;
+        r->substitutions[r->count++] = substitution;
     }
+    fclose(f);
+    return 0;
 
-    size_t buffer_size = strlen(input) + strlen(substitution);
-    char *substituted= malloc(buffer_size);
+nomem:
+    fprintf(stderr, "Error: failed to allocate memory for %s.\n", name);
+fail:
+    fclose(f);
+    free(r->patterns);
+    free(r->substitutions);
+    buffer_free(&text);
+    return -1;
+}
 
-    if (!substituted) {
-        fprintf(stderr, "Error: failed to allocate %zu bytes.\n", buffer_size);
-        return 1;
+/*
+ * Substitute the lines of every file, or of the standard input, to the
+ * standard output, or with in_place, in the files themselves.
+ */
+static int substitute_files(char *names[], int count, struct subst substs[], int workers, int in_place) {
+    int status = 0;
+
+    for (int i = 0; i < (count ? count : 1); i++) {
+        const char *name = count ? names[i] : "-";
+
+        if (in_place) {
+            if (chunks_edit(name, substs, workers) != 0)
+                status = 1;
+            continue;
+        }
+
+        int fd = strcmp(name, "-") == 0 ? STDIN_FILENO : open(name, O_RDONLY);
+
+        if (fd < 0) {
+            fprintf(stderr, "Error: %s: %s\n", name, strerror(errno));
+            status = 1;
+            continue;
+        }
+        if (chunks_run(fd, name, STDOUT_FILENO, substs, workers) != 0)
+            status = 1;
+        if (fd != STDIN_FILENO)
+            close(fd);
     }
+    return status;
+}
 
-    substituted[0] = '\0';
-    const char *ch = substitution;
-
-    while (*ch) {
-        if (*ch == '\\') {
-            char next = *(ch + 1);
-
-            if (next >= '0' && next <= '9') {
-                int group_number = atoi(ch + 1);
-
-                 if (group_number >= MAX_GR || matches[group_number].rm_so == -1) {
-                    fprintf(stderr, "Error: invalid capture group \\%d\n", group_number);
-                    free(substituted);
-                    return 1;
-                }
-
-                int start = matches[group_number].rm_so;
-                int end = matches[group_number].rm_eo;
-                strncat(substituted, input + start, end - start);
-                ch += 2;
-             } else if (next == '\\') {  // literal backslash
-                strcat(substituted, "\\");
-                ch += 2;
-            } else if (next != '\0') { // other escaped characters (\/, \<, \>, etc.)
-                size_t len = strlen(substituted);
-                substituted[len] = next;
-                substituted[len + 1] = '\0';
-                ch += 2;
-            } else { // trailing backslash
-                strcat(substituted, "\\");
-                ch++;
-            }
-        } else {
-            size_t len = strlen(substituted);
-            substituted[len] = *ch;
-            substituted[len + 1] = '\0';
-            ch++;
+int main(int argc, char *argv[]) {
+    int use_dfa = 0, files = 0, in_place = 0, workers = 1;
+    const char *rules_file = NULL;
+    int opt;
+    char *end;
+
+    while ((opt = getopt(argc, argv, "Dfij:r:")) != -1) {
+        switch (opt) {
+        case 'D':
+            use_dfa = 1;
+            break;
+        case 'f':
+            files = 1;
+            break;
+        case 'i':
+            files = in_place = 1;
+            break;
+        case 'j':
+            workers = strtol(optarg, &end, 10);
+            if (*optarg == '\0' || *end != '\0' || workers < 0 || workers > MAX_WORKERS)
+                return usage(argv[0]);
+            break;
+        case 'r':
+            rules_file = optarg;
+            files = 1;
+            break;
+        default:
+            return usage(argv[0]);
         }
     }
 
-    char *result = malloc(buffer_size);
+    // the rules file takes the place of <regexp> <substitution>
+    int operands = rules_file ? 0 : 2;
+
+    if (files ? argc - optind < operands + in_place : argc - optind != 3 || workers != 1)
+        return usage(argv[0]);
+
+    // -j 0: a worker per processor
+    if (workers == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
 
-    if (!result) {
-        fprintf(stderr, "Error: failed to allocate %zu bytes.\n", buffer_size);
-        regfree(&regex);
+        workers = online < 1 ? 1 : online > MAX_WORKERS ? MAX_WORKERS : online;
+    }
+
+    const char *pattern = rules_file ? NULL : argv[optind];
+    const char *substitution = rules_file ? NULL : argv[optind + 1];
+    struct rules rules = { NULL, NULL, NULL, 0 };
+    char errbuf[ERR_BUF_SIZE];
+
+    if (rules_file && read_rules(rules_file, &rules) != 0)
         return 1;
+
+    // one per worker thread: a compiled pattern is not shared
+    struct subst *substs = calloc(workers, sizeof(*substs));
+
+    int status = 0, compiled = 0;
+
+    if (!substs) {
+        fprintf(stderr, "Error: failed to allocate %zu bytes.\n", workers * sizeof(*substs));
+        status = 1;
     }
 
-    result[0] = '\0';
+    for (; status == 0 && compiled < workers; compiled++) {
+        struct subst *s = &substs[compiled];
+        int code = rules_file ?
+            subst_compile_rules(s, rules.patterns, rules.substitutions, rules.count, use_dfa, errbuf, sizeof(errbuf)) :
+            subst_compile(s, pattern, substitution, use_dfa, errbuf, sizeof(errbuf));
 
-    strncat(result, input, matches[0].rm_so); // before match
-    strcat(result, substituted); // matched part with substitution
-    strcat(result, input + matches[0].rm_eo); // after match
+        if (code != 0) {
+            if (rules_file)
+                fprintf(stderr, "Error: %s: %s\n", rules_file, errbuf);
+            else
+                fprintf(stderr, "Error: %s\n", errbuf);
+            status = 1;
+            break;
+        }
+    }
 
-    printf("%s\n", result);
+    if (status == 0 && files) {
+        status = substitute_files(argv + optind + operands, argc - optind - operands, substs, workers, in_place);
+    } else if (status == 0) {
+        const char *input = argv[optind + 2];
+        struct buffer result = { NULL, 0, 0 };
 
-    regfree(&regex);
-    free(substituted);
-    free(result);
+        if (subst_apply(&substs[0], input, strlen(input), &result) < 0) {
+            fprintf(stderr, "Error: regex match error: out of memory\n");
+            status = 1;
+        } else {
+            printf("%.*s\n", (int)result.len, result.len ? result.data : "");
+        }
+        buffer_free(&result);
+    }
 
-    return 0;
-}
\ No newline at end of file
+    for (int i = 0; i < compiled; i++)
+        subst_free(&substs[i]);
+    free(substs);
+    free(rules.text);
+    free(rules.patterns);
+    free(rules.substitutions);
+
+    return status;
+}
@@ -0,0 +1,349 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "subst.h"
+
+/* Room for len more bytes. */
+int buffer_reserve(struct buffer *b, size_t len) {
+    if (b->len + len > b->capacity) {
+        size_t capacity = b->capacity ? b->capacity : 256;
+
+        while (capacity < b->len + len)
+            capacity *= 2;
+
+        char *data = realloc(b->data, capacity);
+
+        if (!data)
+            return -1;
+        b->data = data;
+        b->capacity = capacity;
+    }
+    return 0;
+}
+
+int buffer_append(struct buffer *b, const char *s, size_t len) {
+    if (len == 0)
+        return 0;
+    if (buffer_reserve(b, len) != 0)
+        return -1;
+    memcpy(b->data + b->len, s, len);
+    b->len += len;
+    return 0;
+}
+
+void buffer_free(struct buffer *b) {
+    free(b->data);
+    b->data = NULL;
+    b->len = b->capacity = 0;
+}
+
+/*
+ * Cut the substitution of a rule with the given number of groups into
+ * pieces. \0 to \9 are groups, \\ is a backslash and any other escaped
+ * character stands for itself. With ampersand, & is the whole match as in
+ * sed, and \& a literal &.
+ */
+static int parse_substitution(struct rule *r, const char *substitution, size_t groups, int ampersand,
+                              char *error, size_t error_size) {
+    size_t len = strlen(substitution);
+
+    /* at most a piece per character, and the literals are no longer than the substitution */
+    r->pieces = malloc((len + 1) * sizeof(*r->pieces));
+    r->literals = malloc(len + 1);
+    r->count = 0;
+    if (!r->pieces || !r->literals) {
+        snprintf(error, error_size, "failed to allocate %zu bytes.", len + 1);
+        return -1;
+    }
+
+    char *literal = r->literals;
+    const char *ch = substitution;
+
+    while (*ch) {
+        char c = *ch++;
+
+        if (c == '\\' && *ch >= '0' && *ch <= '9') {
+            int group_number = *ch++ - '0';
+
+            if ((size_t)group_number > groups) {
+                snprintf(error, error_size, "invalid capture group \\%d", group_number);
+                return -1;
+            }
+            r->pieces[r->count++] = (struct piece){ NULL, 0, group_number };
+            continue;
+        }
+        if (c == '&' && ampersand) {
+            r->pieces[r->count++] = (struct piece){ NULL, 0, 0 };
+            continue;
+        }
+
+        if (c == '\\' && *ch != '\0')   // \\, \/, \<, \>, etc.
+            c = *ch++;
+
+        if (r->count == 0 || r->pieces[r->count - 1].group >= 0)
+            r->pieces[r->count++] = (struct piece){ literal, 0, -1 };
+        r->pieces[r->count - 1].len++;
+        *literal++ = c;
+    }
+    return 0;
+}
+
+/* Compile the pattern of s, by regcomp() or the DFA. */
+static int compile_pattern(struct subst *s, const char *pattern, int use_dfa, char *error, size_t error_size) {
+    char errbuf[256];
+
+    if (use_dfa) {
+        s->dfa = dfa_compile(pattern, errbuf, sizeof(errbuf));
+        if (!s->dfa) {
+            snprintf(error, error_size, "regex compilation error: %s", errbuf);
+            return -1;
+        }
+        s->groups = dfa_groups(s->dfa);
+    } else {
+        int code = regcomp(&s->regex, pattern, REG_EXTENDED);
+
+        if (code != 0) {
+            regerror(code, &s->regex, errbuf, sizeof(errbuf));
+            snprintf(error, error_size, "regex compilation error: %s", errbuf);
+            return -1;
+        }
+        s->groups = s->regex.re_nsub;
+    }
+
+    s->matches = malloc((s->groups + 1) * sizeof(*s->matches));
+    if (!s->matches) {
+        snprintf(error, error_size, "failed to allocate %zu bytes.", (s->groups + 1) * sizeof(*s->matches));
+        return -1;
+    }
+    return 0;
+}
+
+int subst_compile(struct subst *s, const char *pattern, const char *substitution, int use_dfa,
+                  char *error, size_t error_size) {
+    memset(s, 0, sizeof(*s));
+    s->rules = calloc(1, sizeof(*s->rules));
+    if (!s->rules) {
+        snprintf(error, error_size, "failed to allocate %zu bytes.", sizeof(*s->rules));
+        return -1;
+    }
+    s->count = 1;
+
+    if (compile_pattern(s, pattern, use_dfa, error, error_size) != 0 ||
+        parse_substitution(&s->rules[0], substitution, s->groups, 0, error, error_size) != 0) {
+        subst_free(s);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Append pattern to b with its back-references moved up by shift groups,
+ * bracket expressions being copied as they are. -1 if one goes past \9.
+ */
+static int shift_references(struct buffer *b, const char *pattern, size_t shift) {
+    const char *p = pattern;
+
+    while (*p) {
+        const char *from = p;
+
+        if (*p == '[') {
+            p++;
+            if (*p == '^')
+                p++;
+            if (*p == ']')
+                p++;
+            while (*p && *p != ']') {
+                if (*p == '[' && (p[1] == ':' || p[1] == '=' || p[1] == '.')) {
+                    char close[3] = { p[1], ']', '\0' };
+                    const char *end = strstr(p + 2, close);
+
+                    p = end ? end + 2 : p + strlen(p);
+                } else {
+                    p++;
+                }
+            }
+            if (*p)
+                p++;
+        } else if (*p == '\\' && p[1] >= '1' && p[1] <= '9') {
+            size_t group = p[1] - '0' + shift;
+            char reference[2] = { '\\', '0' + group };
+
+            if (group > 9)
+                return -1;
+            if (buffer_append(b, reference, 2) != 0)
+                return -2;
+            p += 2;
+            continue;
+        } else {
+            p += *p == '\\' && p[1] ? 2 : 1;
+        }
+        if (buffer_append(b, from, p - from) != 0)
+            return -2;
+    }
+    return 0;
+}
+
+/*
+ * Compile rules into a single pattern (p1)|(p2)|...: one scan finds the
+ * leftmost match of any rule, the longest there, and of the rules that
+ * match it the first, whose substitution is applied. Every match of the
+ * text is substituted, in one pass: a rule does not see what the rules
+ * before it substituted, as it would with sed -e ... -e ...
+ */
+int subst_compile_rules(struct subst *s, const char *patterns[], const char *substitutions[], size_t count,
+                        int use_dfa, char *error, size_t error_size) {
+    struct buffer pattern = { NULL, 0, 0 };
+    size_t *groups = malloc(count * sizeof(*groups));
+    size_t shift = 0;
+
+    memset(s, 0, sizeof(*s));
+    s->rules = calloc(count, sizeof(*s->rules));
+    s->global = 1;
+    if (!groups || !s->rules)
+        goto nomem;
+
+    for (size_t i = 0; i < count; i++) {
+        struct subst rule;
+        char errbuf[256];
+        int code = 0;
+
+        /* each rule on its own first, for its errors and its number of groups */
+        if (subst_compile(&rule, patterns[i], substitutions[i], use_dfa, errbuf, sizeof(errbuf)) != 0) {
+            snprintf(error, error_size, "rule %zu: %s", i + 1, errbuf);
+            goto fail;
+        }
+        groups[i] = rule.groups;
+        subst_free(&rule);
+
+        s->rules[i].group = ++shift;
+        if (buffer_append(&pattern, i == 0 ? "(" : "|(", i == 0 ? 1 : 2) != 0 ||
+            (code = shift_references(&pattern, patterns[i], shift)) == -2 ||
+            buffer_append(&pattern, ")", 2) != 0)
+            goto nomem;
+        pattern.len--;      /* the NUL stays after it */
+        if (code != 0) {
+            snprintf(error, error_size, "rule %zu: back-reference past \\9 among the rules", i + 1);
+            goto fail;
+        }
+        shift += groups[i];
+    }
+    s->count = count;
+
+    if (count == 0 || compile_pattern(s, pattern.data, use_dfa, error, error_size) != 0)
+        goto fail;
+    for (size_t i = 0; i < count; i++)
+        if (parse_substitution(&s->rules[i], substitutions[i], groups[i], 1, error, error_size) != 0)
+            goto fail;
+
+    buffer_free(&pattern);
+    free(groups);
+    return 0;
+
+nomem:
+    snprintf(error, error_size, "failed to allocate memory for %zu rules.", count);
+fail:
+    if (count == 0)
+        snprintf(error, error_size, "no rules");
+    buffer_free(&pattern);
+    free(groups);
+    subst_free(s);
+    return -1;
+}
+
+/*
+ * The first match in text from start on, into s->matches: 0, REG_NOMATCH
+ * or an error code. Offsets are from text, which start > 0 does not begin.
+ * The matches of a text are looked for from start 0 on, then from the end
+ * of each: the DFA reads the text backwards once, at 0, for all of them.
+ */
+int subst_match(struct subst *s, const char *text, size_t start, size_t len) {
+    regmatch_t *m = s->matches;
+
+    if (s->dfa) {
+        int code = start == 0 ? dfa_start(s->dfa, text, len, 0) : 0;
+
+        return code != 0 ? code : dfa_next(s->dfa, start, s->groups + 1, m);
+    }
+
+    m[0].rm_so = start;
+    m[0].rm_eo = len;
+    return regexec(&s->regex, text, s->groups + 1, m, (start > 0 ? REG_NOTBOL : 0) | REG_STARTEND);
+}
+
+/*
+ * Append text to out with its first match substituted, or every one if
+ * s->global. 1 if there was a match, 0 if not, -1 if out of memory. A
+ * group that took no part in the match is empty. As in sed, an empty
+ * match right after the previous one is not substituted.
+ */
+int subst_apply(struct subst *s, const char *text, size_t len, struct buffer *out) {
+    const regmatch_t *m = s->matches;
+    size_t copied = 0;          /* text before is in out */
+    size_t last = SIZE_MAX;     /* where the last match ended */
+    int found = 0;
+
+    for (size_t at = 0; at <= len; ) {
+        int code = subst_match(s, text, at, len);
+
+        if (code == REG_NOMATCH)
+            break;
+        if (code != 0)
+            return -1;
+
+        size_t start = m[0].rm_so, end = m[0].rm_eo;
+
+        if (start == end && start == last) {
+            at = start + 1;
+            continue;
+        }
+
+        /* the rule that matched */
+        const struct rule *r = s->rules;
+
+        while (r < s->rules + s->count - 1 && m[r->group].rm_so < 0)
+            r++;
+
+        if (buffer_append(out, text + copied, start - copied) != 0)   // before match
+            return -1;
+
+        for (size_t i = 0; i < r->count; i++) {
+            const struct piece *p = &r->pieces[i];
+            const char *from = p->text;
+            size_t n = p->len;
+
+            if (p->group >= 0) {
+                const regmatch_t *g = &m[r->group + p->group];
+
+                from = text + g->rm_so;
+                n = g->rm_so < 0 ? 0 : g->rm_eo - g->rm_so;
+            }
+            if (buffer_append(out, from, n) != 0)
+                return -1;
+        }
+
+        found = 1;
+        copied = last = end;
+        if (!s->global)
+            break;
+        at = end > start ? end : end + 1;
+    }
+
+    // after match
+    return buffer_append(out, text + copied, len - copied) == 0 ? found : -1;
+}
+
+void subst_free(struct subst *s) {
+    if (s->dfa)
+        dfa_free(s->dfa);
+    else
+        regfree(&s->regex);
+    for (size_t i = 0; s->rules && i < s->count; i++) {
+        free(s->rules[i].pieces);
+        free(s->rules[i].literals);
+    }
+    free(s->rules);
+    free(s->matches);
+    memset(s, 0, sizeof(*s));
+}
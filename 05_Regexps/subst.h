@@ -0,0 +1,58 @@
+#ifndef SUBST_H
+#define SUBST_H
+
+#include <stddef.h>
+#include <regex.h>
+
+#include "dfa.h"
+
+/* A growing output buffer. */
+struct buffer {
+    char *data;
+    size_t len;
+    size_t capacity;
+};
+
+int buffer_reserve(struct buffer *b, size_t len);
+int buffer_append(struct buffer *b, const char *s, size_t len);
+void buffer_free(struct buffer *b);
+
+/* A piece of a substitution: literal text, or a group when group >= 0. */
+struct piece {
+    const char *text;
+    size_t len;
+    int group;
+};
+
+/* The substitution of a rule, and the group of the pattern its own groups start from. */
+struct rule {
+    struct piece *pieces;
+    size_t count;
+    char *literals;         /* text of the literal pieces */
+    size_t group;           /* its whole match; its group n is group + n */
+};
+
+/*
+ * A compiled s/regexp/substitution/, or a set of them: the pattern, by
+ * regcomp() or by the built-in DFA, and each substitution cut into
+ * pieces. A subst holds match state, so each thread needs its own.
+ */
+struct subst {
+    regex_t regex;
+    struct dfa *dfa;        /* instead of regex, with -D */
+    size_t groups;
+    regmatch_t *matches;    /* groups + 1, of the last match */
+    struct rule *rules;
+    size_t count;
+    int global;             /* substitute every match, not only the first */
+};
+
+int subst_compile(struct subst *s, const char *pattern, const char *substitution, int use_dfa,
+                  char *error, size_t error_size);
+int subst_compile_rules(struct subst *s, const char *patterns[], const char *substitutions[], size_t count,
+                        int use_dfa, char *error, size_t error_size);
+int subst_match(struct subst *s, const char *text, size_t start, size_t len);
+int subst_apply(struct subst *s, const char *text, size_t len, struct buffer *out);
+void subst_free(struct subst *s);
+
+#endif
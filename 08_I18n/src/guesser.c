@@ -4,46 +4,69 @@
 #include <locale.h>
 #include <libintl.h>
 #include "config.h"
+#include "search.h"
 
 #define _(STRING) gettext(STRING)
 
 
-int main(void) {
+/* Translated strings of the question loop, looked up once instead of on every question. */
+struct messages {
+    const char *ask;
+    const char *yes;
+    const char *no;
+    const char *read_error;
+    const char *invalid;
+};
 
-    setlocale(LC_ALL, "");
-    bindtextdomain("guesser", LOCALE_PATH);
-    textdomain("guesser");
+static void load_messages(struct messages *msg) {
+    msg->ask = _("Is the number greater than %d? (Yes/No): ");
+    msg->yes = _("Yes");
+    msg->no = _("No");
+    msg->read_error = _("Error: failed to read input.\n");
+    msg->invalid = _("Invalid input. Please type exactly 'Yes' or 'No'.\n");
+}
 
-    int low = 1;
-    int high = 100;
-    int mid;
+/* Ask the user whether the number is greater than guess, until the answer is Yes or No. */
+static int ask_user(int64_t guess, void *data) {
+    const struct messages *msg = data;
     char input[128];
 
-    printf(_("Choose a random number between 1 and 100.\n"));
-
-    while (low <= high) {
-        mid = (low + high) / 2;
-        printf(_("Is the number greater than %d? (Yes/No): "), mid);
+    while (1) {
+        printf(msg->ask, (int)guess);
 
         if (fgets(input, sizeof(input), stdin) == NULL) {
-            fprintf(stderr, _("Error: failed to read input.\n"));
-            return 1;
+            fputs(msg->read_error, stderr);
+            return -1;
         }
 
         input[strcspn(input, "\n")] = 0;
 
-        if (strcmp(input, _("Yes")) == 0) {
-            low = mid + 1;
-        } else if (strcmp(input, _("No")) == 0) {
-            high = mid;
-        } else {
-            fprintf(stderr, _("Invalid input. Please type exactly 'Yes' or 'No'.\n"));
-        }
+        if (strcmp(input, msg->yes) == 0)
+            return 1;
+        if (strcmp(input, msg->no) == 0)
+            return 0;
 
-        if (low == high) break;
+        fputs(msg->invalid, stderr);
     }
+}
+
+int main(void) {
+
+    setlocale(LC_ALL, "");
+    bindtextdomain("guesser", LOCALE_PATH);
+    textdomain("guesser");
+
+    struct messages msg;
+    struct search_result result;
+
+    load_messages(&msg);
+
+    printf(_("Choose a random number between 1 and 100.\n"));
+
+    if (search_interval(1, 100, ask_user, &msg, &result) != 0)
+        return 1;
 
-    printf(_("The number is %d!\n"), low);
+    printf(_("The number is %d!\n"), (int)result.value);
 
     return 0;
 }
@@ -0,0 +1,71 @@
+/**
+ * @file search.h
+ * @brief Bisection over an integer interval driven by a yes/no oracle.
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Question callback of ::search_interval.
+ *
+ * Answers whether the hidden number is greater than @p guess.
+ *
+ * @param guess Current guess.
+ * @param data User data passed to ::search_interval.
+ * @return 1 if the hidden number is greater, 0 if it is not,
+ *         -1 to abort the search (e.g. on end of input).
+ */
+typedef int (*search_oracle)(int64_t guess, void *data);
+
+/** @brief Outcome of a search. */
+struct search_result {
+    int64_t value;      /**< Number found */
+    unsigned questions; /**< Number of oracle calls */
+};
+
+/**
+ * @brief Find a number in [@p low, @p high] by asking the oracle.
+ *
+ * Asks at most ⌈log₂(high - low + 1)⌉ questions, 64 for the whole
+ * int64_t range.
+ *
+ * @param low Lower bound, inclusive.
+ * @param high Upper bound, inclusive.
+ * @param oracle Question callback.
+ * @param data User data for @p oracle.
+ * @param result Filled with the number found and the questions asked.
+ * @return 0 on success, -1 if @p low > @p high or the oracle aborted.
+ */
+int search_interval(int64_t low, int64_t high, search_oracle oracle, void *data,
+                    struct search_result *result);
+
+/**
+ * @brief Find a known number, answering the questions automatically.
+ *
+ * @param low Lower bound, inclusive.
+ * @param high Upper bound, inclusive.
+ * @param target Hidden number, must lie in [@p low, @p high].
+ * @param result Filled as by ::search_interval.
+ * @return 0 on success, -1 if @p target is outside the interval.
+ */
+int search_target(int64_t low, int64_t high, int64_t target, struct search_result *result);
+
+/**
+ * @brief Maximum number of questions for the interval [@p low, @p high].
+ *
+ * @return ⌈log₂(high - low + 1)⌉, or 0 if @p low >= @p high.
+ */
+unsigned search_max_questions(int64_t low, int64_t high);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
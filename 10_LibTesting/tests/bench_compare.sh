@@ -0,0 +1,45 @@
+#!/bin/sh
+
+# Compare a bench_growbuf JSON report against a stored baseline.
+# Fails if the throughput of any benchmark dropped by more than
+# BENCH_TOLERANCE percent (default 10) or if it needs more reallocs.
+
+CURRENT="$1"
+BASELINE="$2"
+TOLERANCE="${BENCH_TOLERANCE:-10}"
+
+if [ $# -ne 2 ]; then
+    echo "Usage: $0 current.json baseline.json" >&2
+    exit 1
+fi
+
+if [ ! -f "$BASELINE" ]; then
+    echo "No baseline $BASELINE, run 'make bench-baseline' to store one."
+    exit 0
+fi
+
+extract() {
+    sed -n 's/.*"name": "\([a-z]*\)".*"ops_per_sec": \([0-9]*\), "realloc_calls": \([0-9]*\).*/\1 \2 \3/p' "$1"
+}
+
+extract "$BASELINE" > bench_baseline.tmp
+extract "$CURRENT" | awk -v tol="$TOLERANCE" '
+    NR == FNR { base_ops[$1] = $2; base_realloc[$1] = $3; next }
+    {
+        if (!($1 in base_ops)) {
+            printf "%-6s %12d ops/s  (no baseline)\n", $1, $2
+            next
+        }
+        change = base_ops[$1] > 0 ? 100.0 * ($2 - base_ops[$1]) / base_ops[$1] : 0
+        status = "ok"
+        if (change < -tol) { status = "SLOWER"; failed = 1 }
+        if ($3 > base_realloc[$1]) { status = status " MORE-REALLOCS"; failed = 1 }
+        printf "%-6s %12d ops/s  %+7.1f%%  reallocs %d (was %d)  %s\n",
+               $1, $2, change, $3, base_realloc[$1], status
+    }
+    END { exit failed }
+' bench_baseline.tmp -
+status=$?
+
+rm -f bench_baseline.tmp
+exit $status
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+
+// count every reallocation done by buf_grow1
+static size_t realloc_calls = 0;
+
+static void *counting_realloc(void *ptr, size_t size) {
+    realloc_calls++;
+    return realloc(ptr, size);
+}
+
+#define realloc counting_realloc
+#include "growable_buf.h"
+#undef realloc
+
+
+#define PUSH_COUNT  (10 * 1000 * 1000)
+#define GROW_COUNT  (200 * 1000)
+#define GROW_STEP   16
+#define TRUNC_COUNT (200 * 1000)
+#define TRUNC_LOW   64
+#define TRUNC_HIGH  4096
+
+struct result {
+    const char *name;
+    size_t ops;
+    double seconds;
+    size_t reallocs;
+};
+
+static volatile long sink;
+
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void finish(struct result *res, double start, size_t reallocs_before) {
+    res->seconds = now() - start;
+    res->reallocs = realloc_calls - reallocs_before;
+}
+
+
+static void bench_push_pop(struct result *push, struct result *pop) {
+    long *buf = NULL;
+    size_t before = realloc_calls;
+    double start = now();
+
+    for (long i = 0; i < PUSH_COUNT; i++)
+        buf_push(buf, i);
+
+    push->name = "push";
+    push->ops = PUSH_COUNT;
+    finish(push, start, before);
+
+    long sum = 0;
+    before = realloc_calls;
+    start = now();
+
+    while (buf_size(buf) > 0)
+        sum += buf_pop(buf);
+
+    pop->name = "pop";
+    pop->ops = PUSH_COUNT;
+    finish(pop, start, before);
+
+    sink = sum;
+    buf_free(buf);
+}
+
+static void bench_grow(struct result *res) {
+    int *buf = NULL;
+    size_t before = realloc_calls;
+    double start = now();
+
+    for (int i = 0; i < GROW_COUNT; i++)
+        buf_grow(buf, GROW_STEP);
+
+    res->name = "grow";
+    res->ops = GROW_COUNT;
+    finish(res, start, before);
+
+    sink = buf_capacity(buf);
+    buf_free(buf);
+}
+
+static void bench_trunc(struct result *res) {
+    int *buf = NULL;
+    buf_grow(buf, TRUNC_HIGH);
+
+    size_t before = realloc_calls;
+    double start = now();
+
+    for (int i = 0; i < TRUNC_COUNT; i++) {
+        buf_trunc(buf, TRUNC_LOW);
+        buf_trunc(buf, TRUNC_HIGH);
+    }
+
+    res->name = "trunc";
+    res->ops = 2 * TRUNC_COUNT;
+    finish(res, start, before);
+
+    sink = buf_capacity(buf);
+    buf_free(buf);
+}
+
+
+// one result per line so that bench_compare.sh can parse it with awk
+static void print_json(FILE *out, const struct result *res, int count) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"growbuf\",\n");
+    fprintf(out, "  \"peak_rss_kb\": %ld,\n", usage.ru_maxrss);
+    fprintf(out, "  \"results\": [\n");
+
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "    {\"name\": \"%s\", \"ops\": %zu, \"seconds\": %.6f, "
+                     "\"ops_per_sec\": %.0f, \"realloc_calls\": %zu}%s\n",
+                res[i].name, res[i].ops, res[i].seconds,
+                res[i].seconds > 0 ? res[i].ops / res[i].seconds : 0.0,
+                res[i].reallocs, i + 1 < count ? "," : "");
+    }
+
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+
+int main(int argc, char *argv[]) {
+    struct result res[4];
+    FILE *out = stdout;
+
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [output.json]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "-") != 0) {
+        out = fopen(argv[1], "w");
+        if (!out) {
+            fprintf(stderr, "Error opening file: %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    bench_push_pop(&res[0], &res[1]);
+    bench_grow(&res[2]);
+    bench_trunc(&res[3]);
+
+    print_json(out, res, 4);
+
+    if (out != stdout)
+        fclose(out);
+
+    return 0;
+}
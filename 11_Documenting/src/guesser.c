@@ -5,21 +5,60 @@
  * This program asks the user to think of a number between 1 and 100 and
  * tries to guess it using a binary search algorithm. The program can
  * optionally display numbers in the Roman numeral system using the -r
- * command-line option.
+ * command-line option. The range can be changed with -l and -u, and the
+ * -s option solves a list of hidden numbers without asking the user.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
 #include <locale.h>
 #include <libintl.h>
 #include <unistd.h>
 #include "config.h"
 #include "roman.h"
+#include "search.h"
 
 /** @brief Macro for internationalization */
 #define _(STRING) gettext(STRING)
 
+/**
+ * @brief Translated strings used inside the guessing loop.
+ *
+ * Resolved once by ::load_messages so that every question does not go
+ * through the catalog lookup again; reload it after changing the locale.
+ */
+struct messages {
+    const char *ask_roman;   /**< Question with a Roman numeral */
+    const char *ask_decimal; /**< Question with a decimal number */
+    const char *yes;         /**< Positive answer */
+    const char *no;          /**< Negative answer */
+    const char *read_error;  /**< Input could not be read */
+    const char *invalid;     /**< Answer is neither yes nor no */
+};
+
+/** @brief Options of the interactive oracle ::ask_user. */
+struct prompt {
+    int use_roman;               /**< Display numbers as Roman numerals */
+    const struct messages *msg;  /**< Translated strings */
+};
+
+/**
+ * @brief Resolve the translations of the guessing loop strings.
+ *
+ * @param msg Structure to fill.
+ */
+static void load_messages(struct messages *msg) {
+    msg->ask_roman = _("Is the number greater than %s? (Yes/No): ");
+    msg->ask_decimal = _("Is the number greater than %lld? (Yes/No): ");
+    msg->yes = _("Yes");
+    msg->no = _("No");
+    msg->read_error = _("Error: failed to read input.\n");
+    msg->invalid = _("Invalid input. Please type exactly 'Yes' or 'No'.\n");
+}
+
 /**
  * @brief Print program usage and options.
  *
@@ -32,6 +71,9 @@ void print_help(const char *prog_name) {
     printf(_("Usage: %s [OPTIONS]\n"), prog_name);
     printf(_("Options:\n"));
     printf(_("\t-r       Use Roman numerals\n"));
+    printf(_("\t-l LOW   Lower bound of the range (default 1)\n"));
+    printf(_("\t-u HIGH  Upper bound of the range (default 100)\n"));
+    printf(_("\t-s       Solve the hidden numbers read from stdin, one per line\n"));
     printf(_("\t-h       Show help message\n"));
     printf(_("\t--help   Show help message\n"));
 
@@ -39,6 +81,130 @@ void print_help(const char *prog_name) {
     printf(_("It uses a binary search algorithm and optionally displays numbers in Roman numerals.\n"));
 }
 
+/**
+ * @brief Interactive oracle: ask the user about the current guess.
+ *
+ * Repeats the question until the user answers exactly "Yes" or "No".
+ *
+ * @param guess Current guess.
+ * @param data Pointer to a struct prompt.
+ *
+ * @return 1 for "Yes", 0 for "No", -1 if the input could not be read.
+ */
+static int ask_user(int64_t guess, void *data) {
+    const struct prompt *prompt = data;
+    const struct messages *msg = prompt->msg;
+    char input[128]; /**< Buffer for user input */
+    char roman[ROMAN_BUF_SIZE]; /**< Roman numeral of the guess */
+
+    while (1) {
+        if (prompt->use_roman) printf(msg->ask_roman, to_roman((int)guess, roman, sizeof(roman)));
+        else printf(msg->ask_decimal, (long long)guess);
+
+        if (fgets(input, sizeof(input), stdin) == NULL) {
+            fputs(msg->read_error, stderr);
+            return -1;
+        }
+
+        /** @brief Remove trailing newline from input */
+        input[strcspn(input, "\n")] = 0;
+
+        if (strcmp(input, msg->yes) == 0)
+            return 1;
+        if (strcmp(input, msg->no) == 0)
+            return 0;
+
+        fputs(msg->invalid, stderr);
+    }
+}
+
+/**
+ * @brief Parse a number given as decimal or, with @p use_roman, as a Roman numeral.
+ *
+ * @param str Input string.
+ * @param use_roman Accept Roman numerals instead of decimal numbers.
+ * @param value Set to the parsed number.
+ *
+ * @return 0 on success, -1 if @p str is not a valid number.
+ */
+static int parse_number(const char *str, int use_roman, int64_t *value) {
+    if (use_roman) {
+        int roman = from_roman(str);
+        if (roman < 0)
+            return -1;
+        *value = roman;
+        return 0;
+    }
+
+    char *end;
+    errno = 0;
+    long long parsed = strtoll(str, &end, 10);
+
+    if (errno != 0 || end == str || *end != '\0')
+        return -1;
+
+    *value = parsed;
+    return 0;
+}
+
+/**
+ * @brief Non-interactive mode: solve every hidden number read from stdin.
+ *
+ * For every input line prints the number found, the questions asked and
+ * the solve time in nanoseconds, then a summary on stderr.
+ *
+ * @param low Lower bound of the range.
+ * @param high Upper bound of the range.
+ * @param use_roman Read the hidden numbers as Roman numerals.
+ *
+ * @return 0 on success, 1 if a line is not a number inside the range.
+ */
+static int solve_script(int64_t low, int64_t high, int use_roman) {
+    char line[128];
+    unsigned long long solved = 0;
+    unsigned max_questions = 0;
+    double total_ns = 0;
+
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        line[strcspn(line, "\n")] = 0;
+        if (line[0] == '\0')
+            continue;
+
+        int64_t target;
+        struct search_result result;
+        struct timespec start, end;
+
+        if (parse_number(line, use_roman, &target) != 0) {
+            fprintf(stderr, _("Error: invalid number '%s'.\n"), line);
+            return 1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int code = search_target(low, high, target, &result);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (code != 0) {
+            fprintf(stderr, _("Error: %s is outside of the range.\n"), line);
+            return 1;
+        }
+
+        double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+
+        printf("%lld %u %.0f\n", (long long)result.value, result.questions, ns);
+
+        solved++;
+        total_ns += ns;
+        if (result.questions > max_questions)
+            max_questions = result.questions;
+    }
+
+    fprintf(stderr, _("Solved %llu numbers, at most %u questions (limit %u), %.0f ns per solve.\n"),
+            solved, max_questions, search_max_questions(low, high),
+            solved ? total_ns / solved : 0.0);
+
+    return 0;
+}
+
 /**
  * @brief Main entry point for the guesser program.
  *
@@ -53,6 +219,8 @@ void print_help(const char *prog_name) {
  *
  * @note Command-line options:
  *  - -r : Use Roman numerals instead of Arabic numbers.
+ *  - -l LOW, -u HIGH : Bounds of the range (1 and 100 by default).
+ *  - -s : Solve hidden numbers read from stdin without asking.
  *  - -h : Display this help message and exit.
  */
 int main(int argc, char *argv[]) {
@@ -63,58 +231,62 @@ int main(int argc, char *argv[]) {
     textdomain("guesser");
 
     int use_roman = 0; /**< Flag to indicate whether to use Roman numerals */
+    int script = 0; /**< Flag to indicate the non-interactive mode */
+    int64_t low = 1; /**< Lower bound of the guessing range */
+    int64_t high = 100; /**< Upper bound of the guessing range */
 
     int opt;
-    while ((opt = getopt(argc, argv, "rh")) != -1) {
+    while ((opt = getopt(argc, argv, "rhl:u:s")) != -1) {
         switch (opt) {
             case 'r':
                 /** @brief Enable Roman numeral display */
                 use_roman = 1;
                 break;
+            case 'l':
+            case 'u':
+                if (parse_number(optarg, 0, opt == 'l' ? &low : &high) != 0) {
+                    fprintf(stderr, _("Error: invalid number '%s'.\n"), optarg);
+                    return 1;
+                }
+                break;
+            case 's':
+                script = 1;
+                break;
             case 'h':
                 print_help(argv[0]);
                 return 0;
         }
     }
 
-    int low = 1; /**< Lower bound of the guessing range */
-    int high = 100; /**< Upper bound of the guessing range */
-    int mid; /**< Current guess */
-    char input[128]; /**< Buffer for user input */
-
-    /** @brief Prompt the user to choose a number */
-    if (use_roman) printf(_("Choose a random number between %s and %s.\n"), to_roman(low), to_roman(high));
-    else printf(_("Choose a random number between %d and %d.\n"), low, high);
-
-    /** @brief Main guessing loop using binary search */
-    while (low <= high) {
-        mid = (low + high) / 2;
+    if (low > high || (use_roman && (low < ROMAN_MIN || high > ROMAN_MAX))) {
+        fprintf(stderr, _("Error: invalid range.\n"));
+        return 1;
+    }
 
-        if (use_roman) printf(_("Is the number greater than %s? (Yes/No): "), to_roman(mid));
-        else printf(_("Is the number greater than %d? (Yes/No): "), mid);
+    if (script)
+        return solve_script(low, high, use_roman);
 
-        if (fgets(input, sizeof(input), stdin) == NULL) {
-            fprintf(stderr, _("Error: failed to read input.\n"));
-            return 1;
-        }
+    char roman_low[ROMAN_BUF_SIZE]; /**< Roman numeral of the lower bound */
+    char roman_high[ROMAN_BUF_SIZE]; /**< Roman numeral of the upper bound */
+    struct messages msg;
+    struct prompt prompt = { use_roman, &msg };
+    struct search_result result;
 
-        /** @brief Remove trailing newline from input */
-        input[strcspn(input, "\n")] = 0;
+    load_messages(&msg);
 
-        if (strcmp(input, _("Yes")) == 0) {
-            low = mid + 1;
-        } else if (strcmp(input, _("No")) == 0) {
-            high = mid;
-        } else {
-            fprintf(stderr, _("Invalid input. Please type exactly 'Yes' or 'No'.\n"));
-        }
+    /** @brief Prompt the user to choose a number */
+    if (use_roman) printf(_("Choose a random number between %s and %s.\n"),
+                          to_roman((int)low, roman_low, sizeof(roman_low)),
+                          to_roman((int)high, roman_high, sizeof(roman_high)));
+    else printf(_("Choose a random number between %lld and %lld.\n"), (long long)low, (long long)high);
 
-        if (low == high) break;
-    }
+    /** @brief Guess the number by binary search, asking the user */
+    if (search_interval(low, high, ask_user, &prompt, &result) != 0)
+        return 1;
 
     /** @brief Print the guessed number */
-    if (use_roman) printf(_("The number is %s!\n"), to_roman(low));
-    else printf(_("The number is %d!\n"), low);
+    if (use_roman) printf(_("The number is %s!\n"), to_roman((int)result.value, roman_low, sizeof(roman_low)));
+    else printf(_("The number is %lld!\n"), (long long)result.value);
 
     return 0;
 }
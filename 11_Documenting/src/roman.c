@@ -1,87 +1,201 @@
 /**
  * @file roman.c
- * @brief Conversion between Arabic numbers (1–100) and Roman numerals.
+ * @brief Conversion between Arabic numbers (1–3999) and Roman numerals.
  *
- * This file implements two main functions:
+ * This file implements the scalar functions:
  *   - ::to_roman — convert an integer to a Roman numeral string
  *   - ::from_roman — convert a Roman numeral to an integer
  *
- * The implementation uses a static lookup table for all values from 1 to 100,
- * which ensures constant-time conversion to Roman numerals, and a simple
- * linear search for the reverse conversion (which is sufficient for the small range).
+ * and their batch counterparts ::to_roman_batch and ::from_roman_batch.
+ *
+ * Both directions work one decimal place at a time, from the constant
+ * tables of roman_tables.h, which roman.hpp shares:
+ *   - the numeral of every digit in every place, which ::to_roman copies
+ *     into the caller's buffer;
+ *   - a deterministic automaton accepting exactly the canonical numerals,
+ *     which ::from_roman runs over the input in a single pass.
  */
 
+#include <stdint.h>
 #include <string.h>
-#include <ctype.h>
 #include "roman.h"
+#include "roman_tables.h"
 
 /**
- * @brief Lookup table mapping integers 1–100 to Roman numerals.
+ * @brief Symbol class of every byte, case-insensitive; 0 means invalid.
  *
- * This table provides fast conversion in ::to_roman.
- * Index 0 is unused and always NULL.
+ * Columns of ::roman_next and ::roman_add.
  */
-static const char *roman_table[101] = {
-    NULL,
-    "I", "II", "III", "IV", "V", "VI", "VII", "VIII", "IX", "X",
-    "XI", "XII", "XIII", "XIV", "XV", "XVI", "XVII", "XVIII", "XIX", "XX",
-    "XXI", "XXII", "XXIII", "XXIV", "XXV", "XXVI", "XXVII", "XXVIII", "XXIX", "XXX",
-    "XXXI", "XXXII", "XXXIII", "XXXIV", "XXXV", "XXXVI", "XXXVII", "XXXVIII", "XXXIX", "XL",
-    "XLI", "XLII", "XLIII", "XLIV", "XLV", "XLVI", "XLVII", "XLVIII", "XLIX", "L",
-    "LI", "LII", "LIII", "LIV", "LV", "LVI", "LVII", "LVIII", "LIX", "LX",
-    "LXI", "LXII", "LXIII", "LXIV", "LXV", "LXVI", "LXVII", "LXVIII", "LXIX", "LXX",
-    "LXXI", "LXXII", "LXXIII", "LXXIV", "LXXV", "LXXVI", "LXXVII", "LXXVIII", "LXXIX", "LXXX",
-    "LXXXI", "LXXXII", "LXXXIII", "LXXXIV", "LXXXV", "LXXXVI", "LXXXVII", "LXXXVIII", "LXXXIX", "XC",
-    "XCI", "XCII", "XCIII", "XCIV", "XCV", "XCVI", "XCVII", "XCVIII", "XCIX", "C"
+static const unsigned char symbol_class[256] = {
+    ['I'] = 1, ['V'] = 2, ['X'] = 3, ['L'] = 4, ['C'] = 5, ['D'] = 6, ['M'] = 7,
+    ['i'] = 1, ['v'] = 2, ['x'] = 3, ['l'] = 4, ['c'] = 5, ['d'] = 6, ['m'] = 7
 };
 
 /**
- * @brief Convert an integer to a Roman numeral.
+ * @brief Write the numeral of @p value without range checks.
  *
- * Converts values in the range **1..100** to their Roman numeral equivalents.
- * The returned string is a pointer to a static lookup table and **must not be freed**.
+ * @param value An integer between ROMAN_MIN and ROMAN_MAX.
+ * @param out Output buffer, at least ROMAN_BUF_SIZE bytes.
  *
- * @param value An integer between 1 and 100.
+ * @return Length of the numeral, the terminator is written after it.
+ */
+static size_t encode(int value, char *out) {
+    const int digits[ROMAN_PLACES] = { value / 1000, value / 100 % 10, value / 10 % 10, value % 10 };
+    size_t len = 0;
+
+    for (int place = 0; place < ROMAN_PLACES; place++) {
+        memcpy(out + len, roman_place_digits[place][digits[place]], 4);
+        len += roman_place_digit_len[place][digits[place]];
+    }
+
+    out[len] = '\0';
+    return len;
+}
 
- * @return A pointer to a Roman numeral string,
- *         or `NULL` if the value is outside the supported range.
+/**
+ * @brief Run the parsing automaton over a numeral.
+ *
+ * @param roman A null-terminated string.
+ *
+ * @return The value, or -1 if the string is not a canonical numeral.
  */
-const char *to_roman(int value) {
-    if (value < 1 || value > 100)
+static int decode(const char *roman) {
+    const unsigned char *p = (const unsigned char *)roman;
+    unsigned state = ROMAN_S_START;
+    int value = 0;
+
+    for (; *p; p++) {
+        unsigned cls = symbol_class[*p];
+
+        value += roman_add[state][cls];
+        state = roman_next[state][cls];
+
+        if (state == ROMAN_S_DEAD)
+            return -1;
+    }
+
+    return value > 0 ? value : -1;
+}
+
+/**
+ * @brief Convert an integer to a Roman numeral.
+ *
+ * Converts values in the range **1..3999** to their Roman numeral equivalents.
+ * The numeral is written into @p buf, which needs at most ROMAN_BUF_SIZE
+ * bytes (the longest numeral is MMMDCCCLXXXVIII).
+ *
+ * @param value An integer between ROMAN_MIN and ROMAN_MAX.
+ * @param buf Output buffer.
+ * @param size Size of @p buf in bytes.
+ *
+ * @return @p buf holding a null-terminated Roman numeral,
+ *         or `NULL` if the value is outside the supported range
+ *         or the buffer is too small.
+ */
+const char *to_roman(int value, char *buf, size_t size) {
+    if (value < ROMAN_MIN || value > ROMAN_MAX || !buf)
         return NULL;
-    return roman_table[value];
+
+    if (size >= ROMAN_BUF_SIZE) {
+        encode(value, buf);
+        return buf;
+    }
+
+    char tmp[ROMAN_BUF_SIZE];
+    size_t len = encode(value, tmp);
+
+    if (len >= size)
+        return NULL;
+
+    memcpy(buf, tmp, len + 1);
+    return buf;
 }
 
 /**
  * @brief Parse a Roman numeral and convert it to an integer.
  *
- * Handles Roman numerals in the range **I..C** (1–100).
+ * Handles canonical Roman numerals in the range **I..MMMCMXCIX** (1–3999).
  * The function is case-insensitive: `"xiv"` and `"XIV"` are equivalent.
+ * Non-canonical forms such as `"IIII"`, `"VX"` or `"IC"` are rejected.
  *
  * @param roman A null-terminated string containing a Roman numeral.
  *
- * @return The corresponding integer value (1–100),
+ * @return The corresponding integer value (1–3999),
  *         or **-1** if the input is invalid, NULL, or outside the supported range.
  */
 int from_roman(const char *roman) {
     if (!roman)
         return -1;
 
-    char buf[32];
-    size_t len = strlen(roman);
-    if (len >= sizeof(buf))
-        return -1;
+    return decode(roman);
+}
+
+/**
+ * @brief Convert an array of integers to packed Roman numerals.
+ *
+ * Numerals are stored back to back in @p out, each followed by a null
+ * terminator, and `offsets[i]` is the start of the i-th numeral.
+ * `offsets[count]` is set to the total number of bytes used.
+ * Values outside 1–3999 produce an empty string.
+ *
+ * Conversion stops at the first numeral that does not fit into @p out;
+ * ROMAN_BATCH_SIZE(count) bytes are always enough.
+ *
+ * @param values Input integers.
+ * @param count Number of elements in @p values.
+ * @param out Output buffer.
+ * @param size Size of @p out in bytes.
+ * @param offsets Output array of `count + 1` offsets into @p out.
+ *
+ * @return Number of values converted, equal to @p count on success.
+ */
+size_t to_roman_batch(const int *values, size_t count, char *out, size_t size, size_t *offsets) {
+    size_t used = 0;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        int value = values[i];
+        offsets[i] = used;
+
+        if (value < ROMAN_MIN || value > ROMAN_MAX) {
+            if (used >= size)
+                break;
+            out[used++] = '\0';
+        } else if (size - used >= ROMAN_BUF_SIZE) {
+            used += encode(value, out + used) + 1;
+        } else {
+            char tmp[ROMAN_BUF_SIZE];
+            size_t len = encode(value, tmp);
+
+            if (len >= size - used)
+                break;
+            memcpy(out + used, tmp, len + 1);
+            used += len + 1;
+        }
+    }
+
+    offsets[i] = used;
+    return i;
+}
 
-    /* Normalize to uppercase */
-    for (size_t i = 0; i < len; i++)
-        buf[i] = toupper((unsigned char)roman[i]);
-    buf[len] = '\0';
+/**
+ * @brief Convert an array of Roman numerals to integers.
+ *
+ * Invalid or NULL numerals are stored as -1.
+ *
+ * @param numerals Input numeral strings.
+ * @param count Number of elements in @p numerals.
+ * @param values Output array of @p count integers.
+ *
+ * @return Number of valid numerals.
+ */
+size_t from_roman_batch(const char *const *numerals, size_t count, int *values) {
+    size_t valid = 0;
 
-    /* Linear scan is fine for 100 entries */
-    for (int i = 1; i <= 100; i++) {
-        if (strcmp(buf, roman_table[i]) == 0)
-            return i;
+    for (size_t i = 0; i < count; i++) {
+        values[i] = numerals[i] ? decode(numerals[i]) : -1;
+        valid += values[i] > 0;
     }
 
-    return -1;
+    return valid;
 }
@@ -1,28 +1,78 @@
 /**
  * @file roman.h
- * @brief Roman numeral conversion utilities for values 1–100.
+ * @brief Roman numeral conversion utilities for values 1–3999.
  */
 
 #ifndef ROMAN_H
 #define ROMAN_H
 
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Smallest value representable as a Roman numeral. */
+#define ROMAN_MIN 1
+
+/** @brief Largest value representable as a Roman numeral. */
+#define ROMAN_MAX 3999
+
+/** @brief Buffer size sufficient for any numeral, including the terminator. */
+#define ROMAN_BUF_SIZE 16
+
+/** @brief Output size sufficient for @p count numerals in to_roman_batch(). */
+#define ROMAN_BATCH_SIZE(count) ((count) * ROMAN_BUF_SIZE)
+
 /**
- * @brief Convert integer (1–100) to a Roman numeral string.
+ * @brief Convert integer (1–3999) to a Roman numeral string.
  *
- * @param value Integer number (1–100).
- * @return Pointer to static string with Roman numeral representation,
- *         or NULL if value is out of range.
+ * @param value Integer number (1–3999).
+ * @param buf Caller-supplied output buffer, ROMAN_BUF_SIZE bytes are always enough.
+ * @param size Size of @p buf in bytes.
+ * @return @p buf with the Roman numeral representation,
+ *         or NULL if value is out of range or the buffer is too small.
  */
-const char *to_roman(int value);
+const char *to_roman(int value, char *buf, size_t size);
 
 /**
- * @brief Convert Roman numeral (I–C) to integer.
+ * @brief Convert Roman numeral (I–MMMCMXCIX) to integer.
  *
- * Handles uppercase or lowercase input.
+ * Handles uppercase or lowercase input. Only canonical numerals are accepted.
  *
  * @param roman Roman numeral string.
- * @return Integer representation (1–100), or -1 on invalid input.
+ * @return Integer representation (1–3999), or -1 on invalid input.
  */
 int from_roman(const char *roman);
 
+/**
+ * @brief Convert an array of integers to packed Roman numerals.
+ *
+ * Numerals are written back to back into @p out, each null-terminated;
+ * `out + offsets[i]` is the numeral of `values[i]` and `offsets[count]`
+ * is the number of bytes used. Out-of-range values give an empty string.
+ *
+ * @param values Input integers.
+ * @param count Number of values.
+ * @param out Output buffer, ROMAN_BATCH_SIZE(count) bytes are always enough.
+ * @param size Size of @p out in bytes.
+ * @param offsets Output array of `count + 1` offsets.
+ * @return Number of values converted; less than @p count if @p out is too small.
+ */
+size_t to_roman_batch(const int *values, size_t count, char *out, size_t size, size_t *offsets);
+
+/**
+ * @brief Convert an array of Roman numerals to integers.
+ *
+ * @param numerals Input numeral strings.
+ * @param count Number of numerals.
+ * @param values Output array; invalid numerals are stored as -1.
+ * @return Number of valid numerals.
+ */
+size_t from_roman_batch(const char *const *numerals, size_t count, int *values);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
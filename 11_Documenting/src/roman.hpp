@@ -0,0 +1,307 @@
+/**
+ * @file roman.hpp
+ * @brief Compile-time Roman numeral conversion for C++17 and later.
+ *
+ * The header mirrors the C functions of roman.h as `constexpr` functions,
+ * so conversions of constants are done by the compiler:
+ *
+ * @code
+ * using namespace roman::literals;
+ * static_assert(1994_roman == std::string_view("MCMXCIV"));
+ * static_assert("mcmxciv"_roman == 1994);
+ * @endcode
+ *
+ * The conversions run on tables derived at compile time from the digits of
+ * roman_tables.h: the digit lengths and the minimal automaton accepting the
+ * canonical numerals. tests/test_roman_constexpr.cpp checks that they equal
+ * the tables of roman_tables.h that roman.c runs on. roman::table holds all
+ * numerals, generated at compile time.
+ */
+
+#ifndef ROMAN_HPP
+#define ROMAN_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+#include "roman.h"
+#include "roman_tables.h"
+
+namespace roman {
+
+namespace detail {
+
+/** @brief Column of @p c in ::roman_next, case-insensitive; 0 means invalid. */
+constexpr int symbol_class(char c) {
+    switch (c) {
+        case 'I': case 'i': return 1;
+        case 'V': case 'v': return 2;
+        case 'X': case 'x': return 3;
+        case 'L': case 'l': return 4;
+        case 'C': case 'c': return 5;
+        case 'D': case 'd': return 6;
+        case 'M': case 'm': return 7;
+        default: return 0;
+    }
+}
+
+/** @brief Symbol of every column of ::roman_next but the invalid one. */
+inline constexpr char class_symbols[ROMAN_CLASSES + 1] = "?IVXLCDM";
+
+/** @brief What each ::roman_state is named after; the dead state reads nothing. */
+inline constexpr const char *state_readings[ROMAN_STATES] = {
+    "", "M", "MM", "MMM", "C", "CC", "CCC", "D", "DC",
+    "X", "XX", "XXX", "L", "LX", "I", "II", "III", "V", "VI", nullptr
+};
+
+/** @brief Length of a null-terminated string. */
+constexpr std::size_t length(const char *s) {
+    std::size_t len = 0;
+    while (s[len])
+        len++;
+    return len;
+}
+
+/** @brief Digit of @p place whose numeral is the @p len bytes of @p text, or -1. */
+constexpr int find_digit(int place, const char *text, std::size_t len) {
+    for (int digit = 0; digit < 10; digit++) {
+        const char *numeral = roman_place_digits[place][digit];
+        bool same = (digit == 0 || numeral[0]) && length(numeral) == len;
+
+        for (std::size_t i = 0; same && i < len; i++)
+            same = numeral[i] == text[i];
+        if (same)
+            return digit;
+    }
+    return -1;
+}
+
+/** @brief Dead state of raw_step(), after the place * 10 + digit ones. */
+inline constexpr int raw_dead = ROMAN_PLACES * 10;
+
+/** @brief A transition of raw_step(): the next state and the value it adds. */
+struct raw_transition {
+    int state;
+    int add;
+};
+
+/**
+ * @brief Transition of the automaton whose state is a place and its digit
+ * read so far, before it is minimized.
+ *
+ * The digits of a place are prefixes of one another, so what was read of
+ * it is a digit too. A symbol extends that digit if it can; otherwise it
+ * starts the first following place with a digit of that symbol alone.
+ * The start state is the thousands place with the digit 0.
+ */
+constexpr raw_transition raw_step(int state, int cls) {
+    if (state == raw_dead || cls == 0)
+        return { raw_dead, 0 };
+
+    const int place = state / 10, digit = state % 10;
+    const char symbol = class_symbols[cls];
+    const std::size_t len = length(roman_place_digits[place][digit]);
+    char text[5] = {};
+
+    for (std::size_t i = 0; i < len; i++)
+        text[i] = roman_place_digits[place][digit][i];
+    text[len] = symbol;
+
+    if (int next = find_digit(place, text, len + 1); next >= 0)
+        return { place * 10 + next, (next - digit) * roman_place_weights[place] };
+    for (int later = place + 1; later < ROMAN_PLACES; later++) {
+        if (int next = find_digit(later, &symbol, 1); next >= 0)
+            return { later * 10 + next, next * roman_place_weights[later] };
+    }
+    return { raw_dead, 0 };
+}
+
+/** @brief The tables of roman_tables.h that follow from ::roman_place_digits. */
+struct derived_tables {
+    unsigned char digit_len[ROMAN_PLACES][10] = {};      /**< As ::roman_place_digit_len */
+    unsigned char next[ROMAN_STATES][ROMAN_CLASSES] = {}; /**< As ::roman_next */
+    std::uint16_t add[ROMAN_STATES][ROMAN_CLASSES] = {};  /**< As ::roman_add */
+};
+
+/**
+ * @brief Derive the tables: minimize the automaton of raw_step(), then
+ * number its states as ::roman_state by ::state_readings.
+ *
+ * In a constant expression, readings that do not name the states of the
+ * minimal automaton one to one are a compile error.
+ */
+constexpr derived_tables derive_tables() {
+    derived_tables tables;
+    raw_transition raw[raw_dead + 1][ROMAN_CLASSES] = {};
+    int block[raw_dead + 1] = {};
+
+    for (int place = 0; place < ROMAN_PLACES; place++) {
+        for (int digit = 0; digit < 10; digit++)
+            tables.digit_len[place][digit] = static_cast<unsigned char>(length(roman_place_digits[place][digit]));
+    }
+    for (int state = 0; state <= raw_dead; state++) {
+        for (int cls = 0; cls < ROMAN_CLASSES; cls++)
+            raw[state][cls] = raw_step(state, cls);
+        block[state] = state != raw_dead;
+    }
+
+    /* split the blocks by where each symbol leads and what it adds, until none splits */
+    for (int count = 2, previous = 0; count != previous; ) {
+        int split[raw_dead + 1] = {};
+
+        previous = count;
+        count = 0;
+        for (int state = 0; state <= raw_dead; state++) {
+            split[state] = -1;
+            for (int other = 0; other < state && split[state] < 0; other++) {
+                bool same = block[other] == block[state];
+
+                for (int cls = 0; same && cls < ROMAN_CLASSES; cls++)
+                    same = raw[other][cls].add == raw[state][cls].add
+                        && block[raw[other][cls].state] == block[raw[state][cls].state];
+                if (same)
+                    split[state] = split[other];
+            }
+            if (split[state] < 0)
+                split[state] = count++;
+        }
+        for (int state = 0; state <= raw_dead; state++)
+            block[state] = split[state];
+    }
+
+    int raw_of[ROMAN_STATES] = {};
+
+    for (int state = 0; state < ROMAN_STATES; state++) {
+        const char *reading = state_readings[state];
+
+        raw_of[state] = reading ? 0 : raw_dead;
+        for (std::size_t i = 0; reading && reading[i]; i++)
+            raw_of[state] = raw[raw_of[state]][symbol_class(reading[i])].state;
+        for (int other = 0; other < state; other++) {
+            if (block[raw_of[other]] == block[raw_of[state]])
+                throw std::logic_error("two Roman automaton states are the same");
+        }
+    }
+    for (int state = 0; state < ROMAN_STATES; state++) {
+        for (int cls = 0; cls < ROMAN_CLASSES; cls++) {
+            const raw_transition step = raw[raw_of[state]][cls];
+            int next = 0;
+
+            while (next < ROMAN_STATES && block[raw_of[next]] != block[step.state])
+                next++;
+            if (next == ROMAN_STATES)
+                throw std::logic_error("a Roman automaton state is missing");
+            tables.next[state][cls] = static_cast<unsigned char>(next);
+            tables.add[state][cls] = static_cast<std::uint16_t>(step.add);
+        }
+    }
+    return tables;
+}
+
+/** @brief The tables the conversions of this header run on. */
+inline constexpr derived_tables derived = derive_tables();
+
+} // namespace detail
+
+/**
+ * @brief A Roman numeral stored by value.
+ *
+ * Usable both in constant expressions and at runtime, e.g. with printf().
+ */
+struct numeral {
+    char str[ROMAN_BUF_SIZE] = {}; /**< Null-terminated numeral */
+    std::size_t len = 0;           /**< Length without the terminator */
+
+    /** @brief Null-terminated numeral. */
+    constexpr const char *c_str() const { return str; }
+
+    /** @brief Numeral as a string view. */
+    constexpr std::string_view view() const { return { str, len }; }
+
+    /** @brief Compare with a string. */
+    constexpr bool operator==(std::string_view other) const { return view() == other; }
+};
+
+/**
+ * @brief Convert integer (1–3999) to a Roman numeral.
+ *
+ * In a constant expression an out-of-range value is a compile error.
+ *
+ * @throws std::out_of_range if @p value is outside ROMAN_MIN..ROMAN_MAX.
+ */
+constexpr numeral to_roman(int value) {
+    if (value < ROMAN_MIN || value > ROMAN_MAX)
+        throw std::out_of_range("value is outside of the Roman numeral range");
+
+    numeral result;
+
+    for (int place = 0; place < ROMAN_PLACES; place++) {
+        const int digit = value / roman_place_weights[place] % 10;
+
+        for (int i = 0; i < detail::derived.digit_len[place][digit]; i++)
+            result.str[result.len++] = roman_place_digits[place][digit][i];
+    }
+
+    return result;
+}
+
+/**
+ * @brief Convert a canonical Roman numeral (I–MMMCMXCIX) to integer.
+ *
+ * Handles uppercase or lowercase input. Runs the automaton of roman.c,
+ * as derived by detail::derive_tables().
+ *
+ * @return Integer representation (1–3999), or -1 on invalid input.
+ */
+constexpr int from_roman(std::string_view roman) {
+    int state = ROMAN_S_START;
+    int value = 0;
+
+    for (char c : roman) {
+        const int cls = detail::symbol_class(c);
+
+        value += detail::derived.add[state][cls];
+        state = detail::derived.next[state][cls];
+
+        if (state == ROMAN_S_DEAD)
+            return -1;
+    }
+
+    return value > 0 ? value : -1;
+}
+
+/** @brief All numerals, `table[0]` is empty. */
+inline constexpr std::array<numeral, ROMAN_MAX + 1> table = [] {
+    std::array<numeral, ROMAN_MAX + 1> result{};
+    for (int value = ROMAN_MIN; value <= ROMAN_MAX; value++)
+        result[value] = to_roman(value);
+    return result;
+}();
+
+/** @brief Numeral of a constant, e.g. `roman::value<42>.c_str()`. */
+template <int Value>
+inline constexpr numeral value = to_roman(Value);
+
+namespace literals {
+
+/** @brief `42_roman` is the numeral "XLII". */
+constexpr numeral operator""_roman(unsigned long long value) {
+    return to_roman(value > ROMAN_MAX ? 0 : static_cast<int>(value));
+}
+
+/** @brief `"XLII"_roman` is 42; invalid numerals fail to compile in constant expressions. */
+constexpr int operator""_roman(const char *roman, std::size_t len) {
+    int value = from_roman({ roman, len });
+    if (value < 0)
+        throw std::invalid_argument("invalid Roman numeral");
+    return value;
+}
+
+} // namespace literals
+
+} // namespace roman
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * @file roman_tables.h
+ * @brief Constant tables of the Roman numeral conversion, shared by C and C++.
+ *
+ * Included by roman.c and by roman.hpp, where the same tables are
+ * usable in constant expressions. Both directions work one decimal place
+ * at a time: every place uses the same ten digit patterns built from its
+ * "one", "five" and "ten" symbols (I V X, X L C, C D M; thousands only
+ * have M, which limits the range to 3999).
+ *
+ * The other tables follow from ::roman_place_digits. roman.hpp derives
+ * them at compile time, and tests/test_roman_constexpr.cpp fails to
+ * compile if those written out here for C differ.
+ */
+
+#ifndef ROMAN_TABLES_H
+#define ROMAN_TABLES_H
+
+#include <stdint.h>
+
+/** @brief Qualifiers of a table: static in C, usable in constant expressions in C++. */
+#ifdef __cplusplus
+#define ROMAN_TABLE inline constexpr
+#else
+#define ROMAN_TABLE static const
+#endif
+
+/** @brief Number of decimal places in ROMAN_MAX (thousands to ones). */
+#define ROMAN_PLACES 4
+
+/** @brief Decimal weight of every place, from thousands down to ones. */
+ROMAN_TABLE int roman_place_weights[ROMAN_PLACES] = { 1000, 100, 10, 1 };
+
+/**
+ * @brief Numeral of every digit in every place.
+ *
+ * Each is at most four symbols, padded with zeros to five bytes so that
+ * a fixed four-byte copy is always safe.
+ */
+ROMAN_TABLE char roman_place_digits[ROMAN_PLACES][10][5] = {
+    { "", "M", "MM", "MMM" },
+    { "", "C", "CC", "CCC", "CD", "D", "DC", "DCC", "DCCC", "CM" },
+    { "", "X", "XX", "XXX", "XL", "L", "LX", "LXX", "LXXX", "XC" },
+    { "", "I", "II", "III", "IV", "V", "VI", "VII", "VIII", "IX" }
+};
+
+/** @brief Length of every entry of ::roman_place_digits. */
+ROMAN_TABLE unsigned char roman_place_digit_len[ROMAN_PLACES][10] = {
+    { 0, 1, 2, 3 },
+    { 0, 1, 2, 3, 2, 1, 2, 3, 4, 2 },
+    { 0, 1, 2, 3, 2, 1, 2, 3, 4, 2 },
+    { 0, 1, 2, 3, 2, 1, 2, 3, 4, 2 }
+};
+
+/**
+ * @brief States of the automaton accepting exactly the canonical numerals.
+ *
+ * A state is named after what was read of the current place, and stands
+ * for every reading that allows the same continuations: ::ROMAN_S_CC is
+ * CC or DCC, where one more C may follow; ::ROMAN_S_CCC is a complete
+ * hundreds digit (CCC, DCCC, CD or CM). A symbol the place cannot take
+ * goes on with the first following place that can start with it.
+ */
+enum roman_state {
+    ROMAN_S_START,
+    ROMAN_S_M, ROMAN_S_MM, ROMAN_S_MMM,
+    ROMAN_S_C, ROMAN_S_CC, ROMAN_S_CCC, ROMAN_S_D, ROMAN_S_DC,
+    ROMAN_S_X, ROMAN_S_XX, ROMAN_S_XXX, ROMAN_S_L, ROMAN_S_LX,
+    ROMAN_S_I, ROMAN_S_II, ROMAN_S_III, ROMAN_S_V, ROMAN_S_VI,
+    ROMAN_S_DEAD,               /**< Rejects any further input */
+    ROMAN_STATES
+};
+
+/** @brief Number of symbol classes: invalid character plus I V X L C D M. */
+#define ROMAN_CLASSES 8
+
+/** @brief Next state by current state and symbol class (invalid, I, V, X, L, C, D, M). */
+ROMAN_TABLE unsigned char roman_next[ROMAN_STATES][ROMAN_CLASSES] = {
+    /* START */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_X, ROMAN_S_L, ROMAN_S_C, ROMAN_S_D, ROMAN_S_M },
+    /* M     */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_X, ROMAN_S_L, ROMAN_S_C, ROMAN_S_D, ROMAN_S_MM },
+    /* MM    */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_X, ROMAN_S_L, ROMAN_S_C, ROMAN_S_D, ROMAN_S_MMM },
+    /* MMM   */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_X, ROMAN_S_L, ROMAN_S_C, ROMAN_S_D, ROMAN_S_DEAD },
+    /* C     */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_X, ROMAN_S_L, ROMAN_S_CC, ROMAN_S_CCC, ROMAN_S_CCC },
+    /* CC    */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_X, ROMAN_S_L, ROMAN_S_CCC, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* CCC   */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_X, ROMAN_S_L, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* D     */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_X, ROMAN_S_L, ROMAN_S_DC, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* DC    */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_X, ROMAN_S_L, ROMAN_S_CC, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* X     */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_XX, ROMAN_S_XXX, ROMAN_S_XXX, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* XX    */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_XXX, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* XXX   */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* L     */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_LX, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* LX    */ { ROMAN_S_DEAD, ROMAN_S_I, ROMAN_S_V, ROMAN_S_XX, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* I     */ { ROMAN_S_DEAD, ROMAN_S_II, ROMAN_S_III, ROMAN_S_III, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* II    */ { ROMAN_S_DEAD, ROMAN_S_III, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* III   */ { ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* V     */ { ROMAN_S_DEAD, ROMAN_S_VI, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* VI    */ { ROMAN_S_DEAD, ROMAN_S_II, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD },
+    /* DEAD  */ { ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD, ROMAN_S_DEAD }
+};
+
+/**
+ * @brief Value added by each transition of ::roman_next.
+ *
+ * A symbol subtracting from the next one is counted as added: IX adds
+ * 1, then 8.
+ */
+ROMAN_TABLE uint16_t roman_add[ROMAN_STATES][ROMAN_CLASSES] = {
+    /* START */ {    0,    1,    5,   10,   50,  100,  500, 1000 },
+    /* M     */ {    0,    1,    5,   10,   50,  100,  500, 1000 },
+    /* MM    */ {    0,    1,    5,   10,   50,  100,  500, 1000 },
+    /* MMM   */ {    0,    1,    5,   10,   50,  100,  500,    0 },
+    /* C     */ {    0,    1,    5,   10,   50,  100,  300,  800 },
+    /* CC    */ {    0,    1,    5,   10,   50,  100,    0,    0 },
+    /* CCC   */ {    0,    1,    5,   10,   50,    0,    0,    0 },
+    /* D     */ {    0,    1,    5,   10,   50,  100,    0,    0 },
+    /* DC    */ {    0,    1,    5,   10,   50,  100,    0,    0 },
+    /* X     */ {    0,    1,    5,   10,   30,   80,    0,    0 },
+    /* XX    */ {    0,    1,    5,   10,    0,    0,    0,    0 },
+    /* XXX   */ {    0,    1,    5,    0,    0,    0,    0,    0 },
+    /* L     */ {    0,    1,    5,   10,    0,    0,    0,    0 },
+    /* LX    */ {    0,    1,    5,   10,    0,    0,    0,    0 },
+    /* I     */ {    0,    1,    3,    8,    0,    0,    0,    0 },
+    /* II    */ {    0,    1,    0,    0,    0,    0,    0,    0 },
+    /* III   */ {    0,    0,    0,    0,    0,    0,    0,    0 },
+    /* V     */ {    0,    1,    0,    0,    0,    0,    0,    0 },
+    /* VI    */ {    0,    1,    0,    0,    0,    0,    0,    0 },
+    /* DEAD  */ {    0,    0,    0,    0,    0,    0,    0,    0 }
+};
+
+#endif
@@ -0,0 +1,101 @@
+/**
+ * @file search.c
+ * @brief Bisection over an integer interval driven by a yes/no oracle.
+ *
+ * The interval is halved by asking "is the number greater than the
+ * middle?" until one number is left. Interval widths are computed in
+ * unsigned arithmetic so that the whole int64_t range works without
+ * overflow.
+ */
+
+#include "search.h"
+
+/**
+ * @brief Find a number in [@p low, @p high] by asking the oracle.
+ *
+ * @param low Lower bound, inclusive.
+ * @param high Upper bound, inclusive.
+ * @param oracle Question callback.
+ * @param data User data for @p oracle.
+ * @param result Filled with the number found and the questions asked.
+ *
+ * @return 0 on success, -1 if @p low > @p high or the oracle aborted.
+ */
+int search_interval(int64_t low, int64_t high, search_oracle oracle, void *data,
+                    struct search_result *result) {
+    if (low > high)
+        return -1;
+
+    result->questions = 0;
+
+    while (low < high) {
+        int64_t mid = low + (int64_t)(((uint64_t)high - (uint64_t)low) / 2);
+        int answer = oracle(mid, data);
+
+        if (answer < 0)
+            return -1;
+
+        result->questions++;
+
+        if (answer)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    result->value = low;
+    return 0;
+}
+
+/**
+ * @brief Oracle answering for a known number.
+ *
+ * @param guess Current guess.
+ * @param data Pointer to the hidden int64_t.
+ *
+ * @return 1 if the hidden number is greater than @p guess, 0 otherwise.
+ */
+static int target_oracle(int64_t guess, void *data) {
+    return *(const int64_t *)data > guess;
+}
+
+/**
+ * @brief Find a known number, answering the questions automatically.
+ *
+ * @param low Lower bound, inclusive.
+ * @param high Upper bound, inclusive.
+ * @param target Hidden number.
+ * @param result Filled as by ::search_interval.
+ *
+ * @return 0 on success, -1 if @p target is outside the interval.
+ */
+int search_target(int64_t low, int64_t high, int64_t target, struct search_result *result) {
+    if (target < low || target > high)
+        return -1;
+
+    return search_interval(low, high, target_oracle, &target, result);
+}
+
+/**
+ * @brief Maximum number of questions for the interval [@p low, @p high].
+ *
+ * @param low Lower bound, inclusive.
+ * @param high Upper bound, inclusive.
+ *
+ * @return ⌈log₂(high - low + 1)⌉, or 0 if @p low >= @p high.
+ */
+unsigned search_max_questions(int64_t low, int64_t high) {
+    if (low >= high)
+        return 0;
+
+    /* ⌈log₂(width + 1)⌉ is the bit length of width */
+    uint64_t width = (uint64_t)high - (uint64_t)low;
+    unsigned bits = 0;
+
+    while (width) {
+        bits++;
+        width >>= 1;
+    }
+
+    return bits;
+}
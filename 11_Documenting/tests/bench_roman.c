@@ -0,0 +1,237 @@
+/**
+ * @file bench_roman.c
+ * @brief Microbenchmark of the Roman numeral codec.
+ *
+ * Compares ::to_roman and ::from_roman with the previous implementation
+ * (a 101-entry table of numerals and a linear strcmp scan) on the 1–100
+ * range both support, and measures the full 1–3999 range on its own.
+ * The batch functions are compared with a loop of scalar calls over the
+ * same BATCH_COUNT values.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "roman.h"
+
+/** @brief Number of passes over the value range in every benchmark. */
+#define BENCH_ROUNDS 20000
+
+/** @brief Number of values converted by every batch benchmark pass. */
+#define BATCH_COUNT (1000 * 1000)
+
+/** @brief Number of passes in the batch benchmarks. */
+#define BATCH_ROUNDS 20
+
+/** @brief Previous lookup table, kept only as the benchmark reference. */
+static const char *legacy_table[101] = {
+    NULL,
+    "I", "II", "III", "IV", "V", "VI", "VII", "VIII", "IX", "X",
+    "XI", "XII", "XIII", "XIV", "XV", "XVI", "XVII", "XVIII", "XIX", "XX",
+    "XXI", "XXII", "XXIII", "XXIV", "XXV", "XXVI", "XXVII", "XXVIII", "XXIX", "XXX",
+    "XXXI", "XXXII", "XXXIII", "XXXIV", "XXXV", "XXXVI", "XXXVII", "XXXVIII", "XXXIX", "XL",
+    "XLI", "XLII", "XLIII", "XLIV", "XLV", "XLVI", "XLVII", "XLVIII", "XLIX", "L",
+    "LI", "LII", "LIII", "LIV", "LV", "LVI", "LVII", "LVIII", "LIX", "LX",
+    "LXI", "LXII", "LXIII", "LXIV", "LXV", "LXVI", "LXVII", "LXVIII", "LXIX", "LXX",
+    "LXXI", "LXXII", "LXXIII", "LXXIV", "LXXV", "LXXVI", "LXXVII", "LXXVIII", "LXXIX", "LXXX",
+    "LXXXI", "LXXXII", "LXXXIII", "LXXXIV", "LXXXV", "LXXXVI", "LXXXVII", "LXXXVIII", "LXXXIX", "XC",
+    "XCI", "XCII", "XCIII", "XCIV", "XCV", "XCVI", "XCVII", "XCVIII", "XCIX", "C"
+};
+
+/** @brief Previous to_roman(): table lookup copied into @p buf. */
+static const char *legacy_to_roman(int value, char *buf, size_t size) {
+    if (value < 1 || value > 100)
+        return NULL;
+    strncpy(buf, legacy_table[value], size);
+    return buf;
+}
+
+/** @brief Previous from_roman(): uppercase copy and linear scan. */
+static int legacy_from_roman(const char *roman) {
+    char buf[32];
+    size_t len = strlen(roman);
+    if (len >= sizeof(buf))
+        return -1;
+
+    for (size_t i = 0; i < len; i++)
+        buf[i] = toupper((unsigned char)roman[i]);
+    buf[len] = '\0';
+
+    for (int i = 1; i <= 100; i++) {
+        if (strcmp(buf, legacy_table[i]) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+/** @brief Prevents the compiler from dropping the benchmarked calls. */
+static volatile long sink;
+
+/** @brief Monotonic time in seconds. */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** @brief Time @p rounds passes of an encoder over 1..@p max. */
+static double bench_encode(const char *(*encode)(int, char *, size_t), int max, int rounds) {
+    char buf[ROMAN_BUF_SIZE];
+    long sum = 0;
+    double start = now();
+
+    for (int r = 0; r < rounds; r++)
+        for (int v = 1; v <= max; v++)
+            sum += encode(v, buf, sizeof(buf))[0];
+
+    sink = sum;
+    return now() - start;
+}
+
+/** @brief Time @p rounds passes of a decoder over @p count numerals. */
+static double bench_decode(int (*decode)(const char *), char (*numerals)[ROMAN_BUF_SIZE],
+                           int count, int rounds) {
+    long sum = 0;
+    double start = now();
+
+    for (int r = 0; r < rounds; r++)
+        for (int i = 0; i < count; i++)
+            sum += decode(numerals[i]);
+
+    sink = sum;
+    return now() - start;
+}
+
+/** @brief Time BATCH_ROUNDS scalar to_roman() passes packing into @p out. */
+static double bench_encode_scalar(const int *values, char *out, size_t *offsets) {
+    double start = now();
+
+    for (int r = 0; r < BATCH_ROUNDS; r++) {
+        size_t used = 0;
+
+        for (size_t i = 0; i < BATCH_COUNT; i++) {
+            offsets[i] = used;
+            used += strlen(to_roman(values[i], out + used, ROMAN_BUF_SIZE)) + 1;
+        }
+        offsets[BATCH_COUNT] = used;
+    }
+
+    return now() - start;
+}
+
+/** @brief Time BATCH_ROUNDS to_roman_batch() passes. */
+static double bench_encode_batch(const int *values, char *out, size_t *offsets) {
+    double start = now();
+
+    for (int r = 0; r < BATCH_ROUNDS; r++)
+        to_roman_batch(values, BATCH_COUNT, out, ROMAN_BATCH_SIZE(BATCH_COUNT), offsets);
+
+    return now() - start;
+}
+
+/** @brief Time BATCH_ROUNDS scalar from_roman() passes. */
+static double bench_decode_scalar(const char **numerals, int *values) {
+    double start = now();
+
+    for (int r = 0; r < BATCH_ROUNDS; r++)
+        for (size_t i = 0; i < BATCH_COUNT; i++)
+            values[i] = from_roman(numerals[i]);
+
+    return now() - start;
+}
+
+/** @brief Time BATCH_ROUNDS from_roman_batch() passes. */
+static double bench_decode_batch(const char **numerals, int *values) {
+    double start = now();
+
+    for (int r = 0; r < BATCH_ROUNDS; r++)
+        from_roman_batch(numerals, BATCH_COUNT, values);
+
+    return now() - start;
+}
+
+/** @brief Print one result line in nanoseconds per conversion. */
+static void report(const char *name, double seconds, long ops) {
+    printf("%-28s %10.2f ns/op\n", name, seconds * 1e9 / ops);
+}
+
+int main(void) {
+    static char numerals[ROMAN_MAX][ROMAN_BUF_SIZE];
+
+    for (int v = ROMAN_MIN; v <= ROMAN_MAX; v++) {
+        if (!to_roman(v, numerals[v - 1], ROMAN_BUF_SIZE) || from_roman(numerals[v - 1]) != v) {
+            fprintf(stderr, "Error: round trip failed for %d\n", v);
+            return 1;
+        }
+        if (v <= 100 && strcmp(numerals[v - 1], legacy_table[v]) != 0) {
+            fprintf(stderr, "Error: %d differs from the legacy table\n", v);
+            return 1;
+        }
+    }
+
+    long small = 100L * BENCH_ROUNDS;
+    long full = (long)ROMAN_MAX * (BENCH_ROUNDS / 40);
+
+    report("legacy to_roman 1-100", bench_encode(legacy_to_roman, 100, BENCH_ROUNDS), small);
+    report("to_roman 1-100", bench_encode(to_roman, 100, BENCH_ROUNDS), small);
+    report("legacy from_roman 1-100", bench_decode(legacy_from_roman, numerals, 100, BENCH_ROUNDS), small);
+    report("from_roman 1-100", bench_decode(from_roman, numerals, 100, BENCH_ROUNDS), small);
+    report("to_roman 1-3999", bench_encode(to_roman, ROMAN_MAX, BENCH_ROUNDS / 40), full);
+    report("from_roman 1-3999", bench_decode(from_roman, numerals, ROMAN_MAX, BENCH_ROUNDS / 40), full);
+
+    int *values = malloc(BATCH_COUNT * sizeof(*values));
+    int *parsed = malloc(BATCH_COUNT * sizeof(*parsed));
+    char *packed = malloc(ROMAN_BATCH_SIZE(BATCH_COUNT));
+    size_t *offsets = malloc((BATCH_COUNT + 1) * sizeof(*offsets));
+    const char **strings = malloc(BATCH_COUNT * sizeof(*strings));
+
+    if (!values || !parsed || !packed || !offsets || !strings) {
+        fprintf(stderr, "Error: failed to allocate batch buffers.\n");
+        return 1;
+    }
+
+    srand(1);
+    for (size_t i = 0; i < BATCH_COUNT; i++)
+        values[i] = ROMAN_MIN + rand() % ROMAN_MAX;
+
+    if (to_roman_batch(values, BATCH_COUNT, packed, ROMAN_BATCH_SIZE(BATCH_COUNT), offsets) != BATCH_COUNT) {
+        fprintf(stderr, "Error: to_roman_batch() did not convert all values\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < BATCH_COUNT; i++)
+        strings[i] = packed + offsets[i];
+
+    if (from_roman_batch(strings, BATCH_COUNT, parsed) != BATCH_COUNT
+            || memcmp(parsed, values, BATCH_COUNT * sizeof(*values)) != 0) {
+        fprintf(stderr, "Error: from_roman_batch() round trip failed\n");
+        return 1;
+    }
+
+    long batch = (long)BATCH_COUNT * BATCH_ROUNDS;
+    char *scalar_packed = malloc(ROMAN_BATCH_SIZE(BATCH_COUNT));
+    size_t *scalar_offsets = malloc((BATCH_COUNT + 1) * sizeof(*scalar_offsets));
+
+    if (!scalar_packed || !scalar_offsets) {
+        fprintf(stderr, "Error: failed to allocate batch buffers.\n");
+        return 1;
+    }
+
+    report("to_roman scalar loop", bench_encode_scalar(values, scalar_packed, scalar_offsets), batch);
+    report("to_roman_batch", bench_encode_batch(values, packed, offsets), batch);
+    report("from_roman scalar loop", bench_decode_scalar(strings, parsed), batch);
+    report("from_roman_batch", bench_decode_batch(strings, parsed), batch);
+
+    free(values);
+    free(parsed);
+    free(packed);
+    free(offsets);
+    free(strings);
+    free(scalar_packed);
+    free(scalar_offsets);
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file bench_search.c
+ * @brief Benchmark of the interval search on large batches of hidden numbers.
+ *
+ * For several interval widths solves BENCH_TARGETS random hidden numbers,
+ * checks every answer and that no search asks more than ⌈log₂ N⌉
+ * questions, and that the worst case actually reaches that bound.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "search.h"
+
+/** @brief Number of hidden numbers solved in every interval. */
+#define BENCH_TARGETS (1000 * 1000)
+
+/** @brief Tested interval. */
+struct interval {
+    const char *name; /**< Printed name */
+    int64_t low;      /**< Lower bound */
+    int64_t high;     /**< Upper bound */
+};
+
+/** @brief Monotonic time in seconds. */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** @brief xorshift64* generator, good enough to pick hidden numbers. */
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Solve BENCH_TARGETS random numbers of an interval.
+ *
+ * @return 0 if every search was correct and within the bound, 1 otherwise.
+ */
+static int bench_interval(const struct interval *in) {
+    uint64_t width = (uint64_t)in->high - (uint64_t)in->low;
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    unsigned limit = search_max_questions(in->low, in->high);
+    unsigned worst = 0;
+    unsigned long long questions = 0;
+    double start = now();
+
+    for (long i = 0; i < BENCH_TARGETS; i++) {
+        uint64_t offset = width == UINT64_MAX ? next_random(&state) : next_random(&state) % (width + 1);
+
+        /* always include both ends of the interval */
+        if (i == 0) offset = 0;
+        if (i == 1) offset = width;
+
+        int64_t target = (int64_t)((uint64_t)in->low + offset);
+        struct search_result result;
+
+        if (search_target(in->low, in->high, target, &result) != 0 || result.value != target) {
+            fprintf(stderr, "Error: %s: failed to find %lld\n", in->name, (long long)target);
+            return 1;
+        }
+
+        questions += result.questions;
+        if (result.questions > worst)
+            worst = result.questions;
+    }
+
+    double seconds = now() - start;
+
+    printf("%-10s limit %2u  worst %2u  mean %6.2f questions  %8.1f ns/solve\n",
+           in->name, limit, worst, (double)questions / BENCH_TARGETS,
+           seconds * 1e9 / BENCH_TARGETS);
+
+    if (worst != limit) {
+        fprintf(stderr, "Error: %s: worst case %u differs from the limit %u\n", in->name, worst, limit);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(void) {
+    static const struct interval intervals[] = {
+        { "1..100", 1, 100 },
+        { "1..3999", 1, 3999 },
+        { "2^20", 0, (1 << 20) - 1 },
+        { "2^20+1", 0, 1 << 20 },
+        { "2^40", -(INT64_C(1) << 39), (INT64_C(1) << 39) - 1 },
+        { "int64", INT64_MIN, INT64_MAX }
+    };
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++)
+        failed |= bench_interval(&intervals[i]);
+
+    return failed;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file test_roman_constexpr.cpp
+ * @brief Checks of the compile-time Roman numeral conversion.
+ *
+ * The static assertions cover the full 1–3999 range at compile time, and
+ * check that the tables written out in roman_tables.h for roman.c are
+ * those roman.hpp derives; main() then checks that roman.hpp and roman.c
+ * agree on every value.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "roman.hpp"
+
+using namespace roman::literals;
+
+/** @brief Round trip of every value and every table entry. */
+constexpr bool full_range_round_trips() {
+    for (int value = ROMAN_MIN; value <= ROMAN_MAX; value++) {
+        if (roman::from_roman(roman::to_roman(value).view()) != value)
+            return false;
+        if (!(roman::table[value] == roman::to_roman(value).view()))
+            return false;
+    }
+    return true;
+}
+
+/** @brief The longest numeral needs exactly ROMAN_BUF_SIZE bytes. */
+constexpr bool longest_numeral_fits() {
+    std::size_t longest = 0;
+    for (int value = ROMAN_MIN; value <= ROMAN_MAX; value++)
+        longest = roman::table[value].len > longest ? roman::table[value].len : longest;
+    return longest + 1 == ROMAN_BUF_SIZE;
+}
+
+/** @brief The tables of roman_tables.h equal the derived ones. */
+constexpr bool written_tables_are_derived() {
+    const auto &derived = roman::detail::derived;
+
+    for (int place = 0; place < ROMAN_PLACES; place++) {
+        for (int digit = 0; digit < 10; digit++) {
+            if (roman_place_digit_len[place][digit] != derived.digit_len[place][digit])
+                return false;
+        }
+    }
+    for (int state = 0; state < ROMAN_STATES; state++) {
+        for (int cls = 0; cls < ROMAN_CLASSES; cls++) {
+            if (roman_next[state][cls] != derived.next[state][cls] || roman_add[state][cls] != derived.add[state][cls])
+                return false;
+        }
+    }
+    return true;
+}
+
+static_assert(written_tables_are_derived());
+static_assert(full_range_round_trips());
+static_assert(longest_numeral_fits());
+
+static_assert(1_roman == "I");
+static_assert(4_roman == "IV");
+static_assert(9_roman == "IX");
+static_assert(14_roman == "XIV");
+static_assert(40_roman == "XL");
+static_assert(90_roman == "XC");
+static_assert(400_roman == "CD");
+static_assert(1994_roman == "MCMXCIV");
+static_assert(3888_roman == "MMMDCCCLXXXVIII");
+static_assert(3999_roman == "MMMCMXCIX");
+static_assert(roman::value<100> == "C");
+
+static_assert("XLII"_roman == 42);
+static_assert("mcmxciv"_roman == 1994);
+static_assert("MMMCMXCIX"_roman == 3999);
+
+static_assert(roman::from_roman("") == -1);
+static_assert(roman::from_roman("IIII") == -1);
+static_assert(roman::from_roman("VX") == -1);
+static_assert(roman::from_roman("IC") == -1);
+static_assert(roman::from_roman("MMMM") == -1);
+static_assert(roman::from_roman("XCX") == -1);
+static_assert(roman::from_roman("ABC") == -1);
+
+int main() {
+    char buf[ROMAN_BUF_SIZE];
+    int failed = 0;
+
+    for (int value = ROMAN_MIN; value <= ROMAN_MAX; value++) {
+        const char *c_numeral = to_roman(value, buf, sizeof(buf));
+
+        if (!c_numeral || std::strcmp(c_numeral, roman::table[value].c_str()) != 0
+                || from_roman(roman::table[value].c_str()) != value) {
+            std::fprintf(stderr, "Mismatch between roman.c and roman.hpp for %d\n", value);
+            failed++;
+        }
+    }
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,404 @@
+/**
+ * @file slot_config.c
+ * @brief Reel strips and symbol pictures of the slot machine.
+ *
+ * A machine is described by a text file with one symbol per line:
+ *
+ * @code
+ * # weight on reel 1, 2 and 3, then the three picture lines
+ * 4 4 4 ┌───┐|│ 1 │|└───┘
+ * 1 1 2 ┌───┐|│ 7 │|└───┘
+ * @endcode
+ *
+ * Every reel gets an alias table built from its weights, so a symbol is
+ * drawn in constant time whatever the number of symbols.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "slot_lib.h"
+
+/** @brief Built-in machine, used until another one is loaded. */
+static const char classic_config[] =
+    "1 1 1 ┌───┐|│ 1 │|└───┘\n"
+    "1 1 1 ┌───┐|│ 2 │|└───┘\n"
+    "1 1 1 ┌───┐|│ 3 │|└───┘\n"
+    "1 1 1 ┌───┐|│ 4 │|└───┘\n"
+    "1 1 1 ┌───┐|│ 5 │|└───┘\n"
+    "1 1 1 ┌───┐|│ 6 │|└───┘\n";
+
+/** @brief Machine used by the game, see slot_config(). */
+static struct slot_config current;
+
+/** @brief Whether ::current has been filled. */
+static int current_loaded = 0;
+
+/** @brief Generator of slot_spin(). */
+static struct slot_rng game_rng;
+
+/** @brief Whether ::game_rng has been seeded. */
+static int game_rng_seeded = 0;
+
+/**
+ * @brief Free the memory of a machine.
+ *
+ * @param config Machine to clear.
+ */
+static void config_free(struct slot_config *config) {
+    free(config->symbols);
+    free(config->weights[0]);
+    free(config->text);
+
+    for (int r = 0; r < SLOT_REELS; r++) {
+        free(config->reels[r].threshold);
+        free(config->reels[r].alias);
+    }
+
+    memset(config, 0, sizeof(*config));
+}
+
+/**
+ * @brief Build the alias table of one reel (Vose's method).
+ *
+ * Column i keeps symbol i with probability `threshold[i] / 2^32` and
+ * gives it to `alias[i]` otherwise; each column is picked uniformly.
+ *
+ * @param reel Table to fill.
+ * @param weights Weight of every symbol.
+ * @param count Number of symbols.
+ * @return 0 on success, -1 if out of memory.
+ */
+static int build_alias(struct slot_alias *reel, const double *weights, unsigned count) {
+    double *scaled = malloc(count * sizeof(*scaled));
+    unsigned *small = malloc(2 * count * sizeof(*small));
+    double total = 0;
+
+    reel->threshold = malloc(count * sizeof(*reel->threshold));
+    reel->alias = malloc(count * sizeof(*reel->alias));
+    reel->count = count;
+
+    if (!scaled || !small || !reel->threshold || !reel->alias) {
+        free(scaled);
+        free(small);
+        return -1;
+    }
+
+    unsigned *large = small + count;
+    unsigned n_small = 0, n_large = 0;
+
+    for (unsigned i = 0; i < count; i++)
+        total += weights[i];
+
+    for (unsigned i = 0; i < count; i++) {
+        scaled[i] = weights[i] * count / total;
+        if (scaled[i] < 1)
+            small[n_small++] = i;
+        else
+            large[n_large++] = i;
+    }
+
+    while (n_small > 0 && n_large > 0) {
+        unsigned s = small[--n_small];
+        unsigned l = large[n_large - 1];
+
+        reel->threshold[s] = (uint64_t)(scaled[s] * 4294967296.0);
+        reel->alias[s] = l;
+
+        scaled[l] -= 1 - scaled[s];
+        if (scaled[l] < 1) {
+            n_large--;
+            small[n_small++] = l;
+        }
+    }
+
+    /* what is left is 1 up to rounding errors */
+    while (n_large > 0) {
+        unsigned i = large[--n_large];
+        reel->threshold[i] = 1ULL << 32;
+        reel->alias[i] = i;
+    }
+    while (n_small > 0) {
+        unsigned i = small[--n_small];
+        reel->threshold[i] = 1ULL << 32;
+        reel->alias[i] = i;
+    }
+
+    free(scaled);
+    free(small);
+    return 0;
+}
+
+/**
+ * @brief Parse one symbol line: the weights, then the picture lines.
+ *
+ * @param line Line without the newline, split in place.
+ * @param weights Output weight of the symbol on every reel.
+ * @param picture Output picture lines, pointing into @p line.
+ * @return 0 on success, -1 if the line is malformed.
+ */
+static int parse_symbol(char *line, double weights[SLOT_REELS], const char *picture[3]) {
+    char *p = line;
+
+    for (int r = 0; r < SLOT_REELS; r++) {
+        char *end;
+
+        errno = 0;
+        weights[r] = strtod(p, &end);
+        if (end == p || errno != 0 || !isfinite(weights[r]) || weights[r] < 0 || (*end != ' ' && *end != '\t'))
+            return -1;
+        p = end;
+    }
+
+    p += strspn(p, " \t");
+
+    for (int i = 0; i < 3; i++) {
+        char *bar = strchr(p, '|');
+
+        if ((i < 2) != (bar != NULL) || strlen(p) - (bar ? strlen(bar) : 0) >= SLOT_SYMBOL_SIZE)
+            return -1;
+        picture[i] = p;
+        if (bar) {
+            *bar = '\0';
+            p = bar + 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Build a machine from the text of a configuration file.
+ *
+ * @param config Output machine, cleared on failure.
+ * @param text Configuration text.
+ * @param error_line Set to the line number of a syntax error, or 0.
+ * @return 0 on success, -1 on error.
+ */
+static int config_parse(struct slot_config *config, const char *text, unsigned *error_line) {
+    size_t size = strlen(text) + 1;
+    unsigned lines = 0, symbols = 0;
+
+    memset(config, 0, sizeof(*config));
+    *error_line = 0;
+
+    for (const char *c = text; *c; c++)
+        lines += *c == '\n';
+    lines++;
+
+    config->text = malloc(size);
+    config->symbols = malloc(lines * sizeof(*config->symbols));
+    config->weights[0] = malloc(SLOT_REELS * lines * sizeof(double));
+
+    if (!config->text || !config->symbols || !config->weights[0]) {
+        config_free(config);
+        return -1;
+    }
+
+    memcpy(config->text, text, size);
+
+    char *line = config->text;
+    unsigned number = 0;
+
+    while (line) {
+        char *next = strchr(line, '\n');
+        double weights[SLOT_REELS];
+
+        number++;
+        if (next)
+            *next++ = '\0';
+        line[strcspn(line, "\r")] = '\0';
+
+        char *start = line + strspn(line, " \t");
+
+        if (*start != '\0' && *start != '#') {
+            if (symbols == SLOT_MAX_SYMBOLS || parse_symbol(start, weights, config->symbols[symbols]) != 0) {
+                *error_line = number;
+                break;
+            }
+
+            int width = slot_utf8_width(config->symbols[symbols][0]);
+
+            for (int i = 1; i < 3; i++) {
+                if (slot_utf8_width(config->symbols[symbols][i]) != width)
+                    width = -1;
+            }
+
+            if (width <= 0 || (symbols > 0 && width != config->symbol_width)) {
+                *error_line = number;
+                break;
+            }
+
+            config->symbol_width = width;
+            for (int r = 0; r < SLOT_REELS; r++)
+                config->weights[0][r * lines + symbols] = weights[r];
+            symbols++;
+        }
+
+        line = next;
+    }
+
+    config->num_symbols = symbols;
+    for (int r = 1; r < SLOT_REELS; r++)
+        config->weights[r] = config->weights[0] + r * lines;
+
+    for (int r = 0; r < SLOT_REELS && *error_line == 0; r++) {
+        double total = 0;
+
+        for (unsigned i = 0; i < symbols; i++)
+            total += config->weights[r][i];
+
+        if (total <= 0)
+            *error_line = number;
+    }
+
+    if (*error_line == 0 && symbols == 0)
+        *error_line = number;
+
+    if (*error_line != 0) {
+        config_free(config);
+        return -1;
+    }
+
+    config->inner_width = SLOT_REELS * config->symbol_width + SLOT_REELS - 1;
+
+    for (int r = 0; r < SLOT_REELS; r++) {
+        if (build_alias(&config->reels[r], config->weights[r], symbols) != 0) {
+            config_free(config);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Replace the current machine after a successful parse.
+ *
+ * @param text Configuration text.
+ * @param error_line Set to the line number of a syntax error, or 0.
+ * @return 0 on success, -1 on error.
+ */
+static int config_replace(const char *text, unsigned *error_line) {
+    struct slot_config config;
+    unsigned line;
+
+    if (config_parse(&config, text, &line) != 0) {
+        if (error_line)
+            *error_line = line;
+        return -1;
+    }
+
+    config_free(&current);
+    current = config;
+    current_loaded = 1;
+
+    if (error_line)
+        *error_line = 0;
+    return 0;
+}
+
+/**
+ * @brief Use a machine described by configuration text.
+ *
+ * @param text Configuration text.
+ * @param error_line Set to the line number of a syntax error, or 0.
+ * @return 0 on success, -1 on error.
+ */
+int slot_config_parse(const char *text, unsigned *error_line) {
+    return config_replace(text, error_line);
+}
+
+/**
+ * @brief Use a machine described by a configuration file.
+ *
+ * @param path File name.
+ * @param error_line Set to the line number of a syntax error, or 0.
+ * @return 0 on success, -1 on error (errno is set for I/O errors).
+ */
+int slot_config_load(const char *path, unsigned *error_line) {
+    FILE *file = fopen(path, "r");
+    char *text = NULL;
+    size_t len = 0, capacity = 0;
+
+    if (error_line)
+        *error_line = 0;
+    if (!file)
+        return -1;
+
+    while (!feof(file)) {
+        if (capacity - len < 4096) {
+            char *grown = realloc(text, capacity + 65536);
+
+            if (!grown) {
+                free(text);
+                fclose(file);
+                return -1;
+            }
+            text = grown;
+            capacity += 65536;
+        }
+
+        len += fread(text + len, 1, capacity - len - 1, file);
+        if (ferror(file)) {
+            free(text);
+            fclose(file);
+            return -1;
+        }
+    }
+
+    fclose(file);
+    text[len] = '\0';
+
+    int result = config_replace(text, error_line);
+
+    free(text);
+    return result;
+}
+
+/**
+ * @brief Go back to the built-in machine.
+ */
+void slot_config_default(void) {
+    unsigned line;
+
+    config_replace(classic_config, &line);
+}
+
+/**
+ * @brief Get the current machine, the built-in one if none was loaded.
+ *
+ * @return Pointer to the machine.
+ */
+const struct slot_config *slot_config(void) {
+    if (!current_loaded)
+        slot_config_default();
+    return &current;
+}
+
+/**
+ * @brief Seed the generator of slot_spin().
+ *
+ * @param seed Any value.
+ */
+void slot_seed(uint64_t seed) {
+    slot_rng_seed(&game_rng, seed);
+    game_rng_seeded = 1;
+}
+
+/**
+ * @brief Draw the symbol of a reel of the current machine.
+ *
+ * @param reel Reel number, 0 to SLOT_REELS - 1.
+ * @return Symbol index.
+ */
+int slot_spin(unsigned reel) {
+    if (!game_rng_seeded)
+        slot_seed((uint64_t)time(NULL) ^ (uint64_t)getpid() << 32);
+
+    return slot_alias_sample(&slot_config()->reels[reel % SLOT_REELS], &game_rng);
+}
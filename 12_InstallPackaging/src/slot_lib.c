@@ -7,48 +7,243 @@
  */
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <time.h>
 #include <locale.h>
 #include <libintl.h>
-#include <wchar.h>
 #include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
 #include "slot_lib.h"
 #include "config.h"
 
 
-#define _(STRING) gettext(STRING)
+#define _(STRING) counted_gettext(STRING)
+
+/** @brief Number of message catalog lookups, see slot_gettext_calls(). */
+static unsigned long gettext_calls = 0;
+
+/** @brief Cached translations, see slot_messages(). */
+static struct slot_messages messages;
+
+/** @brief Whether ::messages has been filled. */
+static int messages_loaded = 0;
+
+/**
+ * @brief gettext() wrapper that counts the lookups.
+ *
+ * @param msgid Untranslated string.
+ * @return Translated string.
+ */
+static const char *counted_gettext(const char *msgid) {
+    gettext_calls++;
+    return gettext(msgid);
+}
+
+/** @brief Inclusive range of code points. */
+struct code_range {
+    uint32_t first; /**< First code point */
+    uint32_t last;  /**< Last code point */
+};
+
+/** @brief Combining and zero-width code points, sorted. */
+static const struct code_range zero_width[] = {
+    { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF },
+    { 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A },
+    { 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 },
+    { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E }, { 0x1AB0, 0x1AFF },
+    { 0x1DC0, 0x1DFF }, { 0x200B, 0x200F }, { 0x202A, 0x202E }, { 0x2060, 0x2064 },
+    { 0x20D0, 0x20FF }, { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF }
+};
+
+/** @brief First code point covered by ::two_byte_zero_width. */
+#define TWO_BYTE_ZERO_BASE 0x0300
+
+/**
+ * @brief The two-byte ranges of ::zero_width as a bitmap.
+ *
+ * Bit n is set if U+0300 + n is a combining mark, up to U+06FF. The unit
+ * tests check it at the boundaries of every range.
+ */
+static const uint64_t two_byte_zero_width[16] = {
+    0xFFFFFFFFFFFFFFFFULL, 0x0000FFFFFFFFFFFFULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x00000000000003F8ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0xBFFFFFFFFFFE0000ULL, 0x00000000000000B6ULL,
+    0x0000000007FF0000ULL, 0x00010000FFFFF800ULL, 0x0000000000000000ULL, 0x0000001F9FC00000ULL
+};
+
+/** @brief East Asian wide and fullwidth code points, sorted. */
+static const struct code_range double_width[] = {
+    { 0x1100, 0x115F }, { 0x2E80, 0x303E }, { 0x3041, 0x33FF }, { 0x3400, 0x4DBF },
+    { 0x4E00, 0x9FFF }, { 0xA000, 0xA4CF }, { 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF },
+    { 0xFE30, 0xFE4F }, { 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x1F300, 0x1F64F },
+    { 0x1F900, 0x1F9FF }, { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD }
+};
+
+/**
+ * @brief Check whether a code point is inside a sorted range table.
+ *
+ * @param cp Code point.
+ * @param table Ranges.
+ * @param count Number of ranges.
+ * @return 1 if found, 0 otherwise.
+ */
+static int in_ranges(uint32_t cp, const struct code_range *table, size_t count) {
+    size_t low = 0, high = count;
+
+    if (cp < table[0].first || cp > table[count - 1].last)
+        return 0;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+
+        if (cp > table[mid].last)
+            low = mid + 1;
+        else if (cp < table[mid].first)
+            high = mid;
+        else
+            return 1;
+    }
+
+    return 0;
+}
 
 /**
- * @brief Calculate the display width of a UTF-8 string.
+ * @brief Display width of a UTF-8 string.
  *
- * Converts the input string to wide characters and computes
- * its display width. Falls back to strlen() if conversion fails.
+ * ASCII is counted a byte at a time, and two-byte sequences (Latin,
+ * Greek, Cyrillic...) need only a bitmap lookup for combining marks.
+ * Longer sequences are decoded in place and looked up in small tables of
+ * wide (2 columns) and combining (0 columns) code points, so no locale
+ * or wide-character conversion is involved. Invalid bytes count as one
+ * column each.
  *
  * @param s Input UTF-8 string.
- * @return Display width of the string in characters.
+ * @return Display width in terminal columns.
  */
-static int utf8_width(const char *s) {
-    wchar_t wcs[128];
-    int len = mbstowcs(wcs, s, 128);
-    if (len < 0)
-        return strlen(s);   // fallback
-    return wcswidth(wcs, len);
+int slot_utf8_width(const char *s) {
+    const unsigned char *p = (const unsigned char *)s;
+    int width = 0;
+
+    while (*p) {
+        unsigned c = *p;
+
+        if (c < 0x80) {
+            width += c >= 0x20 && c != 0x7F;
+            p++;
+        } else if (c >= 0xC2 && c < 0xE0 && (p[1] & 0xC0) == 0x80) {
+            uint32_t n = ((c & 0x1F) << 6 | (p[1] & 0x3F)) - TWO_BYTE_ZERO_BASE;
+
+            width += n >= 64 * 16 || !(two_byte_zero_width[n / 64] >> (n % 64) & 1);
+            p += 2;
+        } else if (c >= 0xE0 && c < 0xF5 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80
+                   && (c < 0xF0 || (p[3] & 0xC0) == 0x80)) {
+            uint32_t cp;
+
+            if (c < 0xF0) {
+                cp = (c & 0x0F) << 12 | (p[1] & 0x3F) << 6 | (p[2] & 0x3F);
+                p += 3;
+            } else {
+                cp = (c & 0x07) << 18 | (p[1] & 0x3F) << 12 | (p[2] & 0x3F) << 6 | (p[3] & 0x3F);
+                p += 4;
+            }
+
+            if (in_ranges(cp, double_width, sizeof(double_width) / sizeof(double_width[0])))
+                width += 2;
+            else
+                width += !in_ranges(cp, zero_width, sizeof(zero_width) / sizeof(zero_width[0]));
+        } else {
+            width++;
+            p++;
+        }
+    }
+
+    return width;
+}
+
+/**
+ * @brief Resolve all translated strings of the game.
+ */
+void slot_messages_load(void) {
+    messages.title = _("SLOT MACHINE");
+    messages.credits = _("Credits:");
+    messages.current_bet = _("Current bet:");
+    messages.spin = _("Spin!");
+    messages.enter_bet = _("\nEnter your bet (or 'q' to quit): ");
+    messages.invalid_input = _("Invalid input. Please enter a number or 'q'.\n");
+    messages.invalid_bet = _("Invalid bet. Must be between 1 and %d.\n");
+    messages.out_of_credits = _("\nYou are out of credits. Game over.\n");
+    messages.thanks = _("\nThanks for playing.\n");
+    messages.jackpot = _("\nJACKPOT! You win %d credits.\n");
+    messages.two_matched = _("\nTwo matched! You win %d credits.\n");
+    messages.no_match = _("\nNo match. You lose %d credits.\n");
+    messages.press_enter = _("\nPress Enter to continue...");
+    messages.credits_width = slot_utf8_width(messages.credits);
+    messages.current_bet_width = slot_utf8_width(messages.current_bet);
+    messages_loaded = 1;
 }
 
 /**
- * @brief Predefined symbols for the slot machine reels.
+ * @brief Get the translated strings of the game, loading them on first use.
  *
- * Each symbol is a 3x5 text block representing an item or number.
+ * @return Pointer to the cached strings.
  */
-const char *symbols[NUM_ITEMS][3] = {
-    { "┌───┐", "│ 1 │", "└───┘" },
-    { "┌───┐", "│ 2 │", "└───┘" },
-    { "┌───┐", "│ 3 │", "└───┘" },
-    { "┌───┐", "│ 4 │", "└───┘" },
-    { "┌───┐", "│ 5 │", "└───┘" },
-    { "┌───┐", "│ 6 │", "└───┘" }
-};
+const struct slot_messages *slot_messages(void) {
+    if (!messages_loaded)
+        slot_messages_load();
+    return &messages;
+}
+
+/**
+ * @brief Number of message catalog lookups made by the library.
+ *
+ * @return Total number of gettext() calls so far.
+ */
+unsigned long slot_gettext_calls(void) {
+    return gettext_calls;
+}
+
+/**
+ * @brief Format a boxed "label value" line padded to the machine width.
+ *
+ * The label width comes from the message cache and the number is ASCII,
+ * so no width has to be measured per frame.
+ *
+ * @param out Output buffer.
+ * @param size Size of @p out.
+ * @param label Translated label.
+ * @param label_width Display width of @p label.
+ * @param value Number printed after the label.
+ */
+static void format_value_line(char *out, size_t size, const char *label, int label_width, int value) {
+    char number[16];
+    int pad;
+
+    pad = slot_config()->inner_width - label_width - 1 - snprintf(number, sizeof(number), "%d", value);
+    if (pad < 0) pad = 0;
+
+    snprintf(out, size, "│ %s %s%*s │", label, number, pad, "");
+}
+
+/**
+ * @brief Format a horizontal border of the machine frame.
+ *
+ * @param out Output buffer.
+ * @param size Size of @p out.
+ * @param left Left corner.
+ * @param right Right corner.
+ */
+static void format_border(char *out, size_t size, const char *left, const char *right) {
+    int width = slot_config()->inner_width + 2;
+    size_t len = snprintf(out, size, "%s", left);
+
+    for (int i = 0; i < width && len + 1 < size; i++)
+        out[len++] = '=';
+
+    snprintf(out + len, size - len, "%s", right);
+}
 
 /**
  * @brief Print the slot machine header including credits.
@@ -56,18 +251,17 @@ const char *symbols[NUM_ITEMS][3] = {
  * @param credits Current player credits.
  */
 void print_header(int credits) {
-    char line[64];
-    int pad;
+    const struct slot_messages *msg = slot_messages();
+    char line[SLOT_ROW_SIZE];
 
-    snprintf(line, sizeof(line),
-             "%s %d", _("Credits:"), credits);
+    char border[SLOT_ROW_SIZE];
 
-    pad = INNER_WIDTH - utf8_width(line);
-    if (pad < 0) pad = 0;
+    format_value_line(line, sizeof(line), msg->credits, msg->credits_width, credits);
+    format_border(border, sizeof(border), "┌", "┐");
 
-    printf("      %s\n", _("SLOT MACHINE"));
-    printf("┌===================┐\n");
-    printf("│ %s%*s │\n", line, pad, "");
+    printf("      %s\n", msg->title);
+    printf("%s\n", border);
+    printf("%s\n", line);
 }
 
 /**
@@ -89,33 +283,558 @@ void print_reels(const char *r1[3], const char *r2[3], const char *r3[3]) {
  * @param bet Current bet amount.
  */
 void print_footer(int bet) {
-    char line[64];
-    int pad;
+    const struct slot_messages *msg = slot_messages();
+    char line[SLOT_ROW_SIZE];
 
-    printf("│===================│\n");
+    format_border(line, sizeof(line), "│", "│");
+    printf("%s\n", line);
 
     if (bet > 0) {
-        snprintf(line, sizeof(line),
-                 "%s %d", _("Current bet:"), bet);
+        format_value_line(line, sizeof(line), msg->current_bet, msg->current_bet_width, bet);
+        printf("%s\n", line);
+    }
+
+    format_border(line, sizeof(line), "└", "┘");
+    printf("%s\n", line);
+    printf("      [ %s ]\n", msg->spin);
+}
+
+/** @brief Screen row of the first reel line in a frame. */
+#define REEL_ROW 3
+
+/** @brief Display columns before the first reel cell ("│ "). */
+#define REEL_COLUMN 2
+
+
+/**
+ * @brief Build the rows of a frame, as print_header/reels/footer would print them.
+ *
+ * @param rows Output rows.
+ * @param credits Current player credits.
+ * @param bet Current bet, no bet line if 0.
+ * @param reels Symbol index of every reel.
+ *
+ * @return Number of rows.
+ */
+static int build_rows(char rows[SLOT_SCREEN_ROWS][SLOT_ROW_SIZE], int credits, int bet, const int reels[3]) {
+    const struct slot_messages *msg = slot_messages();
+    const char *(*symbols)[3] = slot_config()->symbols;
+    int n = 0;
+
+    snprintf(rows[n++], SLOT_ROW_SIZE, "      %s", msg->title);
+    format_border(rows[n++], SLOT_ROW_SIZE, "┌", "┐");
+    format_value_line(rows[n++], SLOT_ROW_SIZE, msg->credits, msg->credits_width, credits);
+
+    for (int i = 0; i < 3; i++)
+        snprintf(rows[n++], SLOT_ROW_SIZE, "│ %s %s %s │",
+                 symbols[reels[0]][i], symbols[reels[1]][i], symbols[reels[2]][i]);
+
+    format_border(rows[n++], SLOT_ROW_SIZE, "│", "│");
+    if (bet > 0)
+        format_value_line(rows[n++], SLOT_ROW_SIZE, msg->current_bet, msg->current_bet_width, bet);
+    format_border(rows[n++], SLOT_ROW_SIZE, "└", "┘");
+    snprintf(rows[n++], SLOT_ROW_SIZE, "      [ %s ]", msg->spin);
+
+    return n;
+}
+
+/**
+ * @brief Append formatted text to a frame buffer.
+ *
+ * Output that does not fit is dropped and marks the frame as truncated
+ * by setting @p len past @p size.
+ */
+static void frame_append(char *out, size_t size, size_t *len, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static void frame_append(char *out, size_t size, size_t *len, const char *fmt, ...) {
+    va_list args;
+    size_t room = *len < size ? size - *len : 0;
+
+    va_start(args, fmt);
+    int n = vsnprintf(room ? out + *len : NULL, room, fmt, args);
+    va_end(args);
+
+    if (n > 0)
+        *len += n;
+}
+
+/**
+ * @brief Reset the renderer so the next frame clears the screen.
+ *
+ * @param screen Renderer state.
+ */
+void slot_screen_init(struct slot_screen *screen) {
+    memset(screen, 0, sizeof(*screen));
+}
+
+/**
+ * @brief Compose the escape sequences that turn the last frame into a new one.
+ *
+ * The first frame after slot_screen_init() clears the screen. Later frames
+ * rewrite only the rows whose text changed and, in the reel rows, only
+ * the reel cells whose text changed. The cursor is hidden while drawing
+ * and left on the row below the machine, where everything is erased.
+ *
+ * @param screen Renderer state, updated to the new frame.
+ * @param credits Current player credits.
+ * @param bet Current bet, no bet line if 0.
+ * @param reels Symbol index of every reel.
+ * @param out Output buffer, SLOT_FRAME_SIZE bytes are always enough.
+ * @param size Size of @p out.
+ *
+ * @return Number of bytes composed, or 0 if @p out is too small.
+ */
+size_t slot_screen_compose(struct slot_screen *screen, int credits, int bet, const int reels[3],
+                           char *out, size_t size) {
+    char rows[SLOT_SCREEN_ROWS][SLOT_ROW_SIZE];
+    int count = build_rows(rows, credits, bet, reels);
+    const struct slot_config *config = slot_config();
+    size_t len = 0;
+
+    frame_append(out, size, &len, "\033[?25l");
+
+    if (!screen->drawn)
+        frame_append(out, size, &len, "\033[H\033[2J");
+
+    for (int row = 0; row < count; row++) {
+        int is_reel_row = row >= REEL_ROW && row < REEL_ROW + 3;
+
+        if (screen->drawn && is_reel_row) {
+            for (int r = 0; r < 3; r++) {
+                const char *cell = config->symbols[reels[r]][row - REEL_ROW];
+
+                if (strcmp(cell, config->symbols[screen->reels[r]][row - REEL_ROW]) != 0)
+                    frame_append(out, size, &len, "\033[%d;%dH%s", row + 1,
+                                 REEL_COLUMN + r * (config->symbol_width + 1) + 1, cell);
+            }
+        } else if (!screen->drawn || row >= screen->count || strcmp(rows[row], screen->rows[row]) != 0) {
+            frame_append(out, size, &len, "\033[%d;1H%s\033[K", row + 1, rows[row]);
+        }
+    }
+
+    /* park the cursor below the machine and erase stale text there */
+    frame_append(out, size, &len, "\033[%d;1H\033[J\033[?25h", count + 1);
+
+    if (len >= size)
+        return 0;
+
+    memcpy(screen->rows, rows, sizeof(rows));
+    memcpy(screen->reels, reels, sizeof(screen->reels));
+    screen->count = count;
+    screen->drawn = 1;
+
+    return len;
+}
+
+/**
+ * @brief Draw a frame with a single write() call.
+ *
+ * Flushes stdout first so that text printed before stays above the frame.
+ *
+ * @param screen Renderer state.
+ * @param fd Terminal file descriptor.
+ * @param credits Current player credits.
+ * @param bet Current bet, no bet line if 0.
+ * @param reels Symbol index of every reel.
+ *
+ * @return 0 on success, -1 on write error or if the frame does not fit
+ *         in SLOT_FRAME_SIZE bytes.
+ */
+int slot_screen_draw(struct slot_screen *screen, int fd, int credits, int bet, const int reels[3]) {
+    char frame[SLOT_FRAME_SIZE];
+    size_t len = slot_screen_compose(screen, credits, bet, reels, frame, sizeof(frame));
+    size_t done = 0;
+
+    /* a frame that does not fit was not composed: the screen keeps the last one */
+    if (len == 0)
+        return -1;
+
+    fflush(stdout);
 
-        pad = INNER_WIDTH - utf8_width(line);
-        if (pad < 0) pad = 0;
+    while (done < len) {
+        ssize_t n = write(fd, frame + done, len - done);
 
-        printf("│ %s%*s │\n", line, pad, "");
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        done += n;
     }
 
-    printf("└===================┘\n");
-    printf("      [ %s ]\n", _("Spin!"));
+    return 0;
+}
+
+/**
+ * @brief Start collecting frame statistics.
+ *
+ * @param stats Statistics to reset.
+ * @param period_ns Nominal frame period.
+ */
+void slot_frame_stats_init(struct slot_frame_stats *stats, int64_t period_ns) {
+    memset(stats, 0, sizeof(*stats));
+    stats->period_ns = period_ns;
+}
+
+/**
+ * @brief Record a frame.
+ *
+ * The interval to the previous frame is divided by @p ticks, so a late
+ * frame after missed ticks is not counted as one huge interval.
+ *
+ * @param stats Statistics.
+ * @param now_ns Monotonic time of the frame.
+ * @param ticks Timer ticks since the previous frame.
+ */
+void slot_frame_stats_add(struct slot_frame_stats *stats, int64_t now_ns, uint64_t ticks) {
+    int64_t last = stats->last_ns;
+
+    stats->last_ns = now_ns;
+    if (last == 0)
+        return;
+
+    if (ticks > 1)
+        stats->missed += ticks - 1;
+
+    int64_t interval = (now_ns - last) / (int64_t)(ticks ? ticks : 1);
+    int64_t jitter = interval > stats->period_ns ? interval - stats->period_ns : stats->period_ns - interval;
+    int bucket = 0;
+
+    while (bucket < SLOT_JITTER_BUCKETS - 1 && jitter >= (int64_t)SLOT_JITTER_FIRST_NS << bucket)
+        bucket++;
+
+    stats->buckets[bucket]++;
+    stats->frames++;
+    stats->sum_ms += interval / 1e6;
+    stats->sum_squares_ms += (interval / 1e6) * (interval / 1e6);
+    if (jitter > stats->max_jitter_ns)
+        stats->max_jitter_ns = jitter;
+}
+
+/**
+ * @brief End an animation; the next frame starts a new interval.
+ *
+ * @param stats Statistics.
+ */
+void slot_frame_stats_pause(struct slot_frame_stats *stats) {
+    stats->last_ns = 0;
+}
+
+/**
+ * @brief Print the interval summary and the jitter histogram.
+ *
+ * @param stats Statistics.
+ * @param out Output stream.
+ */
+void slot_frame_stats_print(const struct slot_frame_stats *stats, FILE *out) {
+    uint64_t top = 1;
+
+    fprintf(out, "frames: %llu, missed ticks: %llu, period %.3f ms\n",
+            (unsigned long long)stats->frames, (unsigned long long)stats->missed,
+            stats->period_ns / 1e6);
+
+    if (stats->frames == 0)
+        return;
+
+    double mean = stats->sum_ms / stats->frames;
+    double variance = stats->sum_squares_ms / stats->frames - mean * mean;
+
+    fprintf(out, "interval: mean %.3f ms, sd %.3f ms, max jitter %.3f ms\n",
+            mean, variance > 0 ? sqrt(variance) : 0.0, stats->max_jitter_ns / 1e6);
+
+    for (int i = 0; i < SLOT_JITTER_BUCKETS; i++)
+        top = stats->buckets[i] > top ? stats->buckets[i] : top;
+
+    for (int i = 0; i < SLOT_JITTER_BUCKETS; i++) {
+        char bar[41];
+        int len = (int)(stats->buckets[i] * 40 / top);
+
+        memset(bar, '#', len);
+        bar[len] = '\0';
+
+        if (i < SLOT_JITTER_BUCKETS - 1)
+            fprintf(out, "  jitter < %8.3f ms %8llu %s\n", ((int64_t)SLOT_JITTER_FIRST_NS << i) / 1e6,
+                    (unsigned long long)stats->buckets[i], bar);
+        else
+            fprintf(out, "  jitter >= %7.3f ms %8llu %s\n", ((int64_t)SLOT_JITTER_FIRST_NS << (i - 1)) / 1e6,
+                    (unsigned long long)stats->buckets[i], bar);
+    }
 }
 
 /**
  * @brief Generate a random reel symbol index.
  *
- * Returns a random integer from 0 to NUM_ITEMS-1 representing
- * a reel symbol.
+ * Draws the first reel of the current machine.
  *
  * @return Random index for the reel symbol.
  */
 int spin_reel() {
-    return rand() % NUM_ITEMS;
+    return slot_spin(0);
+}
+
+/**
+ * @brief Largest number of equal symbols among the three reels.
+ *
+ * @param r1 Symbol index of reel 1.
+ * @param r2 Symbol index of reel 2.
+ * @param r3 Symbol index of reel 3.
+ *
+ * @return 3, 2 or 1.
+ */
+int slot_matches(int r1, int r2, int r3) {
+    if (r1 == r2 && r2 == r3)
+        return 3;
+    if (r1 == r2 || r2 == r3 || r1 == r3)
+        return 2;
+    return 1;
+}
+
+/**
+ * @brief Credit change caused by a spin.
+ *
+ * @param r1 Symbol index of reel 1.
+ * @param r2 Symbol index of reel 2.
+ * @param r3 Symbol index of reel 3.
+ * @param bet Bet amount.
+ *
+ * @return Credits won (positive) or lost (negative).
+ */
+int slot_payout(int r1, int r2, int r3, int bet) {
+    switch (slot_matches(r1, r2, r3)) {
+        case 3:
+            return bet * PAYOUT_THREE;
+        case 2:
+            return bet * PAYOUT_TWO;
+        default:
+            return -bet;
+    }
+}
+
+/** @brief Equal weights of the classic model. */
+static const double classic_weights[NUM_ITEMS] = { 1, 1, 1, 1, 1, 1 };
+
+/** @brief Payouts of the classic model, as in slot_payout(). */
+static const int classic_payouts[4] = { 0, -1, PAYOUT_TWO, PAYOUT_THREE };
+
+const struct slot_model slot_classic_model = {
+    3, NUM_ITEMS, classic_weights, classic_payouts
+};
+
+/**
+ * @brief Probability that no symbol shows on more than @p limit reels.
+ *
+ * Adds the symbols one at a time; `filled[n]` is the probability mass of
+ * the outcomes where the symbols so far occupy n given reels, each at most
+ * @p limit times. Placing j copies of the next symbol among n + j reels
+ * multiplies by C(n + j, j) p^j, so the values stay within [0, 1].
+ *
+ * @param model Machine description.
+ * @param total Sum of the weights.
+ * @param limit Largest allowed count of a symbol.
+ * @return The probability.
+ */
+static double max_count_at_most(const struct slot_model *model, double total, unsigned limit) {
+    unsigned reels = model->reels;
+    double filled[SLOT_MAX_REELS + 1] = { 1 };
+    double next[SLOT_MAX_REELS + 1];
+
+    for (unsigned i = 0; i < model->symbols; i++) {
+        double p = model->weights[i] / total;
+
+        memset(next, 0, sizeof(next));
+
+        for (unsigned n = 0; n <= reels; n++) {
+            if (filled[n] == 0)
+                continue;
+
+            double term = filled[n];  /* filled[n] * C(n + j, j) * p^j */
+
+            for (unsigned j = 0; j <= limit && n + j <= reels; j++) {
+                next[n + j] += term;
+                term *= p * (n + j + 1) / (j + 1);
+            }
+        }
+
+        memcpy(filled, next, sizeof(filled));
+    }
+
+    return filled[reels];
+}
+
+/**
+ * @brief Exact probability of every largest match count.
+ *
+ * @param model Machine description.
+ * @param probabilities Output array of `reels + 1` entries.
+ * @return 0 on success, -1 if the model is invalid.
+ */
+int slot_distribution(const struct slot_model *model, double *probabilities) {
+    double total = 0;
+
+    if (!model || model->reels < 1 || model->reels > SLOT_MAX_REELS || model->symbols < 1)
+        return -1;
+
+    for (unsigned i = 0; i < model->symbols; i++) {
+        if (!(model->weights[i] >= 0))
+            return -1;
+        total += model->weights[i];
+    }
+
+    if (total <= 0)
+        return -1;
+
+    double below = 0;
+
+    probabilities[0] = 0;
+    for (unsigned k = 1; k <= model->reels; k++) {
+        double at_most = k == model->reels ? 1 : max_count_at_most(model, total, k);
+
+        probabilities[k] = at_most > below ? at_most - below : 0;
+        below = at_most;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Expected credit change of a spin, in bets.
+ *
+ * @param model Machine description.
+ * @param probabilities Result of slot_distribution().
+ * @return Expected change per unit bet.
+ */
+double slot_expected_change(const struct slot_model *model, const double *probabilities) {
+    double expected = 0;
+
+    for (unsigned k = 1; k <= model->reels; k++)
+        expected += probabilities[k] * model->payouts[k];
+
+    return expected;
+}
+
+/** @brief Active probability mass below which an unlimited game is over. */
+#define RUIN_EPSILON 1e-12
+
+/**
+ * @brief Probability of running out of credits with a fixed bet.
+ *
+ * `state[c]` is the probability of holding c credits with the game still
+ * running; every spin moves it along the payouts, and the mass leaving
+ * the range is added to the ruin or target side. Without a spin limit,
+ * spins that do not change the credits cannot affect the outcome, so
+ * they are left out and the other probabilities rescaled.
+ *
+ * @param model Machine description.
+ * @param probabilities Result of slot_distribution().
+ * @param credits Starting credits.
+ * @param bet Bet of every spin.
+ * @param target Credits at which the player stops.
+ * @param spins Largest number of spins, or 0 for no limit.
+ * @return Probability of ruin, or -1 on invalid arguments.
+ */
+double slot_ruin_probability(const struct slot_model *model, const double *probabilities,
+                             int credits, int bet, int target, unsigned spins) {
+    if (!model || bet <= 0 || credits < 0 || target <= credits)
+        return -1;
+
+    if (credits < bet)
+        return 1;
+
+    double *state = calloc(2 * (size_t)target, sizeof(*state));
+    if (!state)
+        return -1;
+
+    double *next = state + target;
+    double ruin = 0;
+    double active = 1;
+    double scale = 1;
+
+    if (spins == 0) {
+        double moving = 0;
+
+        for (unsigned k = 1; k <= model->reels; k++)
+            moving += model->payouts[k] != 0 ? probabilities[k] : 0;
+
+        if (moving <= 0) {
+            free(state);
+            return 0;
+        }
+        scale = 1 / moving;
+    }
+
+    state[credits] = 1;
+
+    for (unsigned spin = 0; spins == 0 || spin < spins; spin++) {
+        if (active < RUIN_EPSILON)
+            break;
+
+        memset(next, 0, target * sizeof(*next));
+        active = 0;
+
+        for (int c = bet; c < target; c++) {
+            if (state[c] == 0)
+                continue;
+
+            for (unsigned k = 1; k <= model->reels; k++) {
+                double mass = state[c] * probabilities[k] * scale;
+                long to = c + (long)model->payouts[k] * bet;
+
+                if (mass == 0 || (spins == 0 && to == c))
+                    continue;
+                if (to < bet)
+                    ruin += mass;
+                else if (to < target) {
+                    next[to] += mass;
+                    active += mass;
+                }
+            }
+        }
+
+        double *swap = state;
+        state = next;
+        next = swap;
+    }
+
+    free(state < next ? state : next);
+    return ruin;
+}
+
+/**
+ * @brief Seed a generator with splitmix64 output.
+ *
+ * @param rng Generator.
+ * @param seed Any value.
+ */
+void slot_rng_seed(struct slot_rng *rng, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        rng->s[i] = z ^ (z >> 31);
+    }
+}
+
+/**
+ * @brief Advance a generator by 2^128 steps.
+ *
+ * @param rng Generator.
+ */
+void slot_rng_jump(struct slot_rng *rng) {
+    static const uint64_t jump[4] = {
+        0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+        0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+    };
+    uint64_t s[4] = { 0, 0, 0, 0 };
+
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (jump[i] & (1ULL << b)) {
+                for (int k = 0; k < 4; k++)
+                    s[k] ^= rng->s[k];
+            }
+            slot_rng_next(rng);
+        }
+    }
+
+    memcpy(rng->s, s, sizeof(s));
 }
@@ -10,23 +10,99 @@
 #ifndef SLOT_LIB_H
 #define SLOT_LIB_H
 
-/** @brief Number of different items in the slot machine. */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** @brief Number of symbols of the built-in machine. */
 #define NUM_ITEMS 6
 
-/** @brief Width of the inner reel display (must match symbols width). */
-#define INNER_WIDTH 17
+/** @brief Number of reels of the machine. */
+#define SLOT_REELS 3
+
+/** @brief Largest number of symbols in a machine configuration. */
+#define SLOT_MAX_SYMBOLS 1024
+
+/** @brief Limit on the size in bytes of a symbol picture line, terminator included. */
+#define SLOT_SYMBOL_SIZE 64
+
+/** @brief Win multiplier for three matching symbols. */
+#define PAYOUT_THREE 5
+
+/** @brief Win multiplier for two matching symbols. */
+#define PAYOUT_TWO 2
+
+/** @brief Maximum number of rows in a frame drawn by the renderer. */
+#define SLOT_SCREEN_ROWS 10
+
+/** @brief Maximum size of a frame row in bytes. */
+#define SLOT_ROW_SIZE 256
+
+/** @brief Buffer size sufficient for any composed frame. */
+#define SLOT_FRAME_SIZE 8192
+
+/**
+ * @brief Translated strings of the game.
+ *
+ * Every string is looked up in the message catalog once, by
+ * slot_messages_load(), instead of on every animation frame. The display
+ * widths of the padded labels are cached along with them.
+ */
+struct slot_messages {
+    const char *title;          /**< Header title */
+    const char *credits;        /**< Credits label of the header */
+    const char *current_bet;    /**< Bet label of the footer */
+    const char *spin;           /**< Spin button of the footer */
+    const char *enter_bet;      /**< Bet prompt */
+    const char *invalid_input;  /**< Bet is not a number */
+    const char *invalid_bet;    /**< Bet is out of range, takes the credits */
+    const char *out_of_credits; /**< Game over message */
+    const char *thanks;         /**< Quit message */
+    const char *jackpot;        /**< Three matches, takes the win */
+    const char *two_matched;    /**< Two matches, takes the win */
+    const char *no_match;       /**< No match, takes the bet */
+    const char *press_enter;    /**< Prompt after a spin */
+    int credits_width;          /**< Display width of ::credits */
+    int current_bet_width;      /**< Display width of ::current_bet */
+};
+
+/**
+ * @brief Display width of a UTF-8 string in terminal columns.
+ *
+ * Does not depend on the locale: combining marks take no columns and
+ * East Asian wide characters take two. Invalid bytes take one each.
+ *
+ * @param s Input UTF-8 string.
+ * @return Display width.
+ */
+int slot_utf8_width(const char *s);
+
+/**
+ * @brief Resolve all translated strings of the game.
+ *
+ * Call it after setting up the locale and the text domain, and again
+ * whenever the locale changes.
+ */
+void slot_messages_load(void);
 
 /**
- * @brief 2D array representing all slot machine symbols.
+ * @brief Get the translated strings of the game.
  *
- * Each symbol consists of 3 strings forming a 3x5 visual representation:
- *  ┌───┐
- *  │ 1 │
- *  └───┘
+ * Loads them on first use if slot_messages_load() has not been called.
  *
- * Indexed as symbols[NUM_ITEMS][3].
+ * @return Pointer to the cached strings.
  */
-extern const char *symbols[NUM_ITEMS][3];
+const struct slot_messages *slot_messages(void);
+
+/**
+ * @brief Number of message catalog lookups made by the library.
+ *
+ * Instrumentation counter used to verify that drawing a frame does not
+ * go through gettext().
+ *
+ * @return Total number of gettext() calls so far.
+ */
+unsigned long slot_gettext_calls(void);
 
 /**
  * @brief Print the game header including current credits.
@@ -51,14 +127,377 @@ void print_reels(const char *r1[3], const char *r2[3], const char *r3[3]);
  */
 void print_footer(int bet);
 
+/**
+ * @brief Terminal renderer state: the last frame drawn.
+ *
+ * Lets the renderer redraw only what changed between frames.
+ */
+struct slot_screen {
+    char rows[SLOT_SCREEN_ROWS][SLOT_ROW_SIZE]; /**< Text of every row */
+    int reels[3];                               /**< Symbol index of every reel */
+    int count;                                  /**< Number of rows */
+    int drawn;                                  /**< Whether a frame is on screen */
+};
+
+/**
+ * @brief Reset the renderer; the next frame clears the screen.
+ *
+ * @param screen Renderer state.
+ */
+void slot_screen_init(struct slot_screen *screen);
+
+/**
+ * @brief Compose a frame as ANSI escape sequences.
+ *
+ * Only the rows and reel cells that differ from the previous frame are
+ * redrawn, using cursor positioning instead of clearing the screen.
+ *
+ * @param screen Renderer state, updated to the new frame.
+ * @param credits Current player credits.
+ * @param bet Current bet, no bet line if 0.
+ * @param reels Symbol index of every reel.
+ * @param out Output buffer, SLOT_FRAME_SIZE bytes are always enough.
+ * @param size Size of @p out.
+ * @return Number of bytes composed, 0 if @p out is too small.
+ */
+size_t slot_screen_compose(struct slot_screen *screen, int credits, int bet, const int reels[3],
+                           char *out, size_t size);
+
+/**
+ * @brief Compose a frame and emit it with a single write().
+ *
+ * @param screen Renderer state.
+ * @param fd Terminal file descriptor.
+ * @param credits Current player credits.
+ * @param bet Current bet, no bet line if 0.
+ * @param reels Symbol index of every reel.
+ * @return 0 on success, -1 on write error or if the frame does not fit.
+ */
+int slot_screen_draw(struct slot_screen *screen, int fd, int credits, int bet, const int reels[3]);
+
+/** @brief Number of buckets of a frame timing histogram. */
+#define SLOT_JITTER_BUCKETS 12
+
+/** @brief Upper bound of the first histogram bucket, in nanoseconds. */
+#define SLOT_JITTER_FIRST_NS 50000
+
+/**
+ * @brief Frame timing statistics of an animation.
+ *
+ * Bucket i counts frames whose distance from the nominal period is below
+ * SLOT_JITTER_FIRST_NS * 2^i; the last bucket takes everything longer.
+ */
+struct slot_frame_stats {
+    int64_t period_ns;                     /**< Nominal frame period */
+    int64_t last_ns;                       /**< Time of the previous frame, 0 if none */
+    uint64_t frames;                       /**< Frame intervals recorded */
+    uint64_t missed;                       /**< Timer ticks without a frame */
+    double sum_ms;                         /**< Sum of the intervals */
+    double sum_squares_ms;                 /**< Sum of the squared intervals */
+    int64_t max_jitter_ns;                 /**< Largest distance from the period */
+    uint64_t buckets[SLOT_JITTER_BUCKETS]; /**< Histogram of the distance */
+};
+
+/**
+ * @brief Start collecting frame statistics.
+ *
+ * @param stats Statistics to reset.
+ * @param period_ns Nominal frame period.
+ */
+void slot_frame_stats_init(struct slot_frame_stats *stats, int64_t period_ns);
+
+/**
+ * @brief Record a frame.
+ *
+ * @param stats Statistics.
+ * @param now_ns Monotonic time of the frame.
+ * @param ticks Timer ticks since the previous frame (1 when on time).
+ */
+void slot_frame_stats_add(struct slot_frame_stats *stats, int64_t now_ns, uint64_t ticks);
+
+/**
+ * @brief End an animation; the next frame starts a new interval.
+ *
+ * @param stats Statistics.
+ */
+void slot_frame_stats_pause(struct slot_frame_stats *stats);
+
+/**
+ * @brief Print the interval summary and the jitter histogram.
+ *
+ * @param stats Statistics.
+ * @param out Output stream.
+ */
+void slot_frame_stats_print(const struct slot_frame_stats *stats, FILE *out);
+
 /**
  * @brief Generate a random reel result.
  *
- * Returns an integer index between 0 and NUM_ITEMS-1
- * corresponding to one of the symbols.
+ * Draws the first reel of the current machine, see slot_spin().
  *
  * @return Index of the selected symbol for the reel.
  */
 int spin_reel();
 
+/**
+ * @brief Largest number of equal symbols among the three reels.
+ *
+ * @param r1 Symbol index of reel 1.
+ * @param r2 Symbol index of reel 2.
+ * @param r3 Symbol index of reel 3.
+ * @return 3 for three matches, 2 for two matches, 1 for none.
+ */
+int slot_matches(int r1, int r2, int r3);
+
+/**
+ * @brief Credit change caused by a spin.
+ *
+ * Three matches win PAYOUT_THREE times the bet, two matches win
+ * PAYOUT_TWO times the bet, otherwise the bet is lost. The bet itself
+ * is not taken on a win.
+ *
+ * @param r1 Symbol index of reel 1.
+ * @param r2 Symbol index of reel 2.
+ * @param r3 Symbol index of reel 3.
+ * @param bet Bet amount.
+ * @return Credits won (positive) or lost (negative).
+ */
+int slot_payout(int r1, int r2, int r3, int bet);
+
+/** @brief Largest number of reels supported by the exact analysis. */
+#define SLOT_MAX_REELS 64
+
+/**
+ * @brief Description of a machine for the exact payout analysis.
+ *
+ * All reels share the same symbol weights. A spin is scored by the largest
+ * number of reels showing the same symbol: `payouts[k]` is the credit
+ * change, in bets, when that number is k (`payouts[0]` is unused).
+ */
+struct slot_model {
+    unsigned reels;         /**< Number of reels, 1 to SLOT_MAX_REELS */
+    unsigned symbols;       /**< Number of symbols on a reel */
+    const double *weights;  /**< Relative weight of every symbol */
+    const int *payouts;     /**< Credit change by largest match, `reels + 1` entries */
+};
+
+/** @brief The game itself: 3 reels, NUM_ITEMS equally likely symbols. */
+extern const struct slot_model slot_classic_model;
+
+/**
+ * @brief Exact probability of every largest match count.
+ *
+ * Runs in O(symbols * reels^3) time and O(reels) memory.
+ *
+ * @param model Machine description.
+ * @param probabilities Output array of `reels + 1` entries;
+ *        `probabilities[k]` is the chance that exactly k reels show
+ *        the same symbol.
+ * @return 0 on success, -1 if the model is invalid.
+ */
+int slot_distribution(const struct slot_model *model, double *probabilities);
+
+/**
+ * @brief Expected credit change of a spin, in bets.
+ *
+ * The return to player is one plus this value.
+ *
+ * @param model Machine description.
+ * @param probabilities Result of slot_distribution().
+ * @return Expected change per unit bet.
+ */
+double slot_expected_change(const struct slot_model *model, const double *probabilities);
+
+/**
+ * @brief Probability of running out of credits with a fixed bet.
+ *
+ * The player starts with @p credits and bets @p bet on every spin until
+ * the credits drop below the bet (ruin), reach @p target, or @p spins
+ * spins have been played. Computed by dynamic programming over the
+ * credit states 0..target-1 in O(spins * target * reels) time.
+ *
+ * @param model Machine description.
+ * @param probabilities Result of slot_distribution().
+ * @param credits Starting credits.
+ * @param bet Bet of every spin, positive.
+ * @param target Credits at which the player stops, above @p credits.
+ * @param spins Largest number of spins, or 0 to play until ruin or target.
+ * @return Probability of ruin, or -1 on invalid arguments.
+ */
+double slot_ruin_probability(const struct slot_model *model, const double *probabilities,
+                             int credits, int bet, int target, unsigned spins);
+
+/**
+ * @brief State of a xoshiro256** random number generator.
+ *
+ * Unlike rand() every generator is independent, so each thread of a
+ * simulation can own one.
+ */
+struct slot_rng {
+    uint64_t s[4]; /**< Generator state, never all zero */
+};
+
+/**
+ * @brief Seed a generator.
+ *
+ * @param rng Generator.
+ * @param seed Any value; expanded with splitmix64.
+ */
+void slot_rng_seed(struct slot_rng *rng, uint64_t seed);
+
+/**
+ * @brief Advance a generator by 2^128 steps.
+ *
+ * Seeding one generator and jumping it once per thread gives
+ * non-overlapping streams.
+ *
+ * @param rng Generator.
+ */
+void slot_rng_jump(struct slot_rng *rng);
+
+/**
+ * @brief Next 64 random bits (xoshiro256**).
+ *
+ * Defined in the header so that simulation loops can inline it.
+ *
+ * @param rng Generator.
+ * @return Random value.
+ */
+static inline uint64_t slot_rng_next(struct slot_rng *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = ((s[1] * 5) << 7 | (s[1] * 5) >> 57) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = s[3] << 45 | s[3] >> 19;
+
+    return result;
+}
+
+/**
+ * @brief Uniform random integer in [0, @p n) without modulo bias.
+ *
+ * Uses Lemire's multiply-shift method; products landing in the biased
+ * low part are rejected, which happens with probability below n / 2^32.
+ *
+ * @param rng Generator.
+ * @param n Upper bound, must be positive.
+ * @return Random value below @p n.
+ */
+static inline uint32_t slot_rng_below(struct slot_rng *rng, uint32_t n) {
+    uint64_t m = (slot_rng_next(rng) >> 32) * n;
+    uint32_t low = (uint32_t)m;
+
+    if (low < n) {
+        uint32_t threshold = -n % n;
+
+        while (low < threshold) {
+            m = (slot_rng_next(rng) >> 32) * n;
+            low = (uint32_t)m;
+        }
+    }
+
+    return m >> 32;
+}
+
+/**
+ * @brief Weighted symbol sampler of one reel strip (alias table).
+ *
+ * Column i, picked uniformly, yields symbol i with probability
+ * `threshold[i] / 2^32` and `alias[i]` otherwise.
+ */
+struct slot_alias {
+    unsigned count;       /**< Number of symbols */
+    uint64_t *threshold;  /**< Probability of keeping the column, scaled by 2^32 */
+    unsigned *alias;      /**< Replacement symbol of every column */
+};
+
+/**
+ * @brief Draw a symbol of a reel in constant time.
+ *
+ * @param reel Alias table of the reel.
+ * @param rng Generator.
+ * @return Symbol index.
+ */
+static inline unsigned slot_alias_sample(const struct slot_alias *reel, struct slot_rng *rng) {
+    uint32_t column = slot_rng_below(rng, reel->count);
+
+    return (slot_rng_next(rng) >> 32) < reel->threshold[column] ? column : reel->alias[column];
+}
+
+/**
+ * @brief Symbols, pictures and reel strips of a machine.
+ *
+ * Loaded at run time by slot_config_load(); all pictures have the same
+ * display width, which sets the width of the whole machine.
+ */
+struct slot_config {
+    unsigned num_symbols;                 /**< Number of symbols */
+    const char *(*symbols)[3];            /**< Three picture lines of every symbol */
+    double *weights[SLOT_REELS];          /**< Weight of every symbol on every reel */
+    struct slot_alias reels[SLOT_REELS];  /**< Sampler of every reel */
+    int symbol_width;                     /**< Display width of a picture */
+    int inner_width;                      /**< Display width inside the frame */
+    char *text;                           /**< Storage of the pictures */
+};
+
+/**
+ * @brief Use a machine described by a configuration file.
+ *
+ * Every non-empty line not starting with '#' describes a symbol: its
+ * weight on each of the SLOT_REELS reels, then the three lines of its
+ * picture separated by '|'. On failure the current machine is kept.
+ * Renderers must be reset with slot_screen_init() after a change.
+ *
+ * @param path File name.
+ * @param error_line Set to the number of the offending line, 0 for I/O
+ *        errors (errno is set); may be NULL.
+ * @return 0 on success, -1 on error.
+ */
+int slot_config_load(const char *path, unsigned *error_line);
+
+/**
+ * @brief Use a machine described by configuration text.
+ *
+ * @param text Text in the format of slot_config_load().
+ * @param error_line Set to the number of the offending line; may be NULL.
+ * @return 0 on success, -1 on error.
+ */
+int slot_config_parse(const char *text, unsigned *error_line);
+
+/**
+ * @brief Go back to the built-in machine: NUM_ITEMS equally likely symbols.
+ */
+void slot_config_default(void);
+
+/**
+ * @brief Get the current machine.
+ *
+ * @return Pointer to the machine, the built-in one if none was loaded.
+ */
+const struct slot_config *slot_config(void);
+
+/**
+ * @brief Seed the generator used by slot_spin().
+ *
+ * Without a call, the generator is seeded from the time and process ID.
+ *
+ * @param seed Any value.
+ */
+void slot_seed(uint64_t seed);
+
+/**
+ * @brief Draw the symbol of one reel of the current machine.
+ *
+ * Unbiased, with the probabilities given by the reel weights.
+ *
+ * @param reel Reel number, 0 to SLOT_REELS - 1.
+ * @return Symbol index.
+ */
+int slot_spin(unsigned reel);
+
 #endif /* SLOT_LIB_H */
@@ -3,7 +3,8 @@
  * @brief Main entry point for the Slot Machine game.
  *
  * Implements a console slot machine game with animated reels, betting,
- * credit tracking, and i18n support via gettext.
+ * credit tracking, and i18n support via gettext. The game runs on a
+ * poll() loop over the raw-mode terminal and a timerfd for the frames.
  */
 
 #include <stdio.h>
@@ -14,11 +15,15 @@
 #include <libintl.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/timerfd.h>
 #include "slot_lib.h"
 #include "config.h"
 
 #define _(STRING) gettext(STRING)  /**< Shortcut for gettext translation */
-#define CLEAR "clear"              /**< Command to clear console screen */
 
 
 /**
@@ -29,10 +34,13 @@ void print_help(void) {
     printf("=================\n");
     printf(_("\nUsage: slot_machine [options]\n\n"));
     printf(_("Options:\n"));
+    printf(_("  -c FILE       Load the symbols and reel weights from FILE\n"));
+    printf(_("  --stats       Print animation frame timing when the game ends\n"));
     printf(_("  -h, --help    Show this help message and exit\n\n"));
     printf(_("Gameplay:\n"));
     printf(_("  Enter your bet (1 to your current credits) to spin the reels.\n"));
     printf(_("  Enter 'q' to quit the game.\n"));
+    printf(_("  Press Enter while the reels spin to stop them at once.\n"));
     printf(_("  Three matching symbols: win 5× bet\n"));
     printf(_("  Two matching symbols: win 2× bet\n"));
     printf(_("  No match: lose your bet\n"));
@@ -57,128 +65,439 @@ int utf8len(const char *s) {
     return len;
 }
 
+/** @brief Period of the animation frames in nanoseconds. */
+#define FRAME_PERIOD_NS 100000000
+
+/** @brief Number of frames of a spin animation. */
+#define SPIN_FRAMES 15
+
+/** @brief States of the game loop. */
+enum game_state {
+    STATE_BET,     /**< Typing a bet */
+    STATE_SPIN,    /**< Reels are spinning */
+    STATE_RESULT,  /**< Waiting for Enter after a spin */
+    STATE_OVER     /**< The game has ended */
+};
+
+/** @brief Everything the event loop works on. */
+struct game {
+    enum game_state state;            /**< Current state */
+    const struct slot_messages *msg;  /**< Translated strings */
+    int credits;                      /**< Player's credits */
+    int bet;                          /**< Bet of the current spin */
+    char input[32];                   /**< Bet typed so far */
+    size_t input_len;                 /**< Length of ::input */
+    int result[3];                    /**< Final symbol of every reel */
+    int step;                         /**< Animation frame of the spin */
+    int timer;                        /**< timerfd of the animation frames */
+    unsigned char pending[64];        /**< Input read but not handled yet */
+    size_t pending_pos;               /**< Next byte of ::pending */
+    size_t pending_len;               /**< Bytes in ::pending */
+    struct slot_screen screen;        /**< Terminal renderer state */
+    struct slot_frame_stats stats;    /**< Frame timing */
+};
+
+/** @brief Terminal settings to restore at exit. */
+static struct termios saved_termios;
+
+/** @brief Whether ::saved_termios holds settings to restore. */
+static int raw_mode = 0;
+
+/** @brief Set by SIGINT and SIGTERM to end the loop. */
+static volatile sig_atomic_t stop = 0;
+
+/** @brief Signal handler that asks the loop to stop. */
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+/** @brief Restore the terminal settings saved by ::enter_raw_mode. */
+static void leave_raw_mode(void) {
+    if (raw_mode) {
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_termios);
+        raw_mode = 0;
+    }
+}
+
 /**
- * @brief Entry point of the Slot Machine game.
+ * @brief Read the terminal a key at a time, without echo.
  *
- * Sets up locale, initializes credits, and enters the main game loop.
- * The user can place bets, spin the reels, and win or lose credits.
- * Input validation is performed for numeric bets, and the player
- * can exit the game at any time by entering 'q'.
+ * Does nothing when stdin is not a terminal, so input can be piped.
+ */
+static void enter_raw_mode(void) {
+    struct termios raw;
+
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved_termios) != 0)
+        return;
+
+    raw = saved_termios;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == 0) {
+        raw_mode = 1;
+        atexit(leave_raw_mode);
+    }
+}
+
+/** @brief Monotonic time in nanoseconds. */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Start or stop the frame timer.
  *
- * @return Exit status code (0 on normal exit)
+ * @param game Game.
+ * @param on Start periodic ticks if nonzero, stop them otherwise.
  */
-int main(int argc, char *argv[]) {
-    setlocale(LC_ALL, "");
-    bindtextdomain("slot_machine", LOCALE_PATH);
-    textdomain("slot_machine");
+static void set_timer(struct game *game, int on) {
+    struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
 
-    // Check command-line arguments
-    for (int i = 1; i < argc; i++) {
-        if ((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0)) {
-            print_help();
-            return 0;
-        }
+    if (on) {
+        spec.it_interval.tv_nsec = FRAME_PERIOD_NS;
+        spec.it_value.tv_nsec = FRAME_PERIOD_NS;
     }
 
-    int credits = 100;  /**< Player's initial credits */
-    int r1, r2, r3;     /**< Reel results */
+    timerfd_settime(game->timer, 0, &spec, NULL);
+}
 
-    srand(time(NULL));
+/**
+ * @brief Show the machine and ask for a bet, or end the game without credits.
+ *
+ * @param game Game.
+ */
+static void start_round(struct game *game) {
+    const int initial[3] = { 0, 0, 0 };
 
-    while (1) {
-        system(CLEAR);
-        print_header(credits);
-        print_reels(symbols[0], symbols[0], symbols[0]);  /**< Initial display */
-        print_footer(0);
+    slot_screen_init(&game->screen);  /**< Clear the screen once per round */
+    slot_screen_draw(&game->screen, STDOUT_FILENO, game->credits, 0, initial);
 
-        if (credits <= 0) {
-            printf(_("\nYou are out of credits. Game over.\n"));
-            break;
+    if (game->credits <= 0) {
+        printf("%s", game->msg->out_of_credits);
+        game->state = STATE_OVER;
+    } else {
+        printf("%s", game->msg->enter_bet);
+        game->input_len = 0;
+        game->state = STATE_BET;
+    }
+
+    fflush(stdout);
+}
+
+/**
+ * @brief Draw the animation frame of the current step.
+ *
+ * Every reel shows random symbols until it stops on its result; the
+ * first reel stops two frames before the last one.
+ *
+ * @param game Game.
+ */
+static void draw_spin_frame(struct game *game) {
+    const int stops[3] = { SPIN_FRAMES - 2, SPIN_FRAMES - 1, SPIN_FRAMES };
+    int reels[3];
+
+    for (int r = 0; r < 3; r++)
+        reels[r] = game->step < stops[r] ? slot_spin(r) : game->result[r];
+
+    slot_screen_draw(&game->screen, STDOUT_FILENO, game->credits, game->bet, reels);
+}
+
+/**
+ * @brief Apply the result of a finished spin.
+ *
+ * @param game Game.
+ */
+static void finish_spin(struct game *game) {
+    const int *r = game->result;
+    int matches = slot_matches(r[0], r[1], r[2]);
+    int change = slot_payout(r[0], r[1], r[2], game->bet);
+
+    set_timer(game, 0);
+    slot_frame_stats_pause(&game->stats);
+
+    game->credits += change;
+
+    if (matches == 3)
+        printf(game->msg->jackpot, change);
+    else if (matches == 2)
+        printf(game->msg->two_matched, change);
+    else
+        printf(game->msg->no_match, -change);
+
+    printf("%s", game->msg->press_enter);
+    fflush(stdout);
+    game->state = STATE_RESULT;
+}
+
+/**
+ * @brief Handle a frame timer tick.
+ *
+ * @param game Game.
+ * @param ticks Timer expirations since the last read.
+ */
+static void on_tick(struct game *game, uint64_t ticks) {
+    if (game->state != STATE_SPIN)
+        return;
+
+    slot_frame_stats_add(&game->stats, now_ns(), ticks);
+
+    /* keep the animation on time when ticks were missed */
+    game->step += ticks;
+    if (game->step > SPIN_FRAMES)
+        game->step = SPIN_FRAMES;
+
+    draw_spin_frame(game);
+
+    if (game->step == SPIN_FRAMES)
+        finish_spin(game);
+}
+
+/**
+ * @brief Check the typed bet and start the spin if it is valid.
+ *
+ * @param game Game.
+ */
+static void submit_bet(struct game *game) {
+    const struct slot_messages *msg = game->msg;
+
+    game->input[game->input_len] = '\0';
+    game->input_len = 0;
+    printf("\n");
+
+    if (strcmp(game->input, "q") == 0 || strcmp(game->input, "Q") == 0) {
+        printf("%s", msg->thanks);
+        game->state = STATE_OVER;
+        return;
+    }
+
+    /* Validate numeric input */
+    for (size_t i = 0; game->input[i]; i++) {
+        if (!isdigit((unsigned char)game->input[i])) {
+            printf("%s", msg->invalid_input);
+            printf("%s", msg->enter_bet);
+            return;
         }
+    }
 
-        /* --- User input for bet with validation and quit option --- */
-        char input[32];
-        int bet = -1;
+    int bet = atoi(game->input);
 
-        while (1) {
-            printf(_("\nEnter your bet (or 'q' to quit): "));
-            if (!fgets(input, sizeof(input), stdin)) {
-                bet = 0;
-                break;
-            }
+    if (bet <= 0 || bet > game->credits) {
+        printf(msg->invalid_bet, game->credits);
+        printf("%s", msg->enter_bet);
+        return;
+    }
 
-            input[strcspn(input, "\n")] = 0;  /**< Remove newline */
+    game->bet = bet;
+    for (int r = 0; r < 3; r++)
+        game->result[r] = slot_spin(r);
 
-            if (strcmp(input, "q") == 0 || strcmp(input, "Q") == 0) {
-                bet = 0;
-                break;
-            }
+    game->step = 0;
+    game->state = STATE_SPIN;
+    draw_spin_frame(game);
+    slot_frame_stats_add(&game->stats, now_ns(), 1);
+    set_timer(game, 1);
+}
+
+/**
+ * @brief Handle a key press.
+ *
+ * While typing a bet, keys are echoed and Backspace works; Enter submits.
+ * Enter during a spin stops the reels at once, and Enter after a spin
+ * starts the next round.
+ *
+ * @param game Game.
+ * @param key Byte read from the terminal.
+ */
+static void on_key(struct game *game, unsigned char key) {
+    int enter = key == '\n' || key == '\r';
 
-            /* Validate numeric input */
-            int valid = 1;
-            for (size_t i = 0; i < strlen(input); i++) {
-                if (!isdigit((unsigned char)input[i])) {
-                    valid = 0;
-                    break;
+    switch (game->state) {
+        case STATE_BET:
+            if (enter) {
+                submit_bet(game);
+            } else if (key == 0x7F || key == '\b') {
+                if (game->input_len > 0) {
+                    game->input_len--;
+                    if (raw_mode)
+                        printf("\b \b");
                 }
+            } else if (key >= ' ' && game->input_len < sizeof(game->input) - 1) {
+                game->input[game->input_len++] = key;
+                if (raw_mode)
+                    putchar(key);
             }
-
-            if (!valid) {
-                printf(_("Invalid input. Please enter a number or 'q'.\n"));
-                continue;
+            break;
+        case STATE_SPIN:
+            if (enter) {
+                game->step = SPIN_FRAMES;
+                draw_spin_frame(game);
+                finish_spin(game);
             }
+            break;
+        case STATE_RESULT:
+            if (enter)
+                start_round(game);
+            break;
+        case STATE_OVER:
+            break;
+    }
 
-            bet = atoi(input);
+    fflush(stdout);
+}
+
+/**
+ * @brief Whether key presses are handled in the current state.
+ *
+ * Piped input is not read during a spin, so that a script's answer to
+ * "Press Enter" is not taken as a request to stop the reels.
+ *
+ * @param game Game.
+ * @return 1 if keys are handled now.
+ */
+static int accepts_keys(const struct game *game) {
+    return raw_mode || game->state != STATE_SPIN;
+}
 
-            if (bet <= 0 || bet > credits) {
-                printf(_("Invalid bet. Must be between 1 and %d.\n"), credits);
+/**
+ * @brief Run the game until it ends, the input closes or a signal arrives.
+ *
+ * A single poll() waits for both key presses and animation ticks, so
+ * input is handled while the reels spin and frames follow the timerfd
+ * instead of sleeping between them.
+ *
+ * @param game Game.
+ * @return 0 on normal exit, 1 on a system error.
+ */
+static int run(struct game *game) {
+    struct pollfd fds[2] = {
+        { STDIN_FILENO, POLLIN, 0 },
+        { game->timer, POLLIN, 0 }
+    };
+
+    start_round(game);
+
+    while (game->state != STATE_OVER && !stop) {
+        while (game->pending_pos < game->pending_len && accepts_keys(game) && game->state != STATE_OVER)
+            on_key(game, game->pending[game->pending_pos++]);
+
+        if (game->state == STATE_OVER)
+            break;
+
+        /* a negative descriptor is skipped by poll() */
+        int reading = game->pending_pos == game->pending_len && accepts_keys(game);
+        fds[0].fd = reading ? STDIN_FILENO : -1;
+
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
                 continue;
-            }
+            perror("poll");
+            return 1;
+        }
 
-            break;  /**< Correct input received */
+        if (fds[1].revents & POLLIN) {
+            uint64_t ticks;
+
+            if (read(game->timer, &ticks, sizeof(ticks)) == sizeof(ticks))
+                on_tick(game, ticks);
         }
 
-        if (bet == 0) {
-            printf(_("\nThanks for playing.\n"));
-            break;
+        if (reading && (fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t n = read(STDIN_FILENO, game->pending, sizeof(game->pending));
+
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                /* end of input: finish like 'q' */
+                if (game->state == STATE_SPIN)
+                    on_key(game, '\n');
+                printf("%s", game->msg->thanks);
+                game->state = STATE_OVER;
+                break;
+            }
+
+            game->pending_pos = 0;
+            game->pending_len = n;
         }
+    }
 
-        /* --- Independent reel animation --- */
-        int total_steps = 15;
-        r1 = spin_reel();
-        r2 = spin_reel();
-        r3 = spin_reel();
+    fflush(stdout);
+    return 0;
+}
 
-        for (int step = 0; step <= total_steps; step++) {
-            int i1 = step < total_steps - 2 ? spin_reel() : r1;
-            int i2 = step < total_steps - 1 ? spin_reel() : r2;
-            int i3 = step < total_steps     ? spin_reel() : r3;
+/**
+ * @brief Entry point of the Slot Machine game.
+ *
+ * Sets up locale, initializes credits, and enters the main game loop.
+ * The user can place bets, spin the reels, and win or lose credits.
+ * Input validation is performed for numeric bets, and the player
+ * can exit the game at any time by entering 'q'.
+ *
+ * @return Exit status code (0 on normal exit)
+ */
+int main(int argc, char *argv[]) {
+    setlocale(LC_ALL, "");
+    bindtextdomain("slot_machine", LOCALE_PATH);
+    textdomain("slot_machine");
+    slot_messages_load();
 
-            system(CLEAR);
-            print_header(credits);
-            print_reels(symbols[i1], symbols[i2], symbols[i3]);
-            print_footer(bet);
+    int show_stats = 0;  /**< Print frame timing at exit */
 
-            usleep(100000);  /**< Delay for animation effect */
+    // Check command-line arguments
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0)) {
+            print_help();
+            return 0;
         }
+        if (strcmp(argv[i], "--stats") == 0)
+            show_stats = 1;
+        if (strcmp(argv[i], "-c") == 0) {
+            unsigned line;
 
-        /* --- Payout logic --- */
-        if (r1 == r2 && r2 == r3) {
-            int win = bet * 5;
-            credits += win;
-            printf(_("\nJACKPOT! You win %d credits.\n"), win);
-        } else if (r1 == r2 || r2 == r3 || r1 == r3) {
-            int win = bet * 2;
-            credits += win;
-            printf(_("\nTwo matched! You win %d credits.\n"), win);
-        } else {
-            credits -= bet;
-            printf(_("\nNo match. You lose %d credits.\n"), bet);
+            if (i + 1 == argc) {
+                print_help();
+                return 1;
+            }
+
+            if (slot_config_load(argv[++i], &line) != 0) {
+                if (line)
+                    fprintf(stderr, _("%s:%u: invalid machine description\n"), argv[i], line);
+                else
+                    perror(argv[i]);
+                return 1;
+            }
         }
+    }
 
-        printf(_("\nPress Enter to continue..."));
-        getchar();
+    struct game game = { 0 };
+    struct sigaction action = { 0 };
+
+    game.msg = slot_messages();
+    game.credits = 100;  /**< Player's initial credits */
+    game.timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (game.timer < 0) {
+        perror("timerfd_create");
+        return 1;
     }
 
-    return 0;
+    slot_frame_stats_init(&game.stats, FRAME_PERIOD_NS);
+    slot_seed((uint64_t)time(NULL) ^ (uint64_t)getpid() << 32);
+
+    action.sa_handler = on_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    enter_raw_mode();
+    int status = run(&game);
+    leave_raw_mode();
+    close(game.timer);
+
+    if (show_stats)
+        slot_frame_stats_print(&game.stats, stderr);
+
+    return status;
 }
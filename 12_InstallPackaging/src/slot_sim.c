@@ -0,0 +1,277 @@
+/**
+ * @file slot_sim.c
+ * @brief Headless Monte Carlo simulator of the slot machine payouts.
+ *
+ * Spins the reels with the same rules as the game, without any output
+ * per spin, and reports the return to player (RTP), the variance of a
+ * spin and the hit frequency with 95% confidence intervals, next to the
+ * exact values of slot_distribution() when all reels have the same
+ * weights. The machine is the built-in one or a configuration file.
+ *
+ * Every thread owns a xoshiro256** generator. The generators start from
+ * one seed and are jumped apart, so the streams never overlap and a run
+ * is reproducible for a given seed and thread count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "slot_lib.h"
+
+/** @brief Quantile of the normal distribution for a 95% confidence interval. */
+#define Z_95 1.959963984540054
+
+/** @brief Upper limit of the -t option. */
+#define MAX_THREADS 256
+
+/** @brief Work and results of one simulation thread. */
+struct sim_task {
+    struct slot_rng rng;   /**< Private generator */
+    uint64_t spins;        /**< Number of spins to simulate */
+    int64_t sum;           /**< Sum of credit changes, in bets */
+    uint64_t sum_squares;  /**< Sum of squared credit changes */
+    uint64_t hits;         /**< Spins with a win */
+    uint64_t jackpots;     /**< Spins with three matches */
+};
+
+/**
+ * @brief Print usage of the simulator.
+ *
+ * @param prog Program name.
+ */
+static void print_help(const char *prog) {
+    printf("Usage: %s [-n SPINS] [-t THREADS] [-s SEED] [-c FILE]\n", prog);
+    printf("  -n SPINS    Number of spins (default 100000000)\n");
+    printf("  -t THREADS  Number of threads (default: online CPUs)\n");
+    printf("  -s SEED     Generator seed (default: current time)\n");
+    printf("  -c FILE     Machine configuration (default: built-in machine)\n");
+    printf("  -h          Show this help message and exit\n");
+}
+
+/**
+ * @brief Parse an unsigned decimal number, also accepting forms like 1e9.
+ *
+ * @param str Input string.
+ * @param value Set to the parsed number.
+ * @return 0 on success, -1 if @p str is not a non-negative integer.
+ */
+static int parse_count(const char *str, uint64_t *value) {
+    char *end;
+
+    errno = 0;
+    unsigned long long parsed = strtoull(str, &end, 10);
+
+    if (errno == 0 && end != str && *end == '\0' && str[0] != '-') {
+        *value = parsed;
+        return 0;
+    }
+
+    /* strtod() would also take hexadecimal, inf and nan */
+    if (str[strspn(str, "0123456789.eE+")] != '\0')
+        return -1;
+
+    double real = strtod(str, &end);
+
+    if (end == str || *end != '\0' || real < 0 || real >= 18446744073709551616.0 || real != floor(real))
+        return -1;
+
+    *value = (uint64_t)real;
+    return 0;
+}
+
+/**
+ * @brief Thread body: simulate the spins of one task with a bet of 1.
+ *
+ * @param arg Pointer to a struct sim_task.
+ * @return NULL.
+ */
+static void *simulate(void *arg) {
+    struct sim_task *task = arg;
+    const struct slot_alias *reels = slot_config()->reels;
+    struct slot_rng rng = task->rng;
+    int64_t sum = 0;
+    uint64_t sum_squares = 0;
+    uint64_t hits = 0;
+    uint64_t jackpots = 0;
+
+    for (uint64_t i = 0; i < task->spins; i++) {
+        int r1 = slot_alias_sample(&reels[0], &rng);
+        int r2 = slot_alias_sample(&reels[1], &rng);
+        int r3 = slot_alias_sample(&reels[2], &rng);
+        int change = slot_payout(r1, r2, r3, 1);
+
+        sum += change;
+        sum_squares += (uint64_t)(change * change);
+        hits += change > 0;
+        jackpots += change == PAYOUT_THREE;
+    }
+
+    task->rng = rng;
+    task->sum = sum;
+    task->sum_squares = sum_squares;
+    task->hits = hits;
+    task->jackpots = jackpots;
+    return NULL;
+}
+
+/**
+ * @brief Print a proportion with its 95% confidence interval.
+ *
+ * @param name Label.
+ * @param count Number of successes.
+ * @param spins Number of trials.
+ * @param exact Exact probability, or a negative value if unknown.
+ */
+static void report_rate(const char *name, uint64_t count, uint64_t spins, double exact) {
+    double p = (double)count / spins;
+    double half = Z_95 * sqrt(p * (1 - p) / spins);
+
+    printf("%-15s %.5f%% ± %.5f%%", name, p * 100, half * 100);
+    if (exact >= 0)
+        printf(" (exact %.5f%%)", exact * 100);
+    printf("\n");
+}
+
+/**
+ * @brief Exact analysis of the current machine, if its reels are equal.
+ *
+ * @param exact Output probabilities of slot_distribution().
+ * @param expected Output expected change per unit bet.
+ * @return 0 on success, -1 if the reels have different weights.
+ */
+static int analyze(double *exact, double *expected) {
+    const struct slot_config *config = slot_config();
+    struct slot_model model = slot_classic_model;
+
+    for (int r = 1; r < SLOT_REELS; r++) {
+        if (memcmp(config->weights[r], config->weights[0], config->num_symbols * sizeof(double)) != 0)
+            return -1;
+    }
+
+    model.symbols = config->num_symbols;
+    model.weights = config->weights[0];
+
+    if (slot_distribution(&model, exact) != 0)
+        return -1;
+
+    *expected = slot_expected_change(&model, exact);
+    return 0;
+}
+
+/**
+ * @brief Entry point of the simulator.
+ *
+ * @return 0 on success, 1 on invalid options or thread errors.
+ */
+int main(int argc, char *argv[]) {
+    uint64_t spins = 100000000;
+    uint64_t seed = (uint64_t)time(NULL);
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:s:c:h")) != -1) {
+        uint64_t value;
+        unsigned line;
+
+        switch (opt) {
+            case 'c':
+                if (slot_config_load(optarg, &line) != 0) {
+                    if (line)
+                        fprintf(stderr, "%s:%u: invalid machine description\n", optarg, line);
+                    else
+                        perror(optarg);
+                    return 1;
+                }
+                break;
+            case 'n':
+            case 't':
+            case 's':
+                if (parse_count(optarg, &value) != 0) {
+                    fprintf(stderr, "Error: invalid number '%s'.\n", optarg);
+                    return 1;
+                }
+                if (opt == 'n')
+                    spins = value;
+                else if (opt == 's')
+                    seed = value;
+                else
+                    threads = value > MAX_THREADS ? MAX_THREADS + 1 : (long)value;
+                break;
+            case 'h':
+                print_help(argv[0]);
+                return 0;
+            default:
+                print_help(argv[0]);
+                return 1;
+        }
+    }
+
+    if (threads < 1 || threads > MAX_THREADS || spins == 0) {
+        fprintf(stderr, "Error: need 1 to %d threads and at least one spin.\n", MAX_THREADS);
+        return 1;
+    }
+
+    struct sim_task tasks[MAX_THREADS];
+    pthread_t ids[MAX_THREADS];
+    struct slot_rng rng;
+    struct timespec start, end;
+
+    slot_config();  /* set up the built-in machine before the threads read it */
+    slot_rng_seed(&rng, seed);
+    memset(tasks, 0, sizeof(tasks));
+
+    for (long t = 0; t < threads; t++) {
+        tasks[t].rng = rng;
+        tasks[t].spins = spins / threads + ((uint64_t)t < spins % threads);
+        slot_rng_jump(&rng);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (long t = 0; t < threads; t++) {
+        if (pthread_create(&ids[t], NULL, simulate, &tasks[t]) != 0) {
+            fprintf(stderr, "Error: failed to start a thread.\n");
+            return 1;
+        }
+    }
+
+    int64_t sum = 0;
+    uint64_t sum_squares = 0, hits = 0, jackpots = 0;
+
+    for (long t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        sum += tasks[t].sum;
+        sum_squares += tasks[t].sum_squares;
+        hits += tasks[t].hits;
+        jackpots += tasks[t].jackpots;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    double mean = (double)sum / spins;
+    double variance = spins > 1 ? ((double)sum_squares - mean * sum) / (spins - 1) : 0;
+    double half = Z_95 * sqrt(variance / spins);
+    double exact[SLOT_MAX_REELS + 1];
+    double expected;
+    int known = analyze(exact, &expected) == 0;
+
+    printf("%-15s %llu\n", "spins", (unsigned long long)spins);
+    printf("%-15s %ld\n", "threads", threads);
+    printf("%-15s %llu\n", "seed", (unsigned long long)seed);
+    printf("%-15s %.3f s (%.1f M spins/s)\n", "time", seconds, spins / seconds / 1e6);
+    printf("%-15s %.5f%% ± %.5f%%", "RTP", (1 + mean) * 100, half * 100);
+    if (known)
+        printf(" (exact %.5f%%)", (1 + expected) * 100);
+    printf("\n");
+    printf("%-15s %.6f bet^2\n", "variance", variance);
+    report_rate("hit frequency", hits, spins, known ? exact[2] + exact[3] : -1);
+    report_rate("jackpots", jackpots, spins, known ? exact[3] : -1);
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file bench_width.c
+ * @brief Microbenchmark of the label width computation.
+ *
+ * Compares slot_utf8_width() with the previous implementation
+ * (mbstowcs() into a wide buffer, then wcswidth()) on ASCII, Cyrillic
+ * and CJK labels, and the per-frame cost of padding a "label value"
+ * line: measured on every frame before, cached in slot_messages now.
+ */
+
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <wchar.h>
+#include <time.h>
+#include "slot_lib.h"
+
+/** @brief Number of calls in every benchmark. */
+#define BENCH_CALLS (4 * 1000 * 1000)
+
+/** @brief Labels measured, as a translation could render them. */
+static const char *labels[] = {
+    "Credits: 100",
+    "Кредиты: 100",
+    "クレジット: 100",
+};
+
+/** @brief Prevents the compiler from dropping the benchmarked calls. */
+static volatile long sink;
+
+/** @brief Previous utf8_width(): wide-character conversion and wcswidth(). */
+static int legacy_width(const char *s) {
+    wchar_t wcs[128];
+    int len = mbstowcs(wcs, s, 128);
+    if (len < 0)
+        return strlen(s);
+    return wcswidth(wcs, len);
+}
+
+/** @brief Monotonic time in seconds. */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** @brief Time BENCH_CALLS calls of a width function on @p s. */
+static double bench_width(int (*width)(const char *), const char *s) {
+    long sum = 0;
+    double start = now();
+
+    for (long i = 0; i < BENCH_CALLS; i++)
+        sum += width(s);
+
+    sink = sum;
+    return now() - start;
+}
+
+/** @brief Previous per-frame padding: format the line, then measure it. */
+static double bench_pad_legacy(const char *label) {
+    char line[SLOT_ROW_SIZE], out[SLOT_ROW_SIZE];
+    int inner_width = slot_config()->inner_width;
+    long sum = 0;
+    double start = now();
+
+    for (long i = 0; i < BENCH_CALLS; i++) {
+        snprintf(line, sizeof(line), "%s %ld", label, i & 1023);
+        int pad = inner_width - legacy_width(line);
+        sum += snprintf(out, sizeof(out), "│ %s%*s │", line, pad < 0 ? 0 : pad, "");
+    }
+
+    sink = sum;
+    return now() - start;
+}
+
+/** @brief Current per-frame padding: cached label width plus digit count. */
+static double bench_pad_cached(const char *label) {
+    char number[16], out[SLOT_ROW_SIZE];
+    int label_width = slot_utf8_width(label);
+    int inner_width = slot_config()->inner_width;
+    long sum = 0;
+    double start = now();
+
+    for (long i = 0; i < BENCH_CALLS; i++) {
+        int pad = inner_width - label_width - 1 - snprintf(number, sizeof(number), "%ld", i & 1023);
+        sum += snprintf(out, sizeof(out), "│ %s %s%*s │", label, number, pad < 0 ? 0 : pad, "");
+    }
+
+    sink = sum;
+    return now() - start;
+}
+
+/** @brief Print one result line in nanoseconds per call. */
+static void report(const char *name, const char *label, double seconds) {
+    printf("%-18s %-24s %8.2f ns/op\n", name, label, seconds * 1e9 / BENCH_CALLS);
+}
+
+int main(void) {
+    if (!setlocale(LC_ALL, "C.UTF-8") && !setlocale(LC_ALL, "en_US.UTF-8")) {
+        fprintf(stderr, "Error: no UTF-8 locale for the legacy path.\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(labels) / sizeof(labels[0]); i++) {
+        if (legacy_width(labels[i]) != slot_utf8_width(labels[i])) {
+            fprintf(stderr, "Error: widths differ for '%s'\n", labels[i]);
+            return 1;
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(labels) / sizeof(labels[0]); i++) {
+        report("legacy width", labels[i], bench_width(legacy_width, labels[i]));
+        report("slot_utf8_width", labels[i], bench_width(slot_utf8_width, labels[i]));
+    }
+
+    for (size_t i = 0; i < sizeof(labels) / sizeof(labels[0]); i++) {
+        char label[64];
+
+        snprintf(label, sizeof(label), "%.*s", (int)(strchr(labels[i], ' ') - labels[i]), labels[i]);
+        report("legacy padding", label, bench_pad_legacy(label));
+        report("cached padding", label, bench_pad_cached(label));
+    }
+
+    return 0;
+}
@@ -1,7 +1,30 @@
 #include <check.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include "slot_lib.h"
 
 
+/* run the drawing functions with stdout redirected to /dev/null */
+static int silence_stdout(void)
+{
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+    return saved;
+}
+
+static void restore_stdout(int saved)
+{
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+
 START_TEST(test_spin_reel_range)
 {
     for (int i = 0; i < 100; i++) {
@@ -12,6 +35,299 @@ START_TEST(test_spin_reel_range)
 }
 END_TEST
 
+START_TEST(test_frame_without_gettext)
+{
+    slot_messages_load();
+    ck_assert_ptr_nonnull(slot_messages()->credits);
+
+    const char *(*symbols)[3] = slot_config()->symbols;
+    unsigned long before = slot_gettext_calls();
+    int saved = silence_stdout();
+
+    for (int frame = 0; frame < 16; frame++) {
+        print_header(100);
+        print_reels(symbols[frame % NUM_ITEMS], symbols[0], symbols[1]);
+        print_footer(10);
+    }
+
+    restore_stdout(saved);
+    ck_assert_uint_eq(slot_gettext_calls(), before);
+
+    slot_messages_load();
+    ck_assert_uint_gt(slot_gettext_calls(), before);
+}
+END_TEST
+
+START_TEST(test_screen_redraws_changes_only)
+{
+    const char *(*symbols)[3] = slot_config()->symbols;
+    struct slot_screen screen;
+    char frame[SLOT_FRAME_SIZE];
+    int reels[3] = { 0, 1, 2 };
+
+    slot_screen_init(&screen);
+    size_t first = slot_screen_compose(&screen, 100, 10, reels, frame, sizeof(frame));
+    ck_assert_uint_gt(first, 0);
+    ck_assert_ptr_nonnull(strstr(frame, "\033[2J"));
+
+    /* nothing changed: only hide, park and show the cursor */
+    size_t same = slot_screen_compose(&screen, 100, 10, reels, frame, sizeof(frame));
+    ck_assert_uint_gt(same, 0);
+    ck_assert_uint_lt(same, 32);
+    ck_assert_ptr_null(strstr(frame, "\033[2J"));
+
+    /* one reel changed: only the middle line of its cell differs */
+    reels[1] = 3;
+    size_t cell = slot_screen_compose(&screen, 100, 10, reels, frame, sizeof(frame));
+    ck_assert_uint_gt(cell, same);
+    ck_assert_ptr_nonnull(strstr(frame, symbols[3][1]));
+    ck_assert_ptr_null(strstr(frame, symbols[3][0]));
+    ck_assert_uint_lt(cell, first / 4);
+
+    /* too small buffer leaves the state untouched */
+    reels[1] = 4;
+    ck_assert_uint_eq(slot_screen_compose(&screen, 100, 10, reels, frame, 8), 0);
+    ck_assert_int_eq(screen.reels[1], 3);
+}
+END_TEST
+
+START_TEST(test_payout_rules)
+{
+    ck_assert_int_eq(slot_matches(2, 2, 2), 3);
+    ck_assert_int_eq(slot_matches(1, 4, 1), 2);
+    ck_assert_int_eq(slot_matches(0, 1, 2), 1);
+
+    ck_assert_int_eq(slot_payout(2, 2, 2, 10), PAYOUT_THREE * 10);
+    ck_assert_int_eq(slot_payout(3, 3, 5, 10), PAYOUT_TWO * 10);
+    ck_assert_int_eq(slot_payout(5, 3, 3, 10), PAYOUT_TWO * 10);
+    ck_assert_int_eq(slot_payout(0, 1, 2, 10), -10);
+}
+END_TEST
+
+START_TEST(test_rng_below_range)
+{
+    struct slot_rng a, b;
+    int counts[NUM_ITEMS] = { 0 };
+
+    slot_rng_seed(&a, 1);
+    b = a;
+    slot_rng_jump(&b);
+    ck_assert_uint_ne(slot_rng_next(&a), slot_rng_next(&b));
+
+    for (int i = 0; i < 60000; i++) {
+        uint32_t r = slot_rng_below(&a, NUM_ITEMS);
+        ck_assert_uint_lt(r, NUM_ITEMS);
+        counts[r]++;
+    }
+
+    for (int i = 0; i < NUM_ITEMS; i++)
+        ck_assert_int_gt(counts[i], 9000);
+}
+END_TEST
+
+START_TEST(test_exact_distribution)
+{
+    double p[SLOT_MAX_REELS + 1];
+
+    ck_assert_int_eq(slot_distribution(&slot_classic_model, p), 0);
+    ck_assert_double_eq_tol(p[1], 120.0 / 216, 1e-12);
+    ck_assert_double_eq_tol(p[2], 90.0 / 216, 1e-12);
+    ck_assert_double_eq_tol(p[3], 6.0 / 216, 1e-12);
+    ck_assert_double_eq_tol(slot_expected_change(&slot_classic_model, p), 90.0 / 216, 1e-12);
+
+    /* 4 weighted reels of 3 symbols, checked by enumeration */
+    const double weights[3] = { 1, 2, 3 };
+    const int payouts[5] = { 0, -1, 1, 2, 3 };
+    const struct slot_model model = { 4, 3, weights, payouts };
+    double expected[5] = { 0 };
+
+    for (int i = 0; i < 81; i++) {
+        int count[3] = { 0 }, top = 0;
+        double weight = 1;
+
+        for (int reel = 0, code = i; reel < 4; reel++, code /= 3) {
+            count[code % 3]++;
+            weight *= weights[code % 3] / 6;
+        }
+        for (int s = 0; s < 3; s++)
+            top = count[s] > top ? count[s] : top;
+        expected[top] += weight;
+    }
+
+    ck_assert_int_eq(slot_distribution(&model, p), 0);
+    for (int k = 1; k <= 4; k++)
+        ck_assert_double_eq_tol(p[k], expected[k], 1e-12);
+}
+END_TEST
+
+START_TEST(test_ruin_probability)
+{
+    double p[SLOT_MAX_REELS + 1];
+    const double weights[1] = { 1 };
+    const int losing[2] = { 0, -1 };
+    const struct slot_model always_lose = { 1, 1, weights, losing };
+
+    slot_distribution(&always_lose, p);
+    ck_assert_double_eq_tol(slot_ruin_probability(&always_lose, p, 10, 1, 20, 0), 1, 1e-12);
+    ck_assert_double_eq_tol(slot_ruin_probability(&always_lose, p, 10, 1, 20, 5), 0, 1e-12);
+
+    slot_distribution(&slot_classic_model, p);
+    double poor = slot_ruin_probability(&slot_classic_model, p, 5, 1, 100, 0);
+    double rich = slot_ruin_probability(&slot_classic_model, p, 50, 1, 100, 0);
+
+    ck_assert_double_gt(poor, rich);
+    ck_assert_double_gt(rich, 0);
+    ck_assert_double_lt(poor, 1);
+    ck_assert_double_eq(slot_ruin_probability(&slot_classic_model, p, 5, 10, 100, 0), 1);
+    ck_assert_double_eq(slot_ruin_probability(&slot_classic_model, p, 5, 1, 5, 0), -1);
+}
+END_TEST
+
+/* encode a code point below U+0800 as a two-byte UTF-8 string */
+static const char *two_byte(unsigned cp, char buf[3])
+{
+    buf[0] = (char)(0xC0 | cp >> 6);
+    buf[1] = (char)(0x80 | (cp & 0x3F));
+    buf[2] = '\0';
+    return buf;
+}
+
+START_TEST(test_utf8_width)
+{
+    /* the two-byte ranges of the combining mark table */
+    static const unsigned ranges[][2] = {
+        { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF },
+        { 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A },
+        { 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 }
+    };
+    char buf[3];
+
+    ck_assert_int_eq(slot_utf8_width(""), 0);
+    ck_assert_int_eq(slot_utf8_width("Credits: 100"), 12);
+    ck_assert_int_eq(slot_utf8_width("Кредиты:"), 8);
+    ck_assert_int_eq(slot_utf8_width("│ 1 │"), 5);
+    ck_assert_int_eq(slot_utf8_width("日本語"), 6);
+    ck_assert_int_eq(slot_utf8_width("e\xCC\x81"), 1);
+    ck_assert_int_eq(slot_utf8_width("\xFF\xE2\x94"), 3);
+    ck_assert_int_eq(slot_utf8_width("\xF0\x9F\x8E\xB0"), 2);
+
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        ck_assert_int_eq(slot_utf8_width(two_byte(ranges[i][0], buf)), 0);
+        ck_assert_int_eq(slot_utf8_width(two_byte(ranges[i][1], buf)), 0);
+        ck_assert_int_eq(slot_utf8_width(two_byte(ranges[i][0] - 1, buf)),
+                         i > 0 && ranges[i - 1][1] == ranges[i][0] - 1 ? 0 : 1);
+        ck_assert_int_eq(slot_utf8_width(two_byte(ranges[i][1] + 1, buf)),
+                         i + 1 < sizeof(ranges) / sizeof(ranges[0])
+                         && ranges[i + 1][0] == ranges[i][1] + 1 ? 0 : 1);
+    }
+    ck_assert_int_eq(slot_utf8_width(two_byte(0x07FF, buf)), 1);
+}
+END_TEST
+
+START_TEST(test_config_weighted_reels)
+{
+    static const char text[] =
+        "# comment\n"
+        "\n"
+        "3 0 1 [A]|[a]|[_]\n"
+        "1 1 0 [B]|[b]|[_]\r\n"
+        "0 0 1 [C]|[c]|[_]";
+    struct slot_rng rng;
+    unsigned counts[3][3] = { { 0 } };
+    unsigned line;
+
+    ck_assert_int_eq(slot_config_parse(text, &line), 0);
+    ck_assert_uint_eq(line, 0);
+
+    const struct slot_config *config = slot_config();
+    ck_assert_uint_eq(config->num_symbols, 3);
+    ck_assert_int_eq(config->symbol_width, 3);
+    ck_assert_int_eq(config->inner_width, 11);
+    ck_assert_str_eq(config->symbols[1][1], "[b]");
+
+    slot_rng_seed(&rng, 7);
+    for (int i = 0; i < 40000; i++) {
+        for (int r = 0; r < SLOT_REELS; r++)
+            counts[r][slot_alias_sample(&config->reels[r], &rng)]++;
+    }
+
+    /* reel 1: 3/4 and 1/4; reel 2: only B; reel 3: A or C */
+    ck_assert_uint_gt(counts[0][0], 29000);
+    ck_assert_uint_lt(counts[0][0], 31000);
+    ck_assert_uint_eq(counts[0][2], 0);
+    ck_assert_uint_eq(counts[1][1], 40000);
+    ck_assert_uint_eq(counts[2][1], 0);
+
+    /* errors keep the current machine and report the line */
+    ck_assert_int_eq(slot_config_parse("1 1 1 [A]|[a]|[_]\n1 1 [B]|[b]|[_]\n", &line), -1);
+    ck_assert_uint_eq(line, 2);
+    ck_assert_int_eq(slot_config_parse("1 1 1 [A]|[a]|[_]\n1 1 1 [BB]|[b]|[_]\n", &line), -1);
+    ck_assert_uint_eq(line, 2);
+    ck_assert_int_eq(slot_config_parse("1 1 1 [A]|[a]\n", &line), -1);
+    ck_assert_uint_eq(line, 1);
+    ck_assert_int_eq(slot_config_parse("1 0 1 [A]|[a]|[_]\n", &line), -1);
+    ck_assert_uint_eq(slot_config()->num_symbols, 3);
+
+    slot_config_default();
+    ck_assert_uint_eq(slot_config()->num_symbols, NUM_ITEMS);
+}
+END_TEST
+
+START_TEST(test_screen_wide_symbols)
+{
+    struct slot_screen screen;
+    char frame[SLOT_FRAME_SIZE];
+    const int reels[3] = { 0, 1, 0 };
+
+    ck_assert_int_eq(slot_config_parse("1 1 1 ┌───────┐|│ seven │|└───────┘\n"
+                                       "1 1 1 ┌───────┐|│ lemon │|└───────┘\n", NULL), 0);
+
+    slot_screen_init(&screen);
+    ck_assert_uint_gt(slot_screen_compose(&screen, 100, 10, reels, frame, sizeof(frame)), 0);
+    ck_assert_ptr_nonnull(strstr(frame, "│ │ seven │ │ lemon │ │ seven │ │"));
+    ck_assert_ptr_nonnull(strstr(frame, "┌===============================┐"));
+
+    /* the changed cell is addressed by the new picture width */
+    const int changed[3] = { 0, 1, 1 };
+    ck_assert_uint_gt(slot_screen_compose(&screen, 100, 10, changed, frame, sizeof(frame)), 0);
+    ck_assert_ptr_nonnull(strstr(frame, "\033[5;23H│ lemon │"));
+
+    slot_config_default();
+}
+END_TEST
+
+START_TEST(test_frame_stats_histogram)
+{
+    struct slot_frame_stats stats;
+    const int64_t period = 100000000;
+
+    slot_frame_stats_init(&stats, period);
+
+    /* the first frame only starts the clock */
+    slot_frame_stats_add(&stats, 1000000000, 1);
+    ck_assert_uint_eq(stats.frames, 0);
+
+    slot_frame_stats_add(&stats, 1000000000 + period + 10000, 1);   /* 10 us late */
+    slot_frame_stats_add(&stats, 1000000000 + 2 * period, 1);       /* 10 us early */
+    slot_frame_stats_add(&stats, 1000000000 + 3 * period + 300000, 1);
+    slot_frame_stats_add(&stats, 1000000000 + 5 * period + 300000, 2); /* one tick missed */
+
+    ck_assert_uint_eq(stats.frames, 4);
+    ck_assert_uint_eq(stats.missed, 1);
+    ck_assert_uint_eq(stats.buckets[0], 3);
+    ck_assert_uint_eq(stats.buckets[3], 1);
+    ck_assert_int_eq(stats.max_jitter_ns, 300000);
+
+    /* a pause between animations is not an interval */
+    slot_frame_stats_pause(&stats);
+    slot_frame_stats_add(&stats, 9000000000, 1);
+    ck_assert_uint_eq(stats.frames, 4);
+
+    slot_frame_stats_add(&stats, 9000000000 + 2 * period, 1);
+    ck_assert_uint_eq(stats.buckets[SLOT_JITTER_BUCKETS - 1], 1);
+}
+END_TEST
+
 Suite* slot_suite(void)
 {
     Suite *s;
@@ -21,6 +337,16 @@ Suite* slot_suite(void)
 
     tc_core = tcase_create("Core");
     tcase_add_test(tc_core, test_spin_reel_range);
+    tcase_add_test(tc_core, test_frame_without_gettext);
+    tcase_add_test(tc_core, test_screen_redraws_changes_only);
+    tcase_add_test(tc_core, test_payout_rules);
+    tcase_add_test(tc_core, test_rng_below_range);
+    tcase_add_test(tc_core, test_exact_distribution);
+    tcase_add_test(tc_core, test_ruin_probability);
+    tcase_add_test(tc_core, test_utf8_width);
+    tcase_add_test(tc_core, test_config_weighted_reels);
+    tcase_add_test(tc_core, test_screen_wide_symbols);
+    tcase_add_test(tc_core, test_frame_stats_histogram);
     suite_add_tcase(s, tc_core);
 
     return s;